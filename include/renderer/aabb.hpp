@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+#include <limits>
+
 namespace odin {
 // Inlining these two functions which have less error checks
 // than the standard fmin/fmax
@@ -24,6 +26,27 @@ struct AABB {
 
     return AABB{min, max};
   }
+
+  // Build a box that does not contain anything. Growing it by any
+  // point or box results in that point or box
+  static AABB emptyBox() {
+    return AABB{glm::vec3(std::numeric_limits<float>::max()),
+                glm::vec3(-std::numeric_limits<float>::max())};
+  }
+
+  // Grow the box so that it also encloses the given point
+  void expand(const glm::vec3 &p) {
+    min = glm::vec3(ffmin(min.x, p.x), ffmin(min.y, p.y), ffmin(min.z, p.z));
+    max = glm::vec3(ffmax(max.x, p.x), ffmax(max.y, p.y), ffmax(max.z, p.z));
+  }
+
+  // Surface area of the box. This is the probability measure used by the
+  // Surface Area Heuristic when building acceleration structures
+  float surfaceArea() const {
+    glm::vec3 extent = max - min;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z +
+                   extent.z * extent.x);
+  }
 };
 } // namespace odin
 #endif // ODIN_AABB_HPP
\ No newline at end of file
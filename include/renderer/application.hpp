@@ -21,6 +21,7 @@
 #include <memory>
 #include <optional>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
@@ -30,10 +31,17 @@
 #include "imgui_impl_vulkan.h"
 #include "renderer/aabb.hpp"
 #include "renderer/bvh.hpp"
+#include "renderer/bvh_stats.hpp"
 #include "renderer/camera.hpp"
+#include "renderer/cpu_renderer.hpp"
+#include "renderer/kd_tree.hpp"
+#include "renderer/tile_scheduler.hpp"
 #include "renderer/triangle.hpp"
 #include "renderer/ubo.hpp"
 #include "renderer/vertex.hpp"
+#include "renderer/wide_bvh.hpp"
+#include "utils/image_writer.hpp"
+#include "utils/thread_pool.hpp"
 #include "vk/bvh_buffer.hpp"
 #include "vk/compute_pipeline.hpp"
 #include "vk/depth_image.hpp"
@@ -44,11 +52,16 @@
 #include "vk/index_buffer.hpp"
 #include "vk/instance.hpp"
 #include "vk/render_pass.hpp"
+#include "vk/storage_buffer.hpp"
+#include "vk/staging_ring.hpp"
+#include "vk/storage_image.hpp"
 #include "vk/swapchain.hpp"
 #include "vk/texture_image.hpp"
 #include "vk/texture_sampler.hpp"
+#include "vk/timestamp_query.hpp"
 #include "vk/uniform_buffer.hpp"
 #include "vk/vertex_buffer.hpp"
+#include "vk/wavefront_pipeline.hpp"
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -70,6 +83,8 @@ class Application {
   static std::string COMPUTE_SHADER_PATH;
   static std::string FRAGMENT_SHADER_PATH;
   static std::string VERTEX_SHADER_PATH;
+  // Directory of the SPIR-V files of the wavefront kernels
+  static std::string WAVEFRONT_SHADER_DIRECTORY;
   static std::string MODEL_PATH;
   static std::string TEXTURE_PATH;
   static const int WIDTH = 800;
@@ -87,8 +102,15 @@ class Application {
 
   void cleanupComputePipeline();
 
+  void cleanupHeadless();
+
   void cleanupSwapChain();
 
+  void createAccumulationBuffer();
+
+  BvhStats buildBvh(BVH &target, std::vector<Triangle> &sceneTriangles,
+                    const BvhBuildOptions &options);
+
   void createBvh();
 
   void createBvhBuffer();
@@ -99,6 +121,8 @@ class Application {
 
   void createComputePipeline();
 
+  void createComputeScheduler();
+
   void createDepthResources();
 
   void createDescriptorPool();
@@ -113,8 +137,14 @@ class Application {
 
   void createInstance();
 
+  void createKdTree();
+
   void createRenderPass();
 
+  // Uploads to device local buffers run on the transfer queue while the
+  // rest of the setup continues
+  void createStagingRing();
+
   void createSurface();
 
   void createSwapChain();
@@ -129,6 +159,10 @@ class Application {
 
   void drawFrame();
 
+  void initCamera();
+
+  void initHeadless();
+
   void initVulkan();
 
   void initWindow();
@@ -137,16 +171,40 @@ class Application {
 
   void mainLoop();
 
+  // Feed the GPU time of the last compute submission of a frame slot back to
+  // the scheduler. Only valid once it has finished executing
+  void measureComputeTiles(uint32_t slot);
+
   int parseArguments(int argc, char *argv[]);
 
+  // Report the usage and fragmentation of the device memory blocks. Only
+  // printed in debug builds
+  void printMemoryStats() const;
+
+  // Report the rays per second of the wavefront extension stage per bounce
+  void printWavefrontStats() const;
+
   void recreateSwapChain();
 
-  void updateUniformBuffer(uint32_t currentImage);
+  void renderCpu();
+
+  void renderHeadless();
+
+  // Submit the next batch of tiles into the output image of a frame slot.
+  // Returns true if it finishes a frame
+  bool submitComputeTiles(uint32_t slot);
+
+  // Time whole frames of the megakernel with every work group size the
+  // device supports and keep the pipeline of the fastest one
+  void tuneWorkGroupSize();
+
+  void updateUniformBuffer(uint32_t slot);
 
   GLFWwindow *window;
 
   std::unique_ptr<odin::Instance> instance;
-  VkSurfaceKHR surface;
+  // Stays VK_NULL_HANDLE when rendering headless
+  VkSurfaceKHR surface = VK_NULL_HANDLE;
 
   std::unique_ptr<DeviceManager> deviceManager;
 
@@ -155,29 +213,77 @@ class Application {
   std::unique_ptr<RenderPass> renderPass;
 
   std::unique_ptr<ComputePipeline> computePipeline;
+  // Only created for wavefront rendering
+  std::unique_ptr<WavefrontPipeline> wavefrontPipeline;
   std::unique_ptr<GraphicsPipeline> graphicsPipeline;
 
   std::unique_ptr<CommandPool> commandPool;
+  std::unique_ptr<StagingRing> stagingRing;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
   std::vector<VkFence> inFlightFences;
-  VkFence computeFence;
+  // Every frame slot renders into its own output image with its own compute
+  // submission, which signals the graphics submission of the slot
+  std::vector<VkFence> computeFences;
+  std::vector<VkSemaphore> computeFinishedSemaphores;
   size_t currentFrame = 0;
+  // MAX_FRAMES_IN_FLIGHT with a window, a single one when rendering headless
+  uint32_t frameSlots = 1;
 
   bool framebufferResized = false;
 
   std::vector<Triangle> triangles;
+  AccelerationStructure accelerationStructure = AccelerationStructure::Bvh;
+  KdTree kdTree;
+  BvhBuildOptions bvhOptions;
   BVH bvh;
+  int bvhWidth = 2;
+  bool bvhBenchmark = false;
+  std::string bvhStatsPath;
+
+  bool cpuRender = false;
+  std::string outputPath;
+  PacketIsa packetIsa = PacketIsa::Auto;
+  bool headlessRender = false;
+  bool wavefrontRender = false;
+  // Work groups of the persistent threads extension kernel, 0 disables it
+  uint32_t persistentGroups = 0;
+  // Sort the rays of the secondary bounces before extending them
+  bool sortRays = false;
+  WavefrontStats wavefrontStats;
+  std::string pipelineCacheDirectory;
+  uint32_t numSamples = 16;
+  // Specialization constants of the compute pipelines
+  uint32_t samplesPerFrame = 16;
+  uint32_t numBounces = 3;
+  uint32_t workGroupWidth = 16;
+  uint32_t workGroupHeight = 16;
+  // Pick the work group size by timing candidates on the device
+  bool tuneWorkGroup = false;
+  std::unique_ptr<StorageImage> storageImage;
+  WideBVH wideBvh;
   std::unique_ptr<BvhBuffer> bvhBuffer;
 
+  // Camera of every frame slot, in one persistently mapped buffer
   std::unique_ptr<UniformBuffer> computeUbo;
+  // Frames accumulated since the camera last moved. Pushed to the compute
+  // shaders with every dispatch
+  uint32_t frameIndex = 0;
+  std::unique_ptr<StorageBuffer> accumulationBuffer;
+
+  float frameBudget = 16.0f;
+  std::unique_ptr<TileScheduler> tileScheduler;
+  std::vector<std::unique_ptr<TimestampQuery>> computeTimestamps;
+  // Tiles of the compute submission of every slot that has not been measured
+  // yet
+  std::vector<size_t> submittedTiles;
 
   std::unique_ptr<DescriptorSetLayout> computeDescriptorSetLayout;
   std::unique_ptr<DescriptorSetLayout> graphicsDescriptorSetLayout;
   std::unique_ptr<DescriptorPool> descriptorPool;
 
-  std::unique_ptr<TextureImage> textureImage;
+  std::vector<std::unique_ptr<TextureImage>> outputImages;
   std::unique_ptr<TextureSampler> textureSampler;
 
   std::unique_ptr<DepthImage> depthImage;
@@ -4,86 +4,167 @@
 #include <glm/glm.hpp>
 
 #include <algorithm>
+#include <cstdint>
 #include <exception>
-#include <random>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "renderer/aabb.hpp"
 #include "renderer/triangle.hpp"
 
 namespace odin {
-// A struct describing a node in the BVH. The leaf nodes
-// will store the actual geometry
+// Forward declarations
+class Arena;
+class TaskGroup;
+class ThreadPool;
+
+// Cost of traversing an interior node relative to intersecting a triangle.
+// Minimised by the SAH builders and reported by BvhStats
+const float BVH_TRAVERSAL_COST = 1.0f;
+
+// A struct describing a node in the BVH packed into 32 bytes. Nodes are laid
+// out in depth-first order so the first child of an interior node always
+// directly follows it and only the index of the second child needs to be
+// stored. Leaves reference a range of BVH::triangles instead.
+// The layout has to match the BvhNode struct in
+// shaders/include/traversal.glsl
 struct BvhNode {
-  Triangle left;
-  Triangle right;
-  AABB box;
+  glm::vec3 min;
+  uint32_t offset;  // Second child of interior nodes, first triangle of leaves
+  glm::vec3 max;
+  uint32_t count;   // Number of triangles in a leaf. Zero for interior nodes
+};
+
+// The vertices of a triangle as stored on the GPU. The face normal is packed
+// into the w components of the vertices.
+// The layout has to match the BvhTriangle struct in
+// shaders/include/traversal.glsl
+struct BvhTriangle {
+  glm::vec4 v0;
+  glm::vec4 v1;
+  glm::vec4 v2;
+};
+
+// The strategies that can be used to split a set of triangles
+// while building the BVH
+enum class BvhBuildMode {
+  Median,  // Split at the object median along the longest axis
+  Sah,     // Binned Surface Area Heuristic
+  Lbvh,    // Linear BVH emitted from the Morton order of the centroids
+  Sbvh     // Binned SAH that also splits triangles at spatial planes
+};
+
+// Parameters used to tune the construction of the BVH
+struct BvhBuildOptions {
+  BvhBuildMode mode = BvhBuildMode::Sah;
+  int numBins = 16;
+  int maxLeafSize = 4;
+  unsigned numThreads = 0;  // Zero uses all hardware threads
+  int mortonBits = 30;      // Morton code size of the LBVH, 30 or 63 bits
+  // Number of extra triangle references the SBVH may create by spatial
+  // splits, relative to the number of triangles. The SBVH is built serially
+  float splitBudget = 0.3f;
 };
 
 // A struct encapsulating data for a Bounding Volume Hierarchy.
 // This should help to accelerate the raytracing done in the compute shader
 struct BVH {
   std::vector<BvhNode> nodes;
+  std::vector<BvhTriangle> triangles;
 
-public:
-  void init(std::vector<Triangle> &triangles) {
-    if (triangles.size() == 0) {
-      throw std::runtime_error("No triangles available to build BVH!");
-    }
+  // Upper bound for the number of triangles in a leaf
+  static const int MAX_LEAF_SIZE = 16;
 
-    buildBVH(triangles, triangles.size());
-    // Reverse our vector so we have a proper ordering for the nodes
-    std::reverse(nodes.begin(), nodes.end());
-  }
+  // Upper bound for the number of SAH bins so they fit on the stack
+  static const int MAX_BINS = 64;
+
+public:
+  // Builds the hierarchy and reorders the triangles so that the triangles
+  // of every leaf are stored next to each other. The packed triangles in
+  // the same order are stored in triangles. The SBVH leaves the input order
+  // alone since its leaves can share triangles, which are stored once for
+  // every leaf
+  void init(std::vector<Triangle> &triangles,
+            const BvhBuildOptions &options = BvhBuildOptions());
 
 private:
-  void buildBVH(std::vector<Triangle> &triangles, int n) {
-    // Setup random number generator
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_int_distribution<std::mt19937::result_type> dist(0, 2);
-
-    // Choose which axis to sort over
-    int axis = dist(rng);
-    if (axis == 0) {
-      // Sort over x axis
-      std::sort(triangles.begin(), triangles.end(), CompareX());
-    } else if (axis == 1) {
-      // Sort over y axis
-      std::sort(triangles.begin(), triangles.end(), CompareY());
-    } else {
-      // Sort over z axis
-      std::sort(triangles.begin(), triangles.end(), CompareZ());
-    }
-
-    // Decide where to place the geometry into the leaf node
+  // Compact reference to a triangle with its precomputed bounds. The
+  // builders reorder these 32 byte references instead of the triangles
+  struct PrimitiveRef {
+    glm::vec3 boxMin;
+    uint32_t index;
+    glm::vec3 boxMax;
+    uint32_t padding;
+  };
+
+  // The data the builders work on. All of it lives in a single arena
+  struct BuildPrimitives {
+    PrimitiveRef *refs = nullptr;
+    const Triangle *triangles = nullptr;  // Clipped by the SBVH
+    // Sides of the spatial splits of the SBVH. As large as refs
+    PrimitiveRef *scratch = nullptr;
+    size_t capacity = 0;
+  };
+
+  // A plane along which the SBVH splits the triangles themselves
+  struct SpatialSplit {
+    int axis = -1;
+    float position = 0.0f;
+    float cost = std::numeric_limits<float>::max();
+  };
+
+  // Part of the tree built by one task of the parallel builder. It is either
+  // an interior node with two children or a subtree that was built serially
+  struct Subtree {
     BvhNode node;
-    if (n == 1) {
-      // If we only have 1 element we copy it into both leaves
-      node.left = node.right = triangles[0];
-    } else if (n == 2) {
-      node.left = triangles[0];
-      node.right = triangles[1];
-    } else {
-      // Recursion to divide triangle list into two search spaces
-      buildBVH(triangles, n / 2);
-
-      // Create an iterator for the second half of the triangles array
-      auto first = triangles.begin() + (n / 2);
-      std::vector<Triangle> rightSide(first, triangles.end());
-      buildBVH(rightSide, n - n / 2);
-    }
-
-    AABB box_left, box_right;
-    if (!node.left.boundingBox(box_left) ||
-        !node.right.boundingBox(box_right)) {
-      throw std::runtime_error("No bounding box found!");
-    }
-
-    // Place constructed node into vector
-    node.box = AABB::surroundingBox(box_left, box_right);
-    nodes.push_back(node);
-  }
+    std::unique_ptr<Subtree> left;
+    std::unique_ptr<Subtree> right;
+    std::vector<BvhNode> nodes;
+  };
+
+  void appendSubtree(const Subtree &subtree);
+
+  void buildBVH(size_t begin, size_t end, int depth,
+                std::vector<BvhNode> &out);
+
+  void buildLbvh(size_t count, Arena &arena);
+
+  void buildSbvh(size_t begin, size_t end, size_t limit, int depth,
+                 float rootArea);
+
+  void buildSubtree(ThreadPool &pool, TaskGroup &group, size_t begin,
+                    size_t end, int depth, Subtree &subtree);
+
+  void computeBounds(size_t begin, size_t end, AABB &box, AABB &centroidBox,
+                     ThreadPool *pool);
+
+  AABB emitLbvh(const uint32_t *leftSplits, const uint32_t *rightSplits,
+                size_t first, size_t last, uint32_t split, int depth);
+
+  SpatialSplit findSpatialSplit(size_t begin, size_t end,
+                                const AABB &box) const;
+
+  size_t partitionMedian(size_t begin, size_t end, const AABB &centroidBox);
+
+  size_t partitionSah(size_t begin, size_t end, const AABB &box,
+                      const AABB &centroidBox, ThreadPool *pool,
+                      float &splitCost);
+
+  bool partitionSpatial(size_t begin, size_t end, size_t limit,
+                        const SpatialSplit &split, size_t &leftEnd,
+                        size_t &rightBegin, size_t &rightEnd);
+
+  size_t splitRange(size_t begin, size_t end, int depth, const AABB &box,
+                    const AABB &centroidBox, ThreadPool *pool,
+                    float &splitCost);
+
+  void splitReference(const PrimitiveRef &ref, int axis, float position,
+                      AABB &leftBox, AABB &rightBox) const;
+
+  BvhBuildOptions buildOptions;
+  BuildPrimitives primitives;
 };
 } // namespace odin
-#endif // ODIN_BVH_HPP
\ No newline at end of file
+#endif // ODIN_BVH_HPP
@@ -0,0 +1,57 @@
+#ifndef ODIN_BVH_STATS_HPP
+#define ODIN_BVH_STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "renderer/bvh.hpp"
+
+namespace odin {
+// Quality metrics of a built BVH. These are used to compare the builders
+// on a scene and to catch regressions in the quality of the trees
+struct BvhStats {
+  BvhBuildOptions options;
+  float buildTime = 0.0f;  // Wall time of BVH::init in milliseconds
+
+  size_t numTriangles = 0;  // Triangles of the scene
+  size_t numReferences = 0; // Triangles stored in the leaves
+  size_t numNodes = 0;
+  size_t numLeaves = 0;
+
+  int maxDepth = 0;
+  float averageLeafDepth = 0.0f;
+  float averageLeafSize = 0.0f;
+
+  // Number of leaves holding 1 to MAX_LEAF_SIZE triangles
+  std::array<size_t, BVH::MAX_LEAF_SIZE> leafSizes{};
+
+  // Expected cost of tracing a ray according to the Surface Area Heuristic
+  // in units of triangle intersections
+  float sahCost = 0.0f;
+
+  // Surface area of the overlap of the two children of an interior node
+  // relative to the node itself, averaged over all interior nodes
+  float overlapRatio = 0.0f;
+
+  size_t nodeBytes = 0;
+  size_t triangleBytes = 0;
+
+public:
+  void compute(const BVH &bvh, const BvhBuildOptions &options,
+               size_t numTriangles, float buildTime);
+
+  void print(std::ostream &out) const;
+
+  void writeJson(std::ostream &out) const;
+
+  // Write the stats of several builds into one JSON file
+  static void writeJsonFile(const std::string &path, const std::string &scene,
+                            const std::vector<BvhStats> &builds);
+};
+
+const char *bvhBuildModeName(BvhBuildMode mode);
+} // namespace odin
+#endif // ODIN_BVH_STATS_HPP
@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+
 namespace odin {
 struct Camera {
   alignas(16) glm::vec3 origin;
@@ -12,7 +14,8 @@ struct Camera {
   alignas(16) glm::vec3 u;
   alignas(16) glm::vec3 v;
   alignas(16) glm::vec3 w;
-  alignas(16) float lens_radius;
+  // std140 packs a scalar right after a vec3
+  float lens_radius;
 
   void init(glm::vec3 lookFrom, glm::vec3 lookAt, glm::vec3 vUp, float vfov,
             float aspect, float aperture, float focusDist) {
@@ -0,0 +1,85 @@
+#ifndef ODIN_CPU_RENDERER_HPP
+#define ODIN_CPU_RENDERER_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/bvh.hpp"
+#include "renderer/camera.hpp"
+#include "renderer/material.hpp"
+#include "renderer/packet_tracer.hpp"
+
+namespace odin {
+// Forward declarations
+class ThreadPool;
+
+/**
+ * A path tracer running on the CPU that mirrors shaders/shader.comp. It uses
+ * the same camera, random numbers, materials and scatter functions and walks
+ * the binary BVH that is uploaded to the GPU, so its images serve as a
+ * reference for the compute shader. The image is split into tiles that are
+ * rendered in parallel on a thread pool. Camera rays of neighboring pixels
+ * are traced as packets with SIMD instructions, bounces one ray at a time.
+ * The samples and bounces are those of the first frame of the compute shader
+ * specialized with the same values
+ */
+class CpuRenderer {
+ public:
+  static const int TILE_SIZE = 16;
+
+  // The defaults of numSamples and numBounces match those of
+  // shaders/include/common.glsl
+  CpuRenderer(const BVH &bvh, ThreadPool &pool,
+              PacketIsa packetIsa = PacketIsa::Auto, uint32_t numSamples = 16,
+              uint32_t numBounces = 3);
+
+  const char *getPacketIsaName() const;
+
+  // Render an image of width x height pixels into RGBA8 pixels. Rows are
+  // stored in the same order as the storage image of the compute shader
+  void render(const Camera &camera, uint32_t width, uint32_t height,
+              std::vector<uint8_t> &pixels) const;
+
+ private:
+  struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+  };
+
+  struct HitRecord {
+    float t;
+    glm::vec3 p;
+    glm::vec3 normal;
+    Material mat;
+  };
+
+  void renderTile(const Camera &camera, uint32_t width, uint32_t height,
+                  uint32_t tileX, uint32_t tileY, uint8_t *pixels) const;
+
+  // Follow a path from the first hit of a camera ray
+  glm::vec3 trace(Ray ray, bool hit, HitRecord rec) const;
+
+  bool intersect(const Ray &ray, float tMin, float tMax,
+                 HitRecord &rec) const;
+
+  bool triangleHit(const Ray &ray, uint32_t triangleIndex, float tMin,
+                   float tMax, HitRecord &rec) const;
+
+  void recordHit(const Ray &ray, uint32_t triangleIndex, float t,
+                 HitRecord &rec) const;
+
+  static Ray getRay(const Camera &camera, float s, float t);
+
+  static bool scatter(const Ray &ray, const HitRecord &rec,
+                      glm::vec3 &attenuation, Ray &scattered);
+
+  const BVH &bvh;
+  ThreadPool &pool;
+  PacketTracer packetTracer;
+  uint32_t numSamples;
+  uint32_t numBounces;
+};
+}  // namespace odin
+#endif  // ODIN_CPU_RENDERER_HPP
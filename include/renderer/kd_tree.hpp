@@ -0,0 +1,111 @@
+#ifndef ODIN_KD_TREE_HPP
+#define ODIN_KD_TREE_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "renderer/aabb.hpp"
+#include "renderer/bvh.hpp"
+#include "renderer/triangle.hpp"
+
+namespace odin {
+// A node of the k-d tree packed into 8 bytes. Nodes are laid out in
+// depth-first order so the child below the split plane directly follows its
+// parent. The lower two bits of data hold the split axis or KD_LEAF. The
+// upper bits hold the index of the child above the split plane for interior
+// nodes and the number of triangles for leaves. Leaves store the bits of
+// their first triangle in split instead of a position.
+// The layout has to match the KdNode struct in
+// shaders/include/traversal.glsl
+struct KdNode {
+  float split;
+  uint32_t data;
+};
+
+// A k-d tree over the triangles of the scene built with the Surface Area
+// Heuristic in O(N log N) following Wald and Havran, "On building fast
+// kd-trees for ray tracing, and on doing that in O(N log N)". Split planes
+// are placed at the boundaries of the triangles clipped to the node so that
+// empty space is cut off tightly
+struct KdTree {
+  static const uint32_t KD_LEAF = 3;
+
+  // Upper bound for the depth of the tree. This is KD_STACK_SIZE, the size
+  // of the traversal stack in shaders/include/traversal.glsl
+  static const int MAX_DEPTH = 64;
+
+  AABB bounds;
+  std::vector<KdNode> nodes;
+
+  // Packed triangles in the order in which the leaves reference them.
+  // Triangles that straddle split planes are stored once for every leaf
+  // they end up in
+  std::vector<BvhTriangle> triangles;
+
+public:
+  void init(const std::vector<Triangle> &triangles);
+
+private:
+  enum EventType : uint8_t { END, PLANAR, START };
+
+  enum Side : uint8_t { BOTH, LEFT, RIGHT };
+
+  // The start or end of the bounds of a triangle along one axis. Triangles
+  // that are flat along the axis only have a single planar event
+  struct Event {
+    float position;
+    uint32_t triangle;
+    uint8_t axis;
+    EventType type;
+  };
+
+  // Events are sorted by axis, then by position. At the same position end
+  // events come before planar events and start events come last
+  struct EventOrder {
+    bool operator()(const Event &a, const Event &b) const {
+      if (a.axis != b.axis) {
+        return a.axis < b.axis;
+      }
+      if (a.position != b.position) {
+        return a.position < b.position;
+      }
+      return a.type < b.type;
+    }
+  };
+
+  struct Split {
+    int axis = -1;
+    float position = 0.0f;
+    float cost = 0.0f;
+    bool planarLeft = false;
+  };
+
+  static void addEvents(std::vector<Event> &events, uint32_t triangle,
+                        const AABB &box);
+
+  void buildNode(const std::vector<Triangle> &source,
+                 std::vector<Event> &events, size_t count, const AABB &voxel,
+                 int depth);
+
+  Split findSplit(const std::vector<Event> &events, size_t count,
+                  const AABB &voxel) const;
+
+  void splitEvents(const std::vector<Triangle> &source,
+                   const std::vector<Event> &events, const Split &split,
+                   const AABB &leftVoxel, const AABB &rightVoxel,
+                   std::vector<Event> &leftEvents,
+                   std::vector<Event> &rightEvents, size_t &leftCount,
+                   size_t &rightCount);
+
+  void addLeaf(const std::vector<Triangle> &source,
+               const std::vector<Event> &events, size_t count,
+               size_t nodeIndex);
+
+  int maxDepth = 0;
+  std::vector<Side> sides;
+};
+} // namespace odin
+#endif // ODIN_KD_TREE_HPP
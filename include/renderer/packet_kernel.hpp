@@ -0,0 +1,211 @@
+#ifndef ODIN_PACKET_KERNEL_HPP
+#define ODIN_PACKET_KERNEL_HPP
+
+#include <limits>
+
+#include "renderer/bvh.hpp"
+#include "renderer/packet_tracer.hpp"
+
+namespace odin {
+// Same traversal stack size as BVH_STACK_SIZE of
+// shaders/include/traversal.glsl
+const int PACKET_STACK_SIZE = 64;
+
+const float PACKET_INFINITY = std::numeric_limits<float>::infinity();
+
+/**
+ * Packet traversal written once against a small vector type V that holds
+ * V::WIDTH floats. Every instruction set wraps its registers in such a type
+ * and instantiates intersectPacketLanes with it. V provides load, store and
+ * broadcast, the arithmetic operators, min, max and abs with the semantics of
+ * std::min and std::max, and comparisons returning a V::Mask. Masks support
+ * &, |, ! and bits, and select(mask, a, b) picks a where the mask is set.
+ * Every operation is carried out in the same order as in triangle_hit and
+ * aabb_hit. Every ray only takes part in the nodes whose boxes it hit
+ * itself, so it finds the same closest hit as the scalar traversal.
+ *
+ * The kernels only work on raw pointers and avoid inline functions of the
+ * standard library. Those would be emitted once per translation unit, and
+ * the linker could pick a copy compiled for AVX2 for the other ones
+ */
+template <typename V>
+struct PacketLanes {
+  V originX, originY, originZ;
+  V directionX, directionY, directionZ;
+  V invDirectionX, invDirectionY, invDirectionZ;
+  V tMin;
+};
+
+template <typename V>
+typename V::Mask boxHit(const PacketLanes<V> &rays, const BvhNode &node,
+                        const V &closest, V &tEnter) {
+  V t0x = (V::broadcast(node.min.x) - rays.originX) * rays.invDirectionX;
+  V t0y = (V::broadcast(node.min.y) - rays.originY) * rays.invDirectionY;
+  V t0z = (V::broadcast(node.min.z) - rays.originZ) * rays.invDirectionZ;
+  V t1x = (V::broadcast(node.max.x) - rays.originX) * rays.invDirectionX;
+  V t1y = (V::broadcast(node.max.y) - rays.originY) * rays.invDirectionY;
+  V t1z = (V::broadcast(node.max.z) - rays.originZ) * rays.invDirectionZ;
+
+  V smaller = max(min(t1x, t0x), max(min(t1y, t0y), min(t1z, t0z)));
+  V bigger = min(max(t0x, t1x), min(max(t0y, t1y), max(t0z, t1z)));
+  tEnter = max(rays.tMin, smaller);
+  V tExit = min(closest, bigger);
+  return tEnter <= tExit;
+}
+
+template <typename V>
+typename V::Mask triangleHit(const PacketLanes<V> &rays,
+                             const BvhTriangle &triangle, const V &closest,
+                             V &t) {
+  V v0x = V::broadcast(triangle.v0.x);
+  V v0y = V::broadcast(triangle.v0.y);
+  V v0z = V::broadcast(triangle.v0.z);
+  V e1x = V::broadcast(triangle.v1.x - triangle.v0.x);
+  V e1y = V::broadcast(triangle.v1.y - triangle.v0.y);
+  V e1z = V::broadcast(triangle.v1.z - triangle.v0.z);
+  V e2x = V::broadcast(triangle.v2.x - triangle.v0.x);
+  V e2y = V::broadcast(triangle.v2.y - triangle.v0.y);
+  V e2z = V::broadcast(triangle.v2.z - triangle.v0.z);
+
+  V px = rays.directionY * e2z - e2y * rays.directionZ;
+  V py = rays.directionZ * e2x - e2z * rays.directionX;
+  V pz = rays.directionX * e2y - e2x * rays.directionY;
+  V d = e1x * px + e1y * py + e1z * pz;
+  typename V::Mask miss = abs(d) < V::broadcast(0.000000001f);
+
+  V invD = V::broadcast(1.0f) / d;
+  V tx = rays.originX - v0x;
+  V ty = rays.originY - v0y;
+  V tz = rays.originZ - v0z;
+  V u = (tx * px + ty * py + tz * pz) * invD;
+  miss = miss | (u < V::broadcast(0.0f)) | (u > V::broadcast(1.0f));
+
+  V qx = ty * e1z - e1y * tz;
+  V qy = tz * e1x - e1z * tx;
+  V qz = tx * e1y - e1x * ty;
+  V v = (rays.directionX * qx + rays.directionY * qy + rays.directionZ * qz) *
+        invD;
+  miss = miss | (v < V::broadcast(0.0f)) | (u + v > V::broadcast(1.0f));
+
+  t = (e2x * qx + e2y * qy + e2z * qz) * invD;
+  miss = miss | (t < rays.tMin) | (t > closest);
+  return !miss;
+}
+
+// Smallest entry distance of the lanes that hit a box
+template <typename V>
+float nearestEntry(const typename V::Mask &hit, const V &tEnter) {
+  alignas(32) float values[V::WIDTH];
+  select(hit, tEnter, V::broadcast(PACKET_INFINITY)).store(values);
+  float nearest = values[0];
+  for (int i = 1; i < V::WIDTH; i++) {
+    nearest = values[i] < nearest ? values[i] : nearest;
+  }
+  return nearest;
+}
+
+// Trace V::WIDTH rays of the packet starting at lane first
+template <typename V>
+void intersectPacketLanes(const BvhNode *nodes, const BvhTriangle *triangles,
+                          RayPacket &packet, int first) {
+  PacketLanes<V> rays;
+  rays.originX = V::load(packet.originX + first);
+  rays.originY = V::load(packet.originY + first);
+  rays.originZ = V::load(packet.originZ + first);
+  rays.directionX = V::load(packet.directionX + first);
+  rays.directionY = V::load(packet.directionY + first);
+  rays.directionZ = V::load(packet.directionZ + first);
+  rays.invDirectionX = V::broadcast(1.0f) / rays.directionX;
+  rays.invDirectionY = V::broadcast(1.0f) / rays.directionY;
+  rays.invDirectionZ = V::broadcast(1.0f) / rays.directionZ;
+  rays.tMin = V::broadcast(packet.tMin);
+  V closest = V::load(packet.tMax + first);
+  for (int i = 0; i < V::WIDTH; i++) {
+    packet.triangle[first + i] = RayPacket::INVALID_TRIANGLE;
+  }
+
+  // The rays of the packet that hit all boxes on the way to the current node
+  V tEnter;
+  typename V::Mask active = boxHit(rays, nodes[0], closest, tEnter);
+  if (!active.bits()) {
+    return;
+  }
+
+  uint32_t stack[PACKET_STACK_SIZE];
+  typename V::Mask stackActive[PACKET_STACK_SIZE];
+  int stackSize = 0;
+  uint32_t nodeIndex = 0;
+  while (true) {
+    const BvhNode &node = nodes[nodeIndex];
+    if (node.count > 0) {
+      for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+        V t;
+        typename V::Mask hit =
+            triangleHit(rays, triangles[i], closest, t) & active;
+        int bits = hit.bits();
+        if (bits) {
+          closest = select(hit, t, closest);
+          for (int lane = 0; lane < V::WIDTH; lane++) {
+            if (bits & (1 << lane)) {
+              packet.triangle[first + lane] = i;
+            }
+          }
+        }
+      }
+    } else {
+      uint32_t nearChild = nodeIndex + 1;
+      uint32_t farChild = node.offset;
+      V tNear, tFar;
+      typename V::Mask hitNear =
+          boxHit(rays, nodes[nearChild], closest, tNear) & active;
+      typename V::Mask hitFar =
+          boxHit(rays, nodes[farChild], closest, tFar) & active;
+      bool anyNear = hitNear.bits() != 0;
+      bool anyFar = hitFar.bits() != 0;
+      if (anyNear && anyFar) {
+        // Visit the child that the packet enters first
+        if (nearestEntry(hitFar, tFar) < nearestEntry(hitNear, tNear)) {
+          uint32_t tempChild = nearChild;
+          nearChild = farChild;
+          farChild = tempChild;
+          typename V::Mask tempHit = hitNear;
+          hitNear = hitFar;
+          hitFar = tempHit;
+        }
+        stack[stackSize] = farChild;
+        stackActive[stackSize] = hitFar;
+        stackSize++;
+        nodeIndex = nearChild;
+        active = hitNear;
+        continue;
+      } else if (anyNear) {
+        nodeIndex = nearChild;
+        active = hitNear;
+        continue;
+      } else if (anyFar) {
+        nodeIndex = farChild;
+        active = hitFar;
+        continue;
+      }
+    }
+
+    if (stackSize == 0) {
+      break;
+    }
+    stackSize--;
+    nodeIndex = stack[stackSize];
+    active = stackActive[stackSize];
+  }
+
+  closest.store(packet.tMax + first);
+}
+
+template <typename V>
+void intersectPacket(const BvhNode *nodes, const BvhTriangle *triangles,
+                     RayPacket &packet) {
+  for (int first = 0; first < RayPacket::SIZE; first += V::WIDTH) {
+    intersectPacketLanes<V>(nodes, triangles, packet, first);
+  }
+}
+}  // namespace odin
+#endif  // ODIN_PACKET_KERNEL_HPP
@@ -0,0 +1,76 @@
+#ifndef ODIN_PACKET_TRACER_HPP
+#define ODIN_PACKET_TRACER_HPP
+
+#include <cstdint>
+#include <limits>
+
+#include "renderer/bvh.hpp"
+
+namespace odin {
+// A group of rays that is traced through the BVH together, stored as
+// structure of arrays. Lanes that should not be traced have a negative tMax.
+// After tracing tMax holds the distance to the closest hit of every lane and
+// triangle the index of the hit triangle, or INVALID_TRIANGLE on a miss
+struct RayPacket {
+  static const int SIZE = 8;
+  static const uint32_t INVALID_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+  alignas(32) float originX[SIZE];
+  alignas(32) float originY[SIZE];
+  alignas(32) float originZ[SIZE];
+  alignas(32) float directionX[SIZE];
+  alignas(32) float directionY[SIZE];
+  alignas(32) float directionZ[SIZE];
+  alignas(32) float tMax[SIZE];
+  uint32_t triangle[SIZE];
+  float tMin = 0.0f;
+};
+
+// The instruction sets the packet traversal can be compiled for
+enum class PacketIsa {
+  Auto,    // The widest one supported by the CPU
+  Scalar,  // One ray at a time, works everywhere
+  Sse,     // Four rays per instruction
+  Avx2     // Eight rays per instruction
+};
+
+/**
+ * Traces packets of coherent rays such as camera rays through the binary
+ * BVH. A node is visited if any ray of the packet hits it, and the slab test
+ * as well as the Moeller-Trumbore test of triangle_hit in
+ * shaders/include/traversal.glsl are evaluated for all rays at once. The
+ * implementation is picked at runtime from the instruction sets of the CPU
+ */
+class PacketTracer {
+ public:
+  explicit PacketTracer(const BVH &bvh, PacketIsa isa = PacketIsa::Auto);
+
+  const char *getIsaName() const;
+
+  void intersect(RayPacket &packet) const;
+
+  static bool isSupported(PacketIsa isa);
+
+ private:
+  using IntersectFunction = void (*)(const BvhNode *, const BvhTriangle *,
+                                     RayPacket &);
+
+  const BVH &bvh;
+  PacketIsa isa;
+  IntersectFunction intersectFunction;
+};
+
+// Implementations for the different instruction sets. Each one is compiled
+// in its own translation unit with the matching compiler flags. The
+// Available functions return false if the compiler could not target the
+// instruction set
+void intersectPacketScalar(const BvhNode *nodes, const BvhTriangle *triangles,
+                           RayPacket &packet);
+bool packetSseAvailable();
+void intersectPacketSse(const BvhNode *nodes, const BvhTriangle *triangles,
+                        RayPacket &packet);
+bool packetAvx2Available();
+void intersectPacketAvx2(const BvhNode *nodes, const BvhTriangle *triangles,
+                         RayPacket &packet);
+}  // namespace odin
+#endif  // ODIN_PACKET_TRACER_HPP
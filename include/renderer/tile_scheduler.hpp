@@ -0,0 +1,52 @@
+#ifndef ODIN_TILE_SCHEDULER_HPP
+#define ODIN_TILE_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace odin {
+// A rectangle of the output image rendered by one dispatch
+struct ComputeTile {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+/**
+ * Splits a frame of the compute shader into tiles and decides how many of
+ * them go into the next submission. The GPU time of every submission is fed
+ * back, so the batches grow or shrink to stay within the budget of a frame.
+ * This keeps single submissions short even for expensive settings. A budget
+ * of 0 dispatches the whole frame at once
+ */
+class TileScheduler {
+ public:
+  // Work groups of shaders/shader.comp that do not divide it are clipped to
+  // the tile by the shader
+  static const uint32_t TILE_SIZE = 128;
+
+  TileScheduler(uint32_t width, uint32_t height, float frameBudget);
+
+  // Fill batch with the tiles of the next submission. Returns true if they
+  // are the last tiles of the current frame
+  bool nextBatch(std::vector<ComputeTile> &batch);
+
+  // Report the GPU time in milliseconds it took to render numTiles tiles
+  void reportTime(size_t numTiles, float time);
+
+  // Start over with the first tile, e.g. after the camera moved
+  void restart();
+
+  size_t getTileCount() const;
+
+ private:
+  std::vector<ComputeTile> tiles;
+  size_t nextTile = 0;
+  float frameBudget;
+  // Running average of the milliseconds per tile. 0 until the first report
+  float tileTime = 0.0f;
+};
+}  // namespace odin
+#endif  // ODIN_TILE_SCHEDULER_HPP
\ No newline at end of file
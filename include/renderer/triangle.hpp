@@ -1,7 +1,6 @@
 #ifndef ODIN_TRIANGLE_HPP
 #define ODIN_TRIANGLE_HPP
 
-#include <exception>
 #include <glm/glm.hpp>
 
 #include "renderer/aabb.hpp"
@@ -43,46 +42,5 @@ struct Triangle {
     return AABB{min, max};
   }
 };
-
-// The following structs are used in the BVH construction
-// to properly sort the triangles for the BVH
-struct CompareX {
-  bool operator()(Triangle a, Triangle b) {
-    AABB box_left, box_right;
-    if (!a.boundingBox(box_left) || !b.boundingBox(box_right)) {
-      throw std::runtime_error("No bounding box in BVH node constructor!");
-    }
-    if (box_left.min.x - box_right.min.x < 0.0f) {
-      return -1;
-    }
-    return 1;
-  }
-};
-
-struct CompareY {
-  bool operator()(Triangle a, Triangle b) {
-    AABB box_left, box_right;
-    if (!a.boundingBox(box_left) || !b.boundingBox(box_right)) {
-      throw std::runtime_error("No bounding box in BVH node constructor!");
-    }
-    if (box_left.min.y - box_right.min.y < 0.0f) {
-      return -1;
-    }
-    return 1;
-  }
-};
-
-struct CompareZ {
-  bool operator()(Triangle a, Triangle b) {
-    AABB box_left, box_right;
-    if (!a.boundingBox(box_left) || !b.boundingBox(box_right)) {
-      throw std::runtime_error("No bounding box in BVH node constructor!");
-    }
-    if (box_left.min.z - box_right.min.z < 0.0f) {
-      return -1;
-    }
-    return 1;
-  }
-};
 } // namespace odin
 #endif // ODIN_TRIANGLE_HPP
\ No newline at end of file
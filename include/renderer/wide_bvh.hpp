@@ -0,0 +1,53 @@
+#ifndef ODIN_WIDE_BVH_HPP
+#define ODIN_WIDE_BVH_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "renderer/bvh.hpp"
+
+namespace odin {
+/**
+ * A BVH with 4 or 8 children per node that is collapsed from a binary BVH.
+ * The bounds of all children of a node are stored as structure of arrays so
+ * that a ray can be tested against four children with a single vector slab
+ * test. Every node consists of eight fields, each holding width 32 bit
+ * values:
+ *
+ *   minX, minY, minZ, maxX, maxY, maxZ, child, count
+ *
+ * A child with a count of zero is an interior node and child is its node
+ * index. Otherwise it is a leaf holding count triangles of BVH::triangles
+ * starting at child. Unused children have an empty box that is never hit.
+ * The layout has to match the wide traversal in
+ * shaders/include/traversal.glsl
+ */
+struct WideBVH {
+  // Size of the traversal stack. Has to match BVH_STACK_SIZE in
+  // shaders/include/traversal.glsl
+  static const int STACK_SIZE = 64;
+
+  int width = 4;
+  size_t numNodes = 0;
+  std::vector<float> nodes;
+
+public:
+  void init(const BVH &bvh, int width);
+
+private:
+  enum Field { MIN_X, MIN_Y, MIN_Z, MAX_X, MAX_Y, MAX_Z, CHILD, COUNT };
+
+  uint32_t addNode();
+
+  int collapseNode(const BVH &bvh, uint32_t binaryIndex, uint32_t wideIndex);
+
+  void setChild(uint32_t wideIndex, int slot, const BvhNode &node,
+                uint32_t child, uint32_t count);
+
+  float *field(uint32_t wideIndex, Field field);
+};
+} // namespace odin
+#endif // ODIN_WIDE_BVH_HPP
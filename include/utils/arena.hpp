@@ -0,0 +1,63 @@
+#ifndef ODIN_ARENA_HPP
+#define ODIN_ARENA_HPP
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace odin {
+/**
+ * A linear allocator that hands out pieces of a single block of memory.
+ * Nothing is freed individually. All allocations are released at once when
+ * the arena is reset or destroyed, so it only holds trivial types
+ */
+class Arena {
+ public:
+  // Every allocation starts on its own cache line
+  static const size_t ALIGNMENT = 64;
+
+  explicit Arena(size_t capacity)
+      : storage(new char[capacity + ALIGNMENT]), capacity(capacity),
+        offset(0) {
+    auto address = reinterpret_cast<uintptr_t>(storage.get());
+    base = storage.get() + (ALIGNMENT - address % ALIGNMENT) % ALIGNMENT;
+  }
+
+  // Number of bytes an allocation of count elements takes up in the arena
+  template <typename T>
+  static size_t requiredSize(size_t count) {
+    return (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  // Returns uninitialized memory for count elements
+  template <typename T>
+  T *allocate(size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_trivially_destructible<T>::value,
+                  "Arenas can only hold trivial types");
+
+    size_t size = requiredSize<T>(count);
+    if (size > capacity - offset) {
+      throw std::runtime_error("Arena is out of memory!");
+    }
+
+    T *memory = reinterpret_cast<T *>(base + offset);
+    offset += size;
+    return memory;
+  }
+
+  void reset() { offset = 0; }
+
+  size_t getCapacity() const { return capacity; }
+
+  size_t getUsedSize() const { return offset; }
+
+ private:
+  std::unique_ptr<char[]> storage;
+  char *base;
+  size_t capacity;
+  size_t offset;
+};
+}  // namespace odin
+#endif  // ODIN_ARENA_HPP
@@ -0,0 +1,19 @@
+#ifndef ODIN_IMAGE_WRITER_HPP
+#define ODIN_IMAGE_WRITER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace odin {
+class ImageWriter {
+ public:
+  // Write RGBA8 pixels with the first row at the top of the image
+  static void writePng(const std::string &filename, uint32_t width,
+                       uint32_t height, const std::vector<uint8_t> &pixels);
+
+ private:
+  ImageWriter();
+};
+}  // namespace odin
+#endif  // ODIN_IMAGE_WRITER_HPP
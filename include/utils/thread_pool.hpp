@@ -0,0 +1,89 @@
+#ifndef ODIN_THREAD_POOL_HPP
+#define ODIN_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace odin {
+/**
+ * A pool of worker threads with one task queue per worker. Workers pop
+ * tasks from the back of their own queue and steal from the front of the
+ * other queues once they run out of work. Tasks that are submitted from
+ * a worker land on that worker's queue, which keeps recursively spawned
+ * work local to the thread that created it
+ */
+class ThreadPool {
+ public:
+  // Creates a pool with the given number of workers. Passing zero uses
+  // one worker per hardware thread
+  explicit ThreadPool(unsigned numThreads = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t getThreadCount() const;
+
+  void submit(std::function<void()> task);
+
+  // Runs a single queued task on the calling thread if there is one
+  bool tryRunTask();
+
+ private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  size_t currentQueue() const;
+
+  bool popTask(size_t queueIndex, std::function<void()> &task);
+
+  void workerLoop(size_t workerIndex);
+
+  // One queue per worker plus a shared queue for threads outside the pool
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> workers;
+
+  std::atomic<size_t> queuedTasks;
+  std::atomic<bool> running;
+  std::mutex sleepMutex;
+  std::condition_variable sleepCondition;
+
+  static thread_local const ThreadPool *currentPool;
+  static thread_local size_t currentWorker;
+};
+
+/**
+ * Tracks a set of tasks submitted to a ThreadPool. Waiting on the group
+ * executes queued tasks on the waiting thread, so tasks are allowed to wait
+ * on the tasks they spawned without blocking a worker. The first exception
+ * thrown by a task is rethrown from wait()
+ */
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool &pool);
+
+  ~TaskGroup();
+
+  void run(std::function<void()> task);
+
+  void wait();
+
+ private:
+  ThreadPool &pool;
+  std::atomic<size_t> pendingTasks;
+  std::mutex exceptionMutex;
+  std::exception_ptr exception;
+};
+}  // namespace odin
+#endif  // ODIN_THREAD_POOL_HPP
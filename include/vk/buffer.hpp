@@ -6,9 +6,11 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include "vk/command_pool.hpp"
 #include "vk/device_manager.hpp"
+#include "vk/memory_allocator.hpp"
 
 namespace odin {
 // Forward declarations
@@ -20,23 +22,18 @@ class Buffer {
                                  uint32_t typeFilter,
                                  VkMemoryPropertyFlags properties);
 
+  // Creates the buffer and binds it to memory sub-allocated from the
+  // allocator of the device manager, which also frees it again. Buffers
+  // used by more than one queue family are shared concurrently between them
   static void createBuffer(const DeviceManager& deviceManager,
                            VkDeviceSize size, VkBufferUsageFlags usageFlags,
                            VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                           VkDeviceMemory& bufferMemory);
+                           MemoryAllocation& bufferMemory,
+                           const std::vector<uint32_t>& queueFamilies = {});
 
  protected:
   Buffer();
 
-  void copyBuffer(const DeviceManager& deviceManager,
-                  const CommandPool& commandPool, VkBuffer srcBuffer,
-                  VkBuffer dstBuffer, VkDeviceSize size);
-
-  void createBuffer(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
-                    VkDeviceSize size, VkBufferUsageFlags usage,
-                    VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                    VkDeviceMemory& bufferMemory);
-
   VkBuffer buffer;
   VkDescriptorBufferInfo descriptor;
 };
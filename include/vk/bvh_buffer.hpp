@@ -8,29 +8,63 @@
 #include <vector>
 
 #include "renderer/bvh.hpp"
+#include "renderer/kd_tree.hpp"
+#include "renderer/wide_bvh.hpp"
 #include "vk/buffer.hpp"
 #include "vk/device_manager.hpp"
+#include "vk/staging_ring.hpp"
 
 namespace odin {
-// Forward declarations
-class CommandPool;
-
+// Uploads the nodes of an acceleration structure and the triangles its leaves
+// reference into two separate storage buffers. The nodes are either the
+// binary nodes of the BVH, the nodes of the wide BVH collapsed from it or the
+// nodes of a k-d tree. The uploads go through the staging ring and are only
+// complete once it has been waited for
 class BvhBuffer : public Buffer {
  public:
-  BvhBuffer(const DeviceManager &deviceManager, const CommandPool &commandPool,
-            const std::vector<BvhNode> &nodes);
+  BvhBuffer(const DeviceManager &deviceManager, StagingRing &stagingRing,
+            const BVH &bvh);
+
+  BvhBuffer(const DeviceManager &deviceManager, StagingRing &stagingRing,
+            const BVH &bvh, const WideBVH &wideBvh);
+
+  BvhBuffer(const DeviceManager &deviceManager, StagingRing &stagingRing,
+            const KdTree &kdTree);
 
   const VkBuffer getBuffer() const;
 
-  const VkDeviceMemory getBufferMemory() const;
+  const MemoryAllocation &getBufferMemory() const;
 
   const VkDescriptorBufferInfo getDescriptor() const;
 
   const size_t getNodeCount() const;
 
+  const VkBuffer getTriangleBuffer() const;
+
+  const MemoryAllocation &getTriangleBufferMemory() const;
+
+  const VkDescriptorBufferInfo getTriangleDescriptor() const;
+
+  const size_t getTriangleCount() const;
+
  private:
-  VkDeviceMemory bvhBufferMemory;
+  void uploadBuffers(const DeviceManager &deviceManager,
+                     StagingRing &stagingRing, const void *nodeData,
+                     VkDeviceSize nodeDataSize,
+                     const std::vector<BvhTriangle> &triangles);
+
+  void uploadBuffer(const DeviceManager &deviceManager,
+                    StagingRing &stagingRing, const void *data,
+                    VkDeviceSize bufferSize, VkBuffer &deviceBuffer,
+                    MemoryAllocation &deviceBufferMemory);
+
+  MemoryAllocation bvhBufferMemory;
   size_t numNodes;
+
+  VkBuffer triangleBuffer;
+  MemoryAllocation triangleBufferMemory;
+  VkDescriptorBufferInfo triangleDescriptor;
+  size_t numTriangles;
 };
 }  // namespace odin
 #endif  // ODIN_BVH_BUFFER_HPP
\ No newline at end of file
@@ -6,9 +6,11 @@
 
 #include <array>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include "renderer/tile_scheduler.hpp"
 #include "vk/device_manager.hpp"
 #include "vk/render_pass.hpp"
 #include "vk/swapchain.hpp"
@@ -20,36 +22,42 @@ class ComputePipeline;
 class DescriptorPool;
 class GraphicsPipeline;
 class TextureImage;
-
+class TimestampQuery;
+class WavefrontPipeline;
+
+// Without a graphics queue family (headless rendering) only the compute pool
+// is created, and transient commands are submitted to the compute queue.
+// Every frame slot has its own compute command buffer, so one slot can be
+// recorded while the others are still executing. One-shot work such as
+// layout transitions and copies is recorded into transient command buffers,
+// which are recycled once their fence has signaled
 class CommandPool {
  public:
   CommandPool(const VkDevice& logicalDevice,
-              const odin::QueueFamilyIndices& queueFamilyIndices);
-
-  const VkCommandBuffer beginSingleTimeCommands(
-      const VkDevice& logicalDevice) const;
+              const odin::QueueFamilyIndices& queueFamilyIndices,
+              uint32_t numSlots = 1);
 
-  void createComputeCommandBuffers(const VkDevice& logicalDevice,
-                                   const RenderPass& renderPass,
-                                   const ComputePipeline& computePipeline,
-                                   const DescriptorPool& descriptorPool,
-                                   uint32_t texWidth, uint32_t texHeight);
+  // Command buffer that one-shot work is recorded into. Work of several
+  // callers goes into the same command buffer until it is submitted
+  const VkCommandBuffer beginTransientCommands(const VkDevice& logicalDevice);
 
-  void createGraphicsCommandBuffers(const VkDevice& logicalDevice,
-                                    const RenderPass& renderPass,
-                                    const GraphicsPipeline& graphicsPipeline,
-                                    const DescriptorPool& descriptorPool,
-                                    const Swapchain& swapChain,
-                                    const TextureImage& texture);
+  // Wait for the transient command buffers and destroy their fences and pool
+  void cleanupTransientCommands(const VkDevice& logicalDevice);
 
-  void endSingleTimeCommands(const DeviceManager& deviceManager,
-                             VkCommandBuffer commandBuffer) const;
+  // One command buffer per frame slot and swap chain image, drawing the
+  // output image of the slot
+  void createGraphicsCommandBuffers(
+      const VkDevice& logicalDevice, const RenderPass& renderPass,
+      const GraphicsPipeline& graphicsPipeline,
+      const DescriptorPool& descriptorPool, const Swapchain& swapChain,
+      const std::vector<std::unique_ptr<TextureImage>>& outputImages);
 
-  const VkCommandBuffer* getComputeCommandBuffer() const;
+  const VkCommandBuffer* getComputeCommandBuffer(uint32_t slot = 0) const;
 
   const VkCommandPool getComputeCommandPool() const;
 
-  const VkCommandBuffer* getGraphicsCommandBuffer(uint32_t bufferIndex) const;
+  const VkCommandBuffer* getGraphicsCommandBuffer(uint32_t slot,
+                                                  uint32_t imageIndex) const;
 
   const std::vector<VkCommandBuffer> getGraphicsCommandBuffers() const;
 
@@ -57,12 +65,50 @@ class CommandPool {
 
   const VkCommandPool getGraphicsCommandPool() const;
 
+  // Record one dispatch per tile into the compute command buffer of a slot.
+  // It can only be recorded again after the previous submission of the slot
+  // has finished. With a wavefront pipeline its stages are recorded for every
+  // tile instead. The frame values of frameConstants are pushed with every
+  // dispatch. Given a previous image, it is first copied to the output
+  // image, so that the tiles outside of the batch keep their latest samples
+  void recordComputeCommandBuffer(
+      uint32_t slot, const ComputePipeline& computePipeline,
+      const DescriptorPool& descriptorPool,
+      const std::vector<ComputeTile>& tiles,
+      const ComputePushConstants& frameConstants,
+      const TimestampQuery& timestampQuery,
+      const WavefrontPipeline* wavefrontPipeline = nullptr,
+      const TextureImage* previousImage = nullptr,
+      const TextureImage* outputImage = nullptr);
+
+  // Submit the transient commands recorded so far without waiting for them
+  void submitTransientCommands(const DeviceManager& deviceManager);
+
+  // Submit the transient commands and wait until all of them have finished
+  void waitTransientCommands(const DeviceManager& deviceManager);
+
  private:
-  const uint32_t WORK_GROUP_SIZE = 16;
+  const VkQueue getTransientQueue(const DeviceManager& deviceManager) const;
+
+  // Copy an output image to another one between compute dispatches
+  void recordImageCopy(VkCommandBuffer commandBuffer,
+                       const TextureImage& source,
+                       const TextureImage& destination) const;
+
   VkCommandPool computeCommandPool;
-  VkCommandPool graphicsCommandPool;
-  VkCommandBuffer computeCommandBuffer;
+  VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+  std::vector<VkCommandBuffer> computeCommandBuffers;
+  // Ordered by slot, then by swap chain image
   std::vector<VkCommandBuffer> graphicsCommandBuffers;
+  uint32_t numImages = 0;
+
+  VkCommandPool transientCommandPool;
+  std::vector<VkCommandBuffer> transientCommandBuffers;
+  // Signaled once the last submission of the command buffer has finished
+  std::vector<VkFence> transientFences;
+  // Command buffer that is currently recorded
+  size_t transientIndex = 0;
+  bool recordingTransient = false;
 };
 }  // namespace odin
 #endif  // ODIN_COMMAND_POOL_HPP
\ No newline at end of file
@@ -4,6 +4,9 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -14,23 +17,77 @@
 #include "vk/shader_module.hpp"
 
 namespace odin {
+// Acceleration structures the compute shader can traverse. The values have
+// to match the ACCELERATION_* constants in shaders/include/traversal.glsl
+enum class AccelerationStructure : uint32_t { Bvh = 0, KdTree = 1 };
+
+// Values for the specialization constants of the compute shaders. The
+// constant_id of every value is listed next to it and has to match the
+// declarations in shaders/include/traversal.glsl, common.glsl and
+// extend.glsl, shaders/wavefront_shade.comp and shaders/shader.comp
+struct ComputeSpecialization {
+  uint32_t bvhWidth = 2;  // constant_id = 0. Children per BVH node: 2, 4 or 8
+  uint32_t accelerationStructure = 0;  // constant_id = 1
+  // constant_id = 2. Material shaded by a wavefront shading kernel, one of
+  // the material ids of shaders/include/common.glsl
+  int32_t material = 1;
+  // constant_id = 3. Set for the extension kernels when the sorting stage
+  // reorders the rays of the secondary bounces
+  VkBool32 sortedRays = VK_FALSE;
+  // constant_id = 4. Samples per pixel that every frame adds
+  uint32_t numSamples = 16;
+  // constant_id = 5. Most bounces of a path. The counters of the wavefront
+  // kernels only have room for the default
+  uint32_t numBounces = 3;
+  // constant_id = 6 and 7. Work group size of the megakernel
+  uint32_t workGroupWidth = 16;
+  uint32_t workGroupHeight = 16;
+};
+
+// Values pushed before every dispatch. Has to match the push_constant blocks
+// of shaders/shader.comp and shaders/include/wavefront.glsl. The megakernel
+// does not read the bounce
+struct ComputePushConstants {
+  // First pixel of the tile the dispatch renders
+  uint32_t tileOffsetX;
+  uint32_t tileOffsetY;
+  uint32_t tileWidth;
+  uint32_t tileHeight;
+  // Bounce of the paths a wavefront stage works on
+  uint32_t bounce;
+  // Frames accumulated since the camera last moved
+  uint32_t frameIndex;
+  // Index of the first sample of the frame, so every frame draws different
+  // samples
+  uint32_t sampleSeed;
+};
+
 class ComputePipeline {
  public:
   ComputePipeline(const DeviceManager& deviceManager,
                   const DescriptorSetLayout& descriptorSetLayout,
-                  const std::string& computeShaderPath);
+                  const std::string& computeShaderPath,
+                  const ComputeSpecialization& specialization =
+                      ComputeSpecialization());
+
+  // Destroy the pipeline and its layout
+  void cleanup(const DeviceManager& deviceManager);
 
   const VkPipeline getComputePipeline() const;
 
   const VkPipelineLayout getPipelineLayout() const;
 
+  const ComputeSpecialization& getSpecialization() const;
+
  private:
   void createPipeline(const DeviceManager& deviceManager,
                       const DescriptorSetLayout& descriptorSetLayout,
-                      const std::string& computeShaderPath);
+                      const std::string& computeShaderPath,
+                      const ComputeSpecialization& specialization);
 
   VkPipeline computePipeline;
   VkPipelineLayout pipelineLayout;
+  ComputeSpecialization specialization;
 };
 }  // namespace odin
 #endif  // ODIN_COMPUTE_PIPELINE_HPP
\ No newline at end of file
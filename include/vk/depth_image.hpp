@@ -18,10 +18,10 @@ class CommandPool;
 
 class DepthImage : Image {
  public:
-  DepthImage(const DeviceManager& deviceManager, const CommandPool& commandPool,
+  DepthImage(const DeviceManager& deviceManager, CommandPool& commandPool,
              const Swapchain& swapChain);
 
-  const VkDeviceMemory getDeviceMemory() const;
+  const MemoryAllocation& getDeviceMemory() const;
 
   const VkImage getImage() const;
 
@@ -31,7 +31,7 @@ class DepthImage : Image {
 
  private:
   void createDepthResources(const DeviceManager& deviceManager,
-                            const CommandPool& commandPool,
+                            CommandPool& commandPool,
                             const Swapchain& swapChain);
 
   static VkFormat findSupportedFormat(const DeviceManager& deviceManager,
@@ -39,7 +39,7 @@ class DepthImage : Image {
                                       VkImageTiling tiling,
                                       VkFormatFeatureFlags features);
 
-  VkDeviceMemory depthImageMemory;
+  MemoryAllocation depthImageMemory;
   VkImageView depthImageView;
 };
 }  // namespace odin
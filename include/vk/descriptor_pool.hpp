@@ -7,6 +7,7 @@
 #include <array>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -19,40 +20,51 @@ namespace odin {
 
 class TextureImage;
 
+// Holds a compute and a graphics descriptor set per frame slot. The compute
+// set of a slot writes its output image, which its graphics set samples
 class DescriptorPool {
  public:
-  DescriptorPool(const DeviceManager& deviceManager, const Swapchain& swapChain,
+  // Slot i uses outputImages[i] and the buffers of bufferInfos[i]
+  DescriptorPool(
+      const DeviceManager& deviceManager, const Swapchain& swapChain,
+      const DescriptorSetLayout& computeDescriptorSetLayout,
+      const DescriptorSetLayout& graphicsDescriptorSetLayout,
+      const std::vector<std::unique_ptr<TextureImage>>& outputImages,
+      const TextureSampler& textureSampler,
+      const std::vector<std::vector<VkDescriptorBufferInfo>>& bufferInfos);
+
+  // Only creates the compute descriptor set, used for headless rendering
+  DescriptorPool(const DeviceManager& deviceManager,
                  const DescriptorSetLayout& computeDescriptorSetLayout,
-                 const DescriptorSetLayout& graphicsDescriptorSetLayout,
-                 const TextureImage& textureImage,
-                 const TextureSampler& textureSampler,
+                 const VkDescriptorImageInfo* outputImage,
                  const std::vector<VkDescriptorBufferInfo>& bufferInfos);
 
   const VkDescriptorPool getDescriptorPool() const;
 
-  const VkDescriptorSet* getComputeDescriptorSet() const;
+  const VkDescriptorSet* getComputeDescriptorSet(uint32_t slot = 0) const;
 
-  const VkDescriptorSet* getGraphicsDescriptorSet() const;
+  const VkDescriptorSet* getGraphicsDescriptorSet(uint32_t slot = 0) const;
 
  private:
-  void createComputeDescriptorSets(
+  void createComputeDescriptorSet(
       const DeviceManager& deviceManager,
       const DescriptorSetLayout& descriptorSetLayout,
-      const Swapchain& swapChain, const TextureImage& textureImage,
+      const VkDescriptorImageInfo* outputImage,
       const std::vector<VkDescriptorBufferInfo> bufferInfos);
 
   void createDescriptorPool(const DeviceManager& deviceManager,
-                            const Swapchain& swapChain);
+                            uint32_t numSlots);
 
-  void createGraphicsDescriptorSets(
+  void createGraphicsDescriptorSet(
       const DeviceManager& deviceManager,
       const DescriptorSetLayout& descriptorSetLayout,
       const TextureImage& textureImage, const TextureSampler& textureSampler);
 
-  const uint32_t BUFFER_DESCRIPTORS = 2;
+  const uint32_t BUFFER_DESCRIPTORS = 4;
+  const uint32_t WAVEFRONT_DESCRIPTORS = 5;
   VkDescriptorPool descriptorPool;
-  VkDescriptorSet computeDescriptorSet;
-  VkDescriptorSet graphicsDescriptorSet;
+  std::vector<VkDescriptorSet> computeDescriptorSets;
+  std::vector<VkDescriptorSet> graphicsDescriptorSets;
 };
 }  // namespace odin
 #endif  // ODIN_DESCRIPTOR_POOL_HPP
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <array>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include "vk/device_manager.hpp"
 
@@ -4,6 +4,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -11,6 +12,8 @@
 #include <vector>
 
 #include "vk/instance.hpp"
+#include "vk/memory_allocator.hpp"
+#include "vk/pipeline_cache.hpp"
 
 namespace odin {
 
@@ -20,11 +23,17 @@ struct QueueFamilyIndices {
   std::optional<uint32_t> computeFamily;
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  // Only set for a family without graphics and compute support, which is
+  // usually a DMA engine that uploads alongside the other queues
+  std::optional<uint32_t> transferFamily;
 
   bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value() &&
            computeFamily.has_value();
   }
+
+  // Headless rendering only needs a compute queue
+  bool isComputeComplete() { return computeFamily.has_value(); }
 };
 
 struct SwapChainSupportDetails {
@@ -33,10 +42,14 @@ struct SwapChainSupportDetails {
   std::vector<VkPresentModeKHR> presentModes;
 };
 
+// A device manager created without a surface (VK_NULL_HANDLE) is headless. It
+// only creates a compute queue and does not enable the swapchain extension.
+// The pipeline cache is loaded from and saved to pipelineCacheDirectory
 class DeviceManager {
  public:
   DeviceManager(const Instance &instance, const VkSurfaceKHR &surface,
-                bool enableValidationLayers);
+                bool enableValidationLayers,
+                const std::string &pipelineCacheDirectory = "");
 
   QueueFamilyIndices findQueueFamilies(VkSurfaceKHR surface);
 
@@ -46,21 +59,31 @@ class DeviceManager {
 
   const VkDevice getLogicalDevice() const;
 
+  // Sub-allocates the memory of all buffers and images of the device
+  MemoryAllocator &getMemoryAllocator() const;
+
   const uint32_t getMemoryType(uint32_t typeBits,
                                VkMemoryPropertyFlags properties,
                                VkBool32 *memTypeFound = nullptr) const;
 
   const VkPhysicalDevice getPhysicalDevice() const;
 
+  // Shared by the creation of all pipelines of the device
+  PipelineCache &getPipelineCache() const;
+
   const VkQueue getPresentationQueue() const;
 
   SwapChainSupportDetails getSwapChainSupport() const;
 
+  // VK_NULL_HANDLE without a dedicated transfer queue family
+  const VkQueue getTransferQueue() const;
+
  private:
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 
   void createLogicalDevice(const Instance &instance, VkSurfaceKHR surface,
-                           bool enableValidationLayers);
+                           bool enableValidationLayers,
+                           const std::string &pipelineCacheDirectory);
 
   bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
 
@@ -79,9 +102,12 @@ class DeviceManager {
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   VkPhysicalDeviceMemoryProperties memoryProperties;
   VkDevice logicalDevice;
-  VkQueue graphicsQueue;
-  VkQueue presentQueue;
-  VkQueue computeQueue;
+  std::unique_ptr<MemoryAllocator> memoryAllocator;
+  std::unique_ptr<PipelineCache> pipelineCache;
+  VkQueue graphicsQueue = VK_NULL_HANDLE;
+  VkQueue presentQueue = VK_NULL_HANDLE;
+  VkQueue computeQueue = VK_NULL_HANDLE;
+  VkQueue transferQueue = VK_NULL_HANDLE;
 };
 }  // namespace odin
 #endif  // ODIN_DEVICE_MANAGER_HPP
\ No newline at end of file
@@ -16,8 +16,9 @@
 namespace odin {
 class GraphicsPipeline {
  public:
-  GraphicsPipeline(const VkDevice& logicalDevice, const Swapchain& swapChain,
-                   const RenderPass& renderPass,
+  GraphicsPipeline(const VkDevice& logicalDevice,
+                   const VkPipelineCache& pipelineCache,
+                   const Swapchain& swapChain, const RenderPass& renderPass,
                    const DescriptorSetLayout& descriptorSetLayout,
                    const std::string& vertexShaderPath,
                    const std::string& fragmentShaderPath);
@@ -27,8 +28,9 @@ class GraphicsPipeline {
   const VkPipelineLayout getPipelineLayout() const;
 
  private:
-  void createPipeline(const VkDevice& logicalDevice, const Swapchain& swapChain,
-                      const RenderPass& renderPass,
+  void createPipeline(const VkDevice& logicalDevice,
+                      const VkPipelineCache& pipelineCache,
+                      const Swapchain& swapChain, const RenderPass& renderPass,
                       const DescriptorSetLayout& descriptorSetLayout,
                       const std::string& vertexShaderPath,
                       const std::string& fragmentShaderPath);
@@ -9,6 +9,7 @@
 #include "vk/buffer.hpp"
 #include "vk/command_pool.hpp"
 #include "vk/device_manager.hpp"
+#include "vk/memory_allocator.hpp"
 
 namespace odin {
 class Image {
@@ -20,15 +21,19 @@ class Image {
     // create image resources
   }
 
+  // Binds the image to memory sub-allocated from the allocator of the device
+  // manager
   void createImage(const DeviceManager& deviceManager, uint32_t width,
                    uint32_t height, VkFormat format, VkImageTiling tiling,
                    VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                   VkImage& image, VkDeviceMemory& imageMemory);
+                   VkImage& image, MemoryAllocation& imageMemory);
 
   bool hasStencilComponent(const VkFormat& format);
 
+  // Records the transition into the transient commands of the command pool.
+  // It runs once they are submitted
   void transitionImageLayout(const DeviceManager& deviceManager,
-                             const CommandPool& commandPool, VkImage image,
+                             CommandPool& commandPool, VkImage image,
                              VkFormat format, VkImageAspectFlags aspectMask,
                              VkImageLayout oldLayout, VkImageLayout newLayout);
 
@@ -11,27 +11,25 @@
 
 #include "vk/buffer.hpp"
 #include "vk/device_manager.hpp"
+#include "vk/staging_ring.hpp"
 
 namespace odin {
 
-// forward declarations
-class CommandPool;
-
 class IndexBuffer : public Buffer {
  public:
   IndexBuffer(const DeviceManager& deviceManager,
-              const CommandPool& commandPool,
+              StagingRing& stagingRing,
               const std::vector<uint32_t>& indices);
 
   const VkBuffer getBuffer() const;
 
-  const VkDeviceMemory getBufferMemory() const;
+  const MemoryAllocation& getBufferMemory() const;
 
   const uint32_t getNumIndices() const;
 
  private:
   uint32_t numIndices;
-  VkDeviceMemory indexBufferMemory;
+  MemoryAllocation indexBufferMemory;
 };
 }  // namespace odin
 #endif  // ODIN_INDEX_BUFFER_HPP
\ No newline at end of file
@@ -11,12 +11,13 @@
 
 /**
  * Class that wraps a VkInstance and
- * provides access to various functionality to manage it
+ * provides access to various functionality to manage it. A headless instance
+ * does not enable the surface extensions of GLFW
  */
 namespace odin {
 class Instance {
  public:
-  Instance(bool enableValidationLayers);
+  Instance(bool enableValidationLayers, bool headless = false);
 
   ~Instance();
 
@@ -62,6 +63,7 @@ class Instance {
       "VK_LAYER_KHRONOS_validation"};
 
   bool enableValidationLayers;
+  bool headless;
 
   VkDebugUtilsMessengerEXT debugMessenger;
   VkInstance instance;
@@ -0,0 +1,96 @@
+#ifndef ODIN_MEMORY_ALLOCATOR_HPP
+#define ODIN_MEMORY_ALLOCATOR_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace odin {
+
+// Range of a memory block that a buffer or image is bound to
+struct MemoryAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  // Address of the range if the memory is host visible. A block can only be
+  // mapped once at a time, so host visible blocks stay mapped
+  void* mappedData = nullptr;
+  uint32_t memoryType = 0;
+  // Index of the block within the blocks of its memory type
+  uint32_t block = 0;
+};
+
+// Usage of the blocks of all memory types
+struct MemoryStats {
+  uint32_t blockCount = 0;
+  uint32_t allocationCount = 0;
+  VkDeviceSize blockBytes = 0;
+  VkDeviceSize usedBytes = 0;
+  // Many free ranges that are small compared to the free bytes mean that
+  // the blocks are fragmented
+  uint32_t freeRangeCount = 0;
+  VkDeviceSize largestFreeRange = 0;
+};
+
+/**
+ * Sub-allocates buffers and images from large blocks of device memory, so
+ * the number of vkAllocateMemory calls stays far below
+ * maxMemoryAllocationCount. Every memory type has its own blocks. A block
+ * keeps its free ranges ordered by offset. An allocation takes the first
+ * range that fits, and a freed range merges with its free neighbors.
+ * Resources larger than half a block get a dedicated block, which is
+ * released again when they are freed
+ */
+class MemoryAllocator {
+ public:
+  static const VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+
+  MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice);
+
+  MemoryAllocation allocate(const VkMemoryRequirements& requirements,
+                            VkMemoryPropertyFlags properties);
+
+  // Return the range of an allocation to its block
+  void free(const MemoryAllocation& allocation);
+
+  // Release all blocks. Has to be called before the device is destroyed
+  void cleanup();
+
+  MemoryStats getStats() const;
+
+ private:
+  struct Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mappedData = nullptr;
+    // Size of every free range by its offset
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+    uint32_t allocationCount = 0;
+    bool dedicated = false;
+  };
+
+  // Take an aligned range from the free ranges of a block
+  bool allocateRange(Block& block, VkDeviceSize size, VkDeviceSize alignment,
+                     VkDeviceSize& offset);
+
+  uint32_t createBlock(uint32_t memoryType, VkDeviceSize size,
+                       bool dedicated);
+
+  uint32_t findMemoryType(uint32_t typeBits,
+                          VkMemoryPropertyFlags properties) const;
+
+  VkDevice logicalDevice;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  // Linear buffers and optimal images in the same block have to be this far
+  // apart, so every allocation is aligned to it
+  VkDeviceSize bufferImageGranularity;
+  // Blocks of every memory type. Released dedicated blocks leave an empty
+  // entry, so the indices of the other blocks stay valid
+  std::vector<std::vector<Block>> blocks;
+};
+}  // namespace odin
+#endif  // ODIN_MEMORY_ALLOCATOR_HPP
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef ODIN_PIPELINE_CACHE_HPP
+#define ODIN_PIPELINE_CACHE_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace odin {
+/**
+ * Pipeline cache shared by the creation of all compute and graphics
+ * pipelines. It is loaded from the cache directory when the device is
+ * created and written back at exit, so the driver only compiles the
+ * pipelines that changed since the last run. Data written by another device
+ * or driver version is ignored. Without a cache directory the cache only
+ * lives as long as the device
+ */
+class PipelineCache {
+ public:
+  PipelineCache(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
+                const std::string& cacheDirectory);
+
+  // Destroy the cache. Has to be called before the device is destroyed
+  void cleanup();
+
+  // $XDG_CACHE_HOME/odin or ~/.cache/odin. Empty if neither is set
+  static std::string getDefaultDirectory();
+
+  const VkPipelineCache getPipelineCache() const;
+
+  // Write the cache to the cache directory
+  void save() const;
+
+ private:
+  // Written in front of the data of the driver. The header of the driver
+  // data identifies the device but not the version of its driver
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t driverVersion;
+    uint64_t dataSize;
+  };
+
+  static const uint32_t FILE_MAGIC = 0x4350444f;  // "ODPC"
+
+  // Check the header of the driver data against the device
+  bool isCompatible(const std::vector<char>& data) const;
+
+  // Data of the cache file, or nothing if there is none or it does not
+  // belong to this device and driver
+  std::vector<char> load() const;
+
+  VkDevice logicalDevice;
+  VkPhysicalDeviceProperties properties;
+  std::string cacheDirectory;
+  VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+};
+}  // namespace odin
+#endif  // ODIN_PIPELINE_CACHE_HPP
\ No newline at end of file
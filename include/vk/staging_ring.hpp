@@ -0,0 +1,74 @@
+#ifndef ODIN_STAGING_RING_HPP
+#define ODIN_STAGING_RING_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "vk/device_manager.hpp"
+#include "vk/memory_allocator.hpp"
+
+namespace odin {
+/**
+ * Uploads buffer contents through one persistently mapped staging buffer.
+ * The ring is split into a segment per batch. Uploads are copied into the
+ * segment of the current batch and recorded as copy commands, and a full
+ * batch is submitted without waiting for it. A batch is only reused once
+ * its fence has signaled. The copies run on the dedicated transfer queue if
+ * the device has one, so they overlap with the setup work on the CPU and
+ * with the other queues. Otherwise they fall back to the graphics queue, or
+ * to the compute queue when rendering headless
+ */
+class StagingRing {
+ public:
+  static const VkDeviceSize RING_SIZE = 32 * 1024 * 1024;
+  static const uint32_t NUM_BATCHES = 4;
+
+  StagingRing(const DeviceManager& deviceManager,
+              const QueueFamilyIndices& queueFamilyIndices,
+              VkDeviceSize size = RING_SIZE);
+
+  // Destroy the ring once all uploads have finished
+  void cleanup(const DeviceManager& deviceManager);
+
+  // Submit the copies recorded so far without waiting for them
+  void flush(const DeviceManager& deviceManager);
+
+  // Queue families that use the buffers written by the ring. Buffers used by
+  // more than one of them are created for concurrent sharing, so their
+  // ownership never has to be transferred between the queues
+  const std::vector<uint32_t>& getQueueFamilies() const;
+
+  // Copy data into the ring and record its copy to the destination buffer.
+  // The data can be released as soon as this returns
+  void upload(const DeviceManager& deviceManager, VkBuffer dstBuffer,
+              const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+  // Submit the remaining copies and wait until all of them have finished
+  void wait(const DeviceManager& deviceManager);
+
+ private:
+  // Start recording the current batch once its last submission finished
+  void beginBatch(const DeviceManager& deviceManager);
+
+  VkBuffer ringBuffer;
+  MemoryAllocation ringBufferMemory;
+  VkQueue queue;
+  VkCommandPool commandPool;
+  std::array<VkCommandBuffer, NUM_BATCHES> commandBuffers;
+  std::array<VkFence, NUM_BATCHES> fences;
+  std::vector<uint32_t> queueFamilies;
+
+  VkDeviceSize segmentSize;
+  // Bytes of the segment of the current batch that are already used
+  VkDeviceSize segmentOffset = 0;
+  uint32_t batch = 0;
+  bool recording = false;
+};
+}  // namespace odin
+#endif  // ODIN_STAGING_RING_HPP
\ No newline at end of file
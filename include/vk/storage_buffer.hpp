@@ -0,0 +1,33 @@
+#ifndef ODIN_STORAGE_BUFFER_HPP
+#define ODIN_STORAGE_BUFFER_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include "vk/buffer.hpp"
+
+namespace odin {
+// Device local buffer that the compute shader reads and writes, such as the
+// accumulation buffer. Its contents are undefined after creation. Buffers
+// with other uses as well, such as indirect dispatch arguments, pass those
+// in additionalUsage
+class StorageBuffer : public Buffer {
+ public:
+  StorageBuffer(const DeviceManager& deviceManager,
+                const VkDeviceSize bufferSize,
+                VkBufferUsageFlags additionalUsage = 0);
+
+  const VkBuffer getBuffer() const;
+
+  const VkDescriptorBufferInfo getDescriptor() const;
+
+  const MemoryAllocation& getDeviceMemory() const;
+
+ private:
+  MemoryAllocation storageBufferMemory;
+};
+}  // namespace odin
+#endif  // ODIN_STORAGE_BUFFER_HPP
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef ODIN_STORAGE_IMAGE_HPP
+#define ODIN_STORAGE_IMAGE_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "vk/buffer.hpp"
+#include "vk/command_pool.hpp"
+#include "vk/device_manager.hpp"
+#include "vk/image.hpp"
+
+namespace odin {
+/**
+ * Output image of the compute shader for headless rendering. Unlike the
+ * TextureImage it is not sampled by the graphics pipeline and needs no
+ * swapchain, but can be copied back to the host
+ */
+class StorageImage : Image {
+ public:
+  StorageImage(const DeviceManager& deviceManager,
+               CommandPool& commandPool, uint32_t width,
+               uint32_t height);
+
+  const VkDescriptorImageInfo* getDescriptor() const;
+
+  const uint32_t getHeight() const;
+
+  const VkImage getImage() const;
+
+  const MemoryAllocation& getImageMemory() const;
+
+  const VkImageView getImageView() const;
+
+  const uint32_t getWidth() const;
+
+  // Copy the image into RGBA8 pixels once the compute shader has finished
+  void readPixels(const DeviceManager& deviceManager,
+                  CommandPool& commandPool,
+                  std::vector<uint8_t>& pixels) const;
+
+ private:
+  void createImageView(const DeviceManager& deviceManager);
+
+  VkDescriptorImageInfo descriptor;
+  MemoryAllocation imageMemory;
+  VkImageView imageView;
+  uint32_t imageHeight;
+  uint32_t imageWidth;
+};
+}  // namespace odin
+#endif  // ODIN_STORAGE_IMAGE_HPP
\ No newline at end of file
@@ -19,7 +19,7 @@ namespace odin {
 class TextureImage : Image {
  public:
   TextureImage(const DeviceManager& deviceManager,
-               const CommandPool& commandPool, const Swapchain& swapChain,
+               CommandPool& commandPool, const Swapchain& swapChain,
                const TextureSampler& textureSampler, uint32_t width,
                uint32_t height);
 
@@ -29,7 +29,7 @@ class TextureImage : Image {
 
   const VkImage getTextureImage() const;
 
-  const VkDeviceMemory getTextureImageMemory() const;
+  const MemoryAllocation& getTextureImageMemory() const;
 
   const VkImageView getTextureImageView() const;
 
@@ -37,11 +37,11 @@ class TextureImage : Image {
 
  private:
   void copyBufferToImage(const DeviceManager& deviceManager,
-                         const CommandPool& commandPool, VkBuffer buffer,
+                         CommandPool& commandPool, VkBuffer buffer,
                          VkImage image, uint32_t width, uint32_t height);
 
   void createTextureImage(const DeviceManager& deviceManager,
-                          const CommandPool& commandPool, uint32_t width,
+                          CommandPool& commandPool, uint32_t width,
                           uint32_t height);
 
   void createTextureImageView(const DeviceManager& deviceManager,
@@ -50,7 +50,7 @@ class TextureImage : Image {
   bool hasStencilComponent(const VkFormat& format);
 
   VkDescriptorImageInfo descriptor;
-  VkDeviceMemory textureImageMemory;
+  MemoryAllocation textureImageMemory;
   VkImageView textureImageView;
   uint32_t imageHeight;
   uint32_t imageWidth;
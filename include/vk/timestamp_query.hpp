@@ -0,0 +1,53 @@
+#ifndef ODIN_TIMESTAMP_QUERY_HPP
+#define ODIN_TIMESTAMP_QUERY_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "vk/device_manager.hpp"
+
+namespace odin {
+// Measures the GPU time between points of a command buffer with pairs of
+// timestamp queries, one pair per measured range. Devices or queues without
+// timestamps report no support and the queries must not be written
+class TimestampQuery {
+ public:
+  TimestampQuery(const DeviceManager& deviceManager, uint32_t queueFamilyIndex,
+                 uint32_t numRanges = 1);
+
+  // Milliseconds between the start and end timestamps of a range. Only valid
+  // once the command buffer that wrote them has finished executing
+  float getElapsedTime(const DeviceManager& deviceManager,
+                       uint32_t range = 0) const;
+
+  const VkQueryPool getQueryPool() const;
+
+  bool isSupported() const;
+
+  // Reset the queries of all ranges. Has to be recorded outside of a render
+  // pass before the timestamps are written again
+  void reset(VkCommandBuffer commandBuffer) const;
+
+  // The timestamps are written once all previous commands have passed the
+  // given stage. Compute stages measure single dispatches more tightly than
+  // the defaults
+  void writeEnd(VkCommandBuffer commandBuffer, uint32_t range = 0,
+                VkPipelineStageFlagBits stage =
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT) const;
+
+  void writeStart(VkCommandBuffer commandBuffer, uint32_t range = 0,
+                  VkPipelineStageFlagBits stage =
+                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) const;
+
+ private:
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  uint32_t numRanges = 1;
+  // Nanoseconds per timestamp tick
+  float timestampPeriod = 0.0f;
+  uint64_t timestampMask = 0;
+};
+}  // namespace odin
+#endif  // ODIN_TIMESTAMP_QUERY_HPP
\ No newline at end of file
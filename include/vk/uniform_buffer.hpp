@@ -4,25 +4,37 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 #include "vk/buffer.hpp"
 
 namespace odin {
+// Host visible uniform buffer that stays mapped for its whole lifetime. It
+// holds a copy of its contents for every frame slot, so one slot can be
+// written while the GPU still reads the others
 class UniformBuffer : public Buffer {
  public:
   UniformBuffer(const DeviceManager& deviceManager,
-                const VkDeviceSize bufferSize);
+                const VkDeviceSize bufferSize, uint32_t numSlots = 1);
 
   const VkBuffer getBuffer() const;
 
-  const VkDescriptorBufferInfo getDescriptor() const;
+  // Descriptor of the copy of a slot
+  const VkDescriptorBufferInfo getDescriptor(uint32_t slot = 0) const;
 
-  const VkDeviceMemory getDeviceMemory() const;
+  const MemoryAllocation& getDeviceMemory() const;
+
+  // Copy data into a slot. The memory is coherent, so it needs no flush
+  void write(uint32_t slot, const void* data, VkDeviceSize size) const;
 
  private:
-  VkDeviceMemory uniformBufferMemory;
+  MemoryAllocation uniformBufferMemory;
+  // Distance between the copies of two slots, rounded up to the alignment
+  // of uniform buffer offsets
+  VkDeviceSize slotSize;
+  uint32_t numSlots;
 };
 }  // namespace odin
 #endif  // ODIN_UNIFORM_BUFFER_HPP
\ No newline at end of file
@@ -11,31 +11,29 @@
 #include "renderer/vertex.hpp"
 #include "vk/buffer.hpp"
 #include "vk/device_manager.hpp"
+#include "vk/staging_ring.hpp"
 
 // TODO Look into packing vertex data and vertex indices into one
 // VkBuffer object using offsets. This way the data is more cache coherent
 // and the driver can optimize better. Look into 'aliasing'.
 namespace odin {
 
-// Forward declarations
-class CommandPool;
-
 class VertexBuffer : public Buffer {
  public:
   VertexBuffer(const DeviceManager& deviceManager,
-               const CommandPool& commandPool,
+               StagingRing& stagingRing,
                const std::vector<Vertex>& vertices);
 
   const VkBuffer getBuffer() const;
 
-  const VkDeviceMemory getBufferMemory() const;
+  const MemoryAllocation& getBufferMemory() const;
 
   const VkDescriptorBufferInfo getDescriptor() const;
 
   const size_t getVertexCount() const;
 
  private:
-  VkDeviceMemory vertexBufferMemory;
+  MemoryAllocation vertexBufferMemory;
   size_t numVertices;
 };
 }  // namespace odin
@@ -0,0 +1,169 @@
+#ifndef ODIN_WAVEFRONT_PIPELINE_HPP
+#define ODIN_WAVEFRONT_PIPELINE_HPP
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "renderer/tile_scheduler.hpp"
+#include "vk/compute_pipeline.hpp"
+#include "vk/descriptor_set_layout.hpp"
+#include "vk/device_manager.hpp"
+#include "vk/storage_buffer.hpp"
+#include "vk/timestamp_query.hpp"
+
+namespace odin {
+
+// Forward declarations
+class DescriptorPool;
+
+// Lengths of the queues of the wavefront path tracer and the indirect
+// dispatch arguments of the stages that process them. Has to match the
+// Counters block of shaders/include/wavefront.glsl
+struct WavefrontCounters {
+  VkDispatchIndirectCommand extendArgs[2];
+  VkDispatchIndirectCommand shadeArgs[3];
+  uint32_t rayCount[2];
+  uint32_t materialCount[3];
+  // Next ray fetched by the persistent threads extension kernel
+  uint32_t fetchCount;
+  // Rays of every bounce over all tiles of a submission
+  uint32_t tracedRays[3];
+};
+
+// Rays the extension stage traced per bounce and the GPU milliseconds it
+// and the sorting stage before it took for them, summed over submissions
+struct WavefrontStats {
+  std::array<uint64_t, 3> rays = {};
+  std::array<double, 3> time = {};
+  std::array<double, 3> sortTime = {};
+};
+
+// Settings of the wavefront path tracer
+struct WavefrontOptions {
+  // Most tiles recorded into one submission
+  uint32_t maxTiles = 1;
+  // Submissions in flight at once. Every one has its own statistics
+  uint32_t numSlots = 1;
+  // Work groups of the persistent threads extension kernel, 0 disables it
+  uint32_t persistentGroups = 0;
+  // Sort the rays of the secondary bounces before extending them
+  bool sortRays = false;
+};
+
+/**
+ * Path tracer that splits the bounce loop of the megakernel into separate
+ * compute pipelines. A generation kernel starts a path for every sample of
+ * every pixel of a tile. For every bounce an extension kernel finds the
+ * closest hits of the queued rays and sorts the paths into a queue per
+ * material. A shading kernel specialized for each material then scatters
+ * them into the ray queue of the next bounce. A resolve kernel finally
+ * accumulates the light of the paths like the megakernel. The queues and
+ * their atomic counters live in storage buffers, and the extension and
+ * shading stages are dispatched indirectly with the lengths of their queues.
+ * With persistent threads a fixed number of extension work groups pull rays
+ * from the queue through an atomic counter instead. An optional sorting
+ * stage reorders the rays of the secondary bounces by direction and origin
+ * before they are extended
+ */
+class WavefrontPipeline {
+ public:
+  // Same values as shaders/include/wavefront.glsl and the default of
+  // NUM_BOUNCES, which sizes the traced ray counters
+  static const uint32_t GROUP_SIZE = 64;
+  static const uint32_t NUM_BOUNCES = 3;
+  static const uint32_t NUM_MATERIALS = 3;
+  // Same value as NUM_SORT_BINS of shaders/include/sort.glsl
+  static const uint32_t SORT_BINS = 32768;
+
+  WavefrontPipeline(const DeviceManager& deviceManager,
+                    const DescriptorSetLayout& descriptorSetLayout,
+                    const std::string& shaderDirectory,
+                    const ComputeSpecialization& specialization,
+                    uint32_t queueFamilyIndex,
+                    const WavefrontOptions& options);
+
+  // Add the rays and extension times of the last submission of numTiles
+  // tiles in a slot. Only valid once it has finished executing
+  void addStats(const DeviceManager& deviceManager, uint32_t slot,
+                size_t numTiles, WavefrontStats& stats) const;
+
+  // Destroy the pipelines and buffers once the device is idle
+  void cleanup(const DeviceManager& deviceManager);
+
+  // Descriptors of the path, queue, hit, counter and sort bin buffers for
+  // bindings 5 to 9 of the compute descriptor set
+  const std::vector<VkDescriptorBufferInfo> getDescriptors() const;
+
+  bool isPersistent() const;
+
+  bool isSorting() const;
+
+  // Record all stages for every tile with the descriptor set of a slot,
+  // followed by the copy of the ray counts that addStats reads. Tiles share
+  // the buffers, so their stages are separated by barriers. The frame values
+  // of frameConstants are pushed with every stage
+  void recordTiles(VkCommandBuffer commandBuffer,
+                   const DescriptorPool& descriptorPool, uint32_t slot,
+                   const std::vector<ComputeTile>& tiles,
+                   const ComputePushConstants& frameConstants) const;
+
+ private:
+  // Throw if the buffers of the paths of a tile do not fit the device, or
+  // the paths of a frame overflow the 32 bit counters of the kernels
+  void checkBufferSizes(const DeviceManager& deviceManager) const;
+
+  void recordBarrier(VkCommandBuffer commandBuffer) const;
+
+  void recordTile(VkCommandBuffer commandBuffer,
+                  const DescriptorPool& descriptorPool, uint32_t slot,
+                  const ComputeTile& tile, uint32_t tileIndex,
+                  const ComputePushConstants& frameConstants) const;
+
+  // Record the counting sort of the ray queue of a bounce into the sorted
+  // queue
+  void recordSort(VkCommandBuffer commandBuffer,
+                  const ComputePushConstants& pushConstants, uint32_t slot,
+                  uint32_t range) const;
+
+  void recordStage(VkCommandBuffer commandBuffer,
+                   const ComputePipeline& pipeline,
+                   const ComputePushConstants& pushConstants) const;
+
+  std::unique_ptr<ComputePipeline> generatePipeline;
+  std::unique_ptr<ComputePipeline> extendPipeline;
+  std::array<std::unique_ptr<ComputePipeline>, NUM_MATERIALS> shadePipelines;
+  std::unique_ptr<ComputePipeline> resolvePipeline;
+  // Only created when sorting rays
+  std::unique_ptr<ComputePipeline> sortCountPipeline;
+  std::unique_ptr<ComputePipeline> sortScanPipeline;
+  std::unique_ptr<ComputePipeline> sortScatterPipeline;
+
+  std::unique_ptr<StorageBuffer> pathBuffer;
+  std::unique_ptr<StorageBuffer> queueBuffer;
+  std::unique_ptr<StorageBuffer> hitBuffer;
+  std::unique_ptr<StorageBuffer> counterBuffer;
+  std::unique_ptr<StorageBuffer> sortBuffer;
+
+  // Host visible copy of the traced ray counts of every slot
+  VkBuffer statsBuffer;
+  MemoryAllocation statsBufferMemory;
+  // One query per slot, with a range per tile and bounce around the
+  // extension and sort dispatches. The sort queries only exist when sorting
+  std::vector<std::unique_ptr<TimestampQuery>> extendTimestamps;
+  std::vector<std::unique_ptr<TimestampQuery>> sortTimestamps;
+
+  WavefrontOptions options;
+  uint32_t samplesPerPixel;
+  // Paths in flight at once, all samples of the largest tile
+  uint32_t pathCapacity;
+};
+}  // namespace odin
+#endif  // ODIN_WAVEFRONT_PIPELINE_HPP
\ No newline at end of file
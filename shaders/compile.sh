@@ -8,5 +8,14 @@ if ! [ $VALIDATOR_PATH ]; then
   exit 1
 fi
 
-# By GLSL convention we search for the following files that have the given extensions below
-find . -type f \( -name "*.glsl" -o -name "*.comp" -o -name "*.frag" -o -name "*.vert" \) | sed -e 's,^\./,,' | xargs $VALIDATOR_PATH -V
\ No newline at end of file
+# By GLSL convention we search for the following files that have the given extensions below.
+# Files in include/ are only included by the other shaders
+# Every shader is compiled to a SPIR-V file of the same name, such as
+# wavefront_extend.spv. The shader.* files are named after their stage instead
+for SHADER in $(find . -type f -not -path "./include/*" \( -name "*.glsl" -o -name "*.comp" -o -name "*.frag" -o -name "*.vert" \) | sed -e 's,^\./,,'); do
+  NAME="${SHADER%.*}"
+  if [ "$NAME" = "shader" ]; then
+    NAME="${SHADER##*.}"
+  fi
+  $VALIDATOR_PATH -V "$SHADER" -o "$NAME.spv" || exit 1
+done
\ No newline at end of file
@@ -0,0 +1,148 @@
+// Declarations shared by the megakernel in shader.comp and the wavefront
+// kernels. Needs to be included after the #version directive
+
+// The output of the raytracing pass is going to be written here
+layout(binding = 0, rgba8) uniform writeonly image2D resultImage;
+
+// Only medium precision floats are needed so we declare that here
+precision mediump float;
+
+// Defining some constants
+// This will only work in GLSL 4.4 and above!
+const float INFINITY = 1.0 / 0.0;
+const float EPSILON = 0.000000001;
+
+// Specialized from the command line. Every frame adds NUM_SAMPLES samples per
+// pixel, and paths end after NUM_BOUNCES bounces
+layout(constant_id = 4) const int NUM_SAMPLES = 16;
+layout(constant_id = 5) const int NUM_BOUNCES = 3;
+
+// Function for generating pseudo-random numbers
+// https://stackoverflow.com/questions/4200224/random-noise-functions-for-glsl
+float rand(in vec2 co) {
+  return 2.0 * fract(sin(dot(co.xy, vec2(12.9898, 78.233))) * 43758.5453) - 1;
+}
+
+// Experimental pseudo-random number generator. Will use this later
+float GPURnd(inout vec4 state) {
+  const vec4 q = vec4(1225.0, 1585.0, 2457.0, 2098.0);
+  const vec4 r = vec4(1112.0, 367.0, 92.0, 265.0);
+  const vec4 a = vec4(3423.0, 2646.0, 1707.0, 1999.0);
+  const vec4 m = vec4(4194287.0, 4194277.0, 4194191.0, 4194167.0);
+  vec4 beta = floor(state / q);
+  vec4 p = a * (state - beta * q) - beta * r;
+  beta = (sign(-p) + vec4(1.0)) * vec4(0.5) * m;
+  state = (p + beta);
+  return fract(dot(state / m, vec4(1.0, -1.0, 1.0, -1.0)));
+}
+
+// UBO for storing camera values
+layout(binding = 1) uniform Camera {
+  vec3 origin;
+  vec3 lower_left_corner;
+  vec3 horizontal;
+  vec3 vertical;
+  vec3 u;
+  vec3 v;
+  vec3 w;
+  float lens_radius;
+}
+cam;
+
+// Sum of all samples of every pixel since the camera last moved. The output
+// image shows their mean
+layout(std430, binding = 4) buffer Accumulation { vec4 accumulation[]; };
+
+// Struct to describe material interaction. The material type
+// is IDed through a simple integer. The mapping is as follows:
+// * 1 - Diffuse
+// * 2 - Metal
+// * 3 - Dielectric (glass, etc.)
+const int LAMBERTIAN = 1;
+const int METAL = 2;
+const int DIELECTRIC = 3;
+struct Material {
+  vec3 albedo;
+  float fuzz;
+  float ref_idx;
+  int scatter_function;
+};
+
+// A struct used for recording data about intersections
+struct HitRecord {
+  float t;
+  vec3 p;
+  vec3 normal;
+  Material mat;
+  uint triangle;
+};
+
+// Setup for ray creation
+struct Ray {
+  vec3 origin;
+  vec3 direction;
+};
+
+vec3 ray_point_at_param(in Ray ray, in float t) {
+  return ray.origin + t * ray.direction;
+}
+
+// Sample unit disk for scattering
+vec3 random_in_unit_disk(in vec2 co) {
+  vec3 p;
+  int n = 0;
+  do {
+    p = vec3(rand(co.xy), rand(co.yx), 0.0) - vec3(1.0, 1.0, 0.0);
+  } while (dot(p, p) >= 1.0 && ++n < 3);
+  return p;
+}
+
+// Sample the unit sphere for shadows
+vec3 random_in_unit_sphere(vec3 p) {
+  int n = 0;
+  do {
+    p = vec3(rand(p.xy), rand(p.zy), rand(p.xz));
+  } while ((length(p) * length(p)) >= 1.0 && ++n < 3);
+  return p;
+}
+
+Ray get_ray(in float s, in float t) {
+  vec3 rd = cam.lens_radius * random_in_unit_disk(vec2(s, t));
+  vec3 offset = vec3(cam.u * rd.x + cam.v * rd.y);
+  return Ray(cam.origin + offset, cam.lower_left_corner + s * cam.horizontal +
+                                      t * cam.vertical - cam.origin - offset);
+}
+
+// Camera ray of sample s of a pixel
+Ray get_sample_ray(in uvec2 coords, in ivec2 dim, in uint s) {
+  float u = (coords.x + rand(coords + s)) / dim.x;
+  float v = (coords.y + rand(coords + s)) / dim.y;
+  return get_ray(u, v);
+}
+
+// The sky is the only light of the scene. Rays leaving the scene pick up
+// its color
+vec3 background(in vec3 direction) {
+  vec3 unit_direction = normalize(direction);
+  float t = 0.5 * (unit_direction.y + 1.0);
+  return (1.0 - t) * vec3(1.0, 1.0, 1.0) + t * vec3(0.5, 0.7, 1.0);
+}
+
+// Add the samples of this frame to the ones of the previous frames and write
+// their mean to the output image. The frame index counts the frames since
+// the camera last moved
+void accumulate(in uvec2 coords, in ivec2 dim, in vec3 color,
+                in uint frame_index) {
+  uint pixel = coords.y * uint(dim.x) + coords.x;
+  if (frame_index > 0) {
+    color += accumulation[pixel].xyz;
+  }
+  accumulation[pixel] = vec4(color, 0.0);
+
+  // Normalize the color with the number of samples
+  color /= float(NUM_SAMPLES * (frame_index + 1));
+  // Simple gamma-correction at 1/2
+  color = sqrt(color.xyz);
+
+  imageStore(resultImage, ivec2(coords), vec4(color, 0.0));
+}
\ No newline at end of file
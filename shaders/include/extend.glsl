@@ -0,0 +1,40 @@
+// Closest hit query of the extension stage, shared by the regular and the
+// persistent threads extension kernels. Rays leaving the scene pick up the
+// sky, the others are sorted into the queue of the material they hit.
+// Needs traversal.glsl and wavefront.glsl
+
+// Set when the sorting stage has reordered the rays of the secondary bounces
+// into the sorted queue
+layout(constant_id = 3) const bool SORTED_RAYS = false;
+
+// Path of the ray at index of the queue of the bounce
+uint queued_ray(in uint queue, in uint index) {
+  uint source =
+      SORTED_RAYS && wave.bounce > 0 ? SORTED_QUEUE : RAY_QUEUES + queue;
+  return queues[source * path_capacity() + index];
+}
+
+void extend_path(in uint path) {
+  Ray ray = path_ray(path);
+  HitRecord rec;
+  if (!intersect(ray, EPSILON, INFINITY, rec)) {
+    paths[path].radiance.xyz +=
+        paths[path].throughput.xyz * background(ray.direction);
+    return;
+  }
+
+  // The path did not reach a light within the bounces
+  if (wave.bounce + 1 == NUM_BOUNCES) {
+    return;
+  }
+
+  hits[path] = PathHit(rec.t, rec.triangle);
+  push_hit(uint(rec.mat.scatter_function - 1), path);
+}
+
+// Count the rays of the bounce once per dispatch
+void count_traced_rays(in uint queue) {
+  if (gl_GlobalInvocationID.x == 0) {
+    atomicAdd(traced_rays[wave.bounce], ray_count[queue]);
+  }
+}
\ No newline at end of file
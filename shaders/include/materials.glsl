@@ -0,0 +1,84 @@
+// Scatter functions of the materials shared by the megakernel and the
+// wavefront shading kernels. Needs common.glsl
+
+bool scatter_lambertian(in Ray ray, in HitRecord rec, inout vec3 attenuation,
+                        inout Ray scattered) {
+  vec3 target = rec.p + rec.normal + random_in_unit_sphere(rec.p);
+  scattered = Ray(rec.p, target - rec.p);
+  attenuation = rec.mat.albedo;
+  return true;
+}
+
+bool scatter_metal(in Ray ray, in HitRecord rec, inout vec3 attentuation,
+                   inout Ray scattered) {
+  vec3 reflected = reflect(normalize(ray.direction), rec.normal);
+  scattered =
+      Ray(rec.p, reflected + rec.mat.fuzz * random_in_unit_sphere(rec.p));
+  attentuation = rec.mat.albedo;
+  return dot(scattered.direction, rec.normal) > 0.0;
+}
+
+bool refract(in vec3 v, in vec3 n, in float ni_over_nt, inout vec3 refracted) {
+  vec3 uv = normalize(v);
+  float dt = dot(uv, n);
+  float discriminant = 1.0 - ni_over_nt * ni_over_nt * (1 - dt * dt);
+  if (discriminant > 0.0) {
+    refracted = ni_over_nt * (uv - n * dt) - n * sqrt(discriminant);
+    return true;
+  }
+  return false;
+}
+
+// Schlick approximation function
+float schlick(in float cosine, in float ref_idx) {
+  float r0 = (1.0 - ref_idx) / (1.0 + ref_idx);
+  r0 = r0 * r0;
+  return r0 + (1.0 - r0) * pow((1.0 - cosine), 5);
+}
+
+bool scatter_dielectric(in Ray ray, inout HitRecord rec,
+                        inout vec3 attentuation, inout Ray scattered) {
+  vec3 outward_normal;
+  vec3 reflected = reflect(ray.direction, rec.normal);
+  float ni_over_nt;
+  attentuation = vec3(1.0, 1.0, 1.0);
+  vec3 refracted;
+  float reflect_prob;
+  float cosine;
+  if (dot(ray.direction, rec.normal) > 0.0) {
+    outward_normal = -rec.normal;
+    ni_over_nt = rec.mat.ref_idx;
+    cosine = rec.mat.ref_idx * dot(ray.direction, rec.normal) /
+             length(ray.direction);
+  } else {
+    outward_normal = rec.normal;
+    ni_over_nt = 1.0 / rec.mat.ref_idx;
+    cosine = -dot(ray.direction, rec.normal) / length(ray.direction);
+  }
+
+  if (refract(ray.direction, outward_normal, ni_over_nt, refracted)) {
+    reflect_prob = schlick(cosine, rec.mat.ref_idx);
+  } else {
+    scattered = Ray(rec.p, reflected);
+    reflect_prob = 1.0;
+  }
+
+  if (rand(ray.direction.xy) < reflect_prob) {
+    scattered = Ray(rec.p, reflected);
+  } else {
+    scattered = Ray(rec.p, refracted);
+  }
+
+  return true;
+}
+
+bool scatter(in Ray ray, inout HitRecord rec, inout vec3 attentuation,
+             inout Ray scattered) {
+  if (rec.mat.scatter_function == LAMBERTIAN) {
+    return scatter_lambertian(ray, rec, attentuation, scattered);
+  } else if (rec.mat.scatter_function == METAL) {
+    return scatter_metal(ray, rec, attentuation, scattered);
+  } else {
+    return scatter_dielectric(ray, rec, attentuation, scattered);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+// Counting sort of the ray queue of a bounce. Rays are binned by the octant
+// of their direction and the Morton code of their origin within the scene
+// bounds, so neighboring threads of the extension stage traverse similar
+// parts of the acceleration structure. Needs traversal.glsl and
+// wavefront.glsl
+
+// Threads of the scan kernel and bits of the origin cell per axis. The
+// number of bins has to match WavefrontPipeline::SORT_BINS
+const uint SORT_SCAN_GROUP_SIZE = 256;
+const uint SORT_MORTON_BITS = 4;
+const uint NUM_SORT_BINS = 8u << (3 * SORT_MORTON_BITS);
+
+// Rays per bin. The scan turns them into the first slot of every bin in the
+// sorted queue
+layout(std430, binding = 9) buffer SortBins { uint sort_bins[]; };
+
+// Interleave the bits of the cell coordinates
+uint morton_code(in uvec3 cell) {
+  uint code = 0;
+  for (uint i = 0; i < SORT_MORTON_BITS; ++i) {
+    code |= ((cell.x >> i) & 1u) << (3 * i + 2);
+    code |= ((cell.y >> i) & 1u) << (3 * i + 1);
+    code |= ((cell.z >> i) & 1u) << (3 * i);
+  }
+  return code;
+}
+
+// The octant is the most significant part of the bin, so rays heading the
+// same way stay together before their origins are considered
+uint sort_bin(in uint path) {
+  vec3 direction = paths[path].direction.xyz;
+  uint octant = (direction.x < 0.0 ? 4u : 0u) | (direction.y < 0.0 ? 2u : 0u) |
+                (direction.z < 0.0 ? 1u : 0u);
+
+  vec3 bounds_min;
+  vec3 bounds_max;
+  scene_bounds(bounds_min, bounds_max);
+  const float cells = float(1u << SORT_MORTON_BITS);
+  vec3 extent = max(bounds_max - bounds_min, vec3(EPSILON));
+  uvec3 cell = uvec3(clamp(
+      (paths[path].origin.xyz - bounds_min) / extent * cells, vec3(0.0),
+      vec3(cells - 1.0)));
+  return (octant << (3 * SORT_MORTON_BITS)) | morton_code(cell);
+}
\ No newline at end of file
@@ -0,0 +1,425 @@
+// Acceleration structures and closest hit queries shared by the megakernel
+// and the extension kernel of the wavefront path tracer. Needs common.glsl
+
+// Size of the traversal stack. This bounds the depth of the BVH
+const int BVH_STACK_SIZE = 64;
+
+// Kernels that define SHARED_TRAVERSAL_STACK as their work group size keep
+// the BVH traversal stacks in shared memory instead of local memory. The
+// stacks are interleaved, so the invocations of a subgroup access
+// neighboring words when they are at the same depth
+#ifdef SHARED_TRAVERSAL_STACK
+shared uint traversal_stack[BVH_STACK_SIZE * SHARED_TRAVERSAL_STACK];
+#define TRAVERSAL_STACK(i) \
+  traversal_stack[(i) * SHARED_TRAVERSAL_STACK + gl_LocalInvocationIndex]
+#else
+#define TRAVERSAL_STACK(i) stack[i]
+#endif
+
+// Number of children of every BVH node set by the application. A width of 2
+// traverses the binary nodes, 4 and 8 the collapsed wide nodes
+layout(constant_id = 0) const uint BVH_WIDTH = 2;
+
+// Acceleration structure set by the application
+const uint ACCELERATION_BVH = 0;
+const uint ACCELERATION_KD_TREE = 1;
+layout(constant_id = 1) const uint ACCELERATION_STRUCTURE = ACCELERATION_BVH;
+
+// Data structure declarations for BVH
+// Nodes are stored in depth-first order. The first child of an interior
+// node directly follows it and the second child is found at offset.
+// Leaves hold count triangles starting at offset
+struct BvhNode {
+  vec3 min;
+  uint offset;
+  vec3 max;
+  uint count;
+};
+
+// Triangle vertices with the face normal packed into the w components
+struct BvhTriangle {
+  vec4 v0;
+  vec4 v1;
+  vec4 v2;
+};
+
+layout(std430, binding = 2) readonly buffer BVH { BvhNode nodes[]; };
+
+// The wide nodes alias the binary ones. Every node stores the bounds of its
+// children as structure of arrays in eight fields of BVH_WIDTH values:
+// min x, min y, min z, max x, max y, max z, child and count. The last two
+// hold uints. A count of zero marks an interior child and child is its node
+// index, otherwise child is the first triangle of a leaf
+layout(std430, binding = 2) readonly buffer WideBVH { vec4 wide_nodes[]; };
+
+// Nodes of the k-d tree, also aliasing the BVH nodes. The lower two bits of
+// data hold the split axis or KD_LEAF. The upper bits hold the index of the
+// child above the split plane, the child below directly follows its parent.
+// Leaves hold data >> 2 triangles starting at floatBitsToUint(split)
+struct KdNode {
+  float split;
+  uint data;
+};
+
+const uint KD_LEAF = 3;
+const int KD_STACK_SIZE = 64;
+
+layout(std430, binding = 2) readonly buffer KdTree {
+  vec4 kd_bounds_min;
+  vec4 kd_bounds_max;
+  KdNode kd_nodes[];
+};
+
+layout(std430, binding = 3) readonly buffer Triangles {
+  BvhTriangle triangles[];
+};
+
+// Material of a triangle
+Material triangle_material(in uint triangle_index) {
+  // Diffuse material for testing
+  return Material(vec3(0.8, 0.0, 0.0), 0.0, 0.0, LAMBERTIAN);
+}
+
+// Fill in the hit record for a hit at distance t. The wavefront shading
+// kernels use this to restore the hits found by the extension kernel
+void record_hit(in Ray ray, in uint triangle_index, in float t,
+                inout HitRecord rec) {
+  BvhTriangle tri = triangles[triangle_index];
+  rec.t = t;
+  rec.p = ray_point_at_param(ray, rec.t);
+  rec.normal = vec3(tri.v0.w, tri.v1.w, tri.v2.w);
+  rec.mat = triangle_material(triangle_index);
+  rec.triangle = triangle_index;
+}
+
+bool triangle_hit(in Ray ray, in uint triangle_index, in float t_min,
+                  in float t_max, inout HitRecord rec) {
+  BvhTriangle tri = triangles[triangle_index];
+  vec3 v0v1 = tri.v1.xyz - tri.v0.xyz;
+  vec3 v0v2 = tri.v2.xyz - tri.v0.xyz;
+  vec3 pvec = cross(ray.direction, v0v2);
+  float d = dot(v0v1, pvec);
+  if (abs(d) < EPSILON) {
+    // Plane is parallel to ray. No intersection
+    return false;
+  }
+
+  float invD = 1.0 / d;
+  vec3 tvec = ray.origin - tri.v0.xyz;
+  float u = dot(tvec, pvec) * invD;
+  if (u < 0.0 || u > 1.0) {
+    // Ray missed the plane
+    return false;
+  }
+
+  vec3 qvec = cross(tvec, v0v1);
+  float v = dot(ray.direction, qvec) * invD;
+  if (v < 0 || u + v > 1.0) {
+    // Ray missed the plane
+    return false;
+  }
+
+  // Only accept hits inside of the search interval
+  float temp_t = dot(v0v2, qvec) * invD;
+  if (temp_t < t_min || temp_t > t_max) {
+    return false;
+  }
+
+  // Triangle was hit return data
+  record_hit(ray, triangle_index, temp_t, rec);
+  return true;
+}
+
+
+// Slab test against a bounding box. The inverse ray direction is passed in
+// so it only has to be computed once per ray. On a hit t_enter holds the
+// distance at which the ray enters the box
+bool aabb_hit(in vec3 origin, in vec3 inv_dir, in vec3 box_min,
+              in vec3 box_max, in float t_min, in float t_max,
+              out float t_enter) {
+  // Optimized AABB hit intersection test
+  vec3 t0s = (box_min - origin) * inv_dir;
+  vec3 t1s = (box_max - origin) * inv_dir;
+
+  vec3 t_smaller = min(t1s, t0s);
+  vec3 t_bigger = max(t0s, t1s);
+
+  t_min = max(t_min, max(t_smaller[0], max(t_smaller[1], t_smaller[2])));
+  t_max = min(t_max, min(t_bigger[0], min(t_bigger[1], t_bigger[2])));
+
+  t_enter = t_min;
+  return t_min <= t_max;
+}
+
+// Intersect the triangles of a leaf node. The search interval is shortened
+// whenever a closer triangle is found
+bool leaf_hit(in Ray ray, in uint node_index, in float t_min,
+              inout float t_max, inout HitRecord rec) {
+  bool hit_anything = false;
+  uint first = nodes[node_index].offset;
+  uint last = first + nodes[node_index].count;
+  for (uint i = first; i < last; ++i) {
+    if (triangle_hit(ray, i, t_min, t_max, rec)) {
+      hit_anything = true;
+      t_max = rec.t;
+    }
+  }
+  return hit_anything;
+}
+
+// Find the closest intersection by walking the BVH front to back. The
+// farther child of every interior node is pushed onto a small stack and
+// visited once the nearer subtree has been processed
+bool intersect_binary(in Ray ray, in float t_min, in float t_max,
+                      inout HitRecord rec) {
+  vec3 inv_dir = vec3(1.0) / ray.direction;
+  bool hit_anything = false;
+  float closest_so_far = t_max;
+
+  float t_enter;
+  if (!aabb_hit(ray.origin, inv_dir, nodes[0].min, nodes[0].max, t_min,
+                closest_so_far, t_enter)) {
+    return false;
+  }
+
+#ifndef SHARED_TRAVERSAL_STACK
+  uint stack[BVH_STACK_SIZE];
+#endif
+  int stack_size = 0;
+  uint node_index = 0;
+  while (true) {
+    if (nodes[node_index].count > 0) {
+      if (leaf_hit(ray, node_index, t_min, closest_so_far, rec)) {
+        hit_anything = true;
+      }
+    } else {
+      uint near_child = node_index + 1;
+      uint far_child = nodes[node_index].offset;
+      float t_near, t_far;
+      bool hit_near =
+          aabb_hit(ray.origin, inv_dir, nodes[near_child].min,
+                   nodes[near_child].max, t_min, closest_so_far, t_near);
+      bool hit_far =
+          aabb_hit(ray.origin, inv_dir, nodes[far_child].min,
+                   nodes[far_child].max, t_min, closest_so_far, t_far);
+      if (hit_near && hit_far) {
+        // Visit the child that the ray enters first
+        if (t_far < t_near) {
+          uint temp = near_child;
+          near_child = far_child;
+          far_child = temp;
+        }
+        TRAVERSAL_STACK(stack_size++) = far_child;
+        node_index = near_child;
+        continue;
+      } else if (hit_near) {
+        node_index = near_child;
+        continue;
+      } else if (hit_far) {
+        node_index = far_child;
+        continue;
+      }
+    }
+
+    if (stack_size == 0) {
+      break;
+    }
+    node_index = TRAVERSAL_STACK(--stack_size);
+  }
+  return hit_anything;
+}
+
+// Walk the wide BVH. All children of a node are tested with one slab test
+// per group of four. Hit leaves are intersected right away, the nearest hit
+// interior child is visited next and the others are pushed onto the stack
+bool intersect_wide(in Ray ray, in float t_min, in float t_max,
+                    inout HitRecord rec) {
+  const uint GROUPS = BVH_WIDTH / 4;
+  const uint NODE_SIZE = 8 * GROUPS;
+  const uint INVALID_NODE = 0xffffffff;
+  vec3 inv_dir = vec3(1.0) / ray.direction;
+  bool hit_anything = false;
+  float closest_so_far = t_max;
+
+  // Pick the near and far planes from the direction of the ray. Unused
+  // children have empty boxes which can then never be hit
+  uvec3 near_field = uvec3(inv_dir.x < 0.0 ? 3 : 0, inv_dir.y < 0.0 ? 4 : 1,
+                           inv_dir.z < 0.0 ? 5 : 2) * GROUPS;
+  uvec3 far_field = uvec3(inv_dir.x < 0.0 ? 0 : 3, inv_dir.y < 0.0 ? 1 : 4,
+                          inv_dir.z < 0.0 ? 2 : 5) * GROUPS;
+
+#ifndef SHARED_TRAVERSAL_STACK
+  uint stack[BVH_STACK_SIZE];
+#endif
+  int stack_size = 0;
+  uint node_index = 0;
+  while (true) {
+    uint base = node_index * NODE_SIZE;
+    uint next_node = INVALID_NODE;
+    float next_near = INFINITY;
+    for (uint group = 0; group < GROUPS; ++group) {
+      uint first = base + group;
+      vec4 t_near = max(
+          max((wide_nodes[first + near_field.x] - ray.origin.x) * inv_dir.x,
+              (wide_nodes[first + near_field.y] - ray.origin.y) * inv_dir.y),
+          max((wide_nodes[first + near_field.z] - ray.origin.z) * inv_dir.z,
+              vec4(t_min)));
+      vec4 t_far = min(
+          min((wide_nodes[first + far_field.x] - ray.origin.x) * inv_dir.x,
+              (wide_nodes[first + far_field.y] - ray.origin.y) * inv_dir.y),
+          min((wide_nodes[first + far_field.z] - ray.origin.z) * inv_dir.z,
+              vec4(closest_so_far)));
+      bvec4 hit = lessThanEqual(t_near, t_far);
+      uvec4 child = floatBitsToUint(wide_nodes[first + 6 * GROUPS]);
+      uvec4 count = floatBitsToUint(wide_nodes[first + 7 * GROUPS]);
+
+      for (int i = 0; i < 4; ++i) {
+        if (!hit[i]) {
+          continue;
+        }
+
+        if (count[i] > 0) {
+          for (uint j = child[i]; j < child[i] + count[i]; ++j) {
+            if (triangle_hit(ray, j, t_min, closest_so_far, rec)) {
+              hit_anything = true;
+              closest_so_far = rec.t;
+            }
+          }
+        } else if (next_node == INVALID_NODE || t_near[i] < next_near) {
+          if (next_node != INVALID_NODE) {
+            TRAVERSAL_STACK(stack_size++) = next_node;
+          }
+          next_node = child[i];
+          next_near = t_near[i];
+        } else {
+          TRAVERSAL_STACK(stack_size++) = child[i];
+        }
+      }
+    }
+
+    if (next_node != INVALID_NODE) {
+      node_index = next_node;
+      continue;
+    }
+
+    if (stack_size == 0) {
+      break;
+    }
+    node_index = TRAVERSAL_STACK(--stack_size);
+  }
+  return hit_anything;
+}
+
+// Walk the k-d tree front to back. The ray is clipped to the scene bounds
+// and then to the split planes, so the far child is pushed together with the
+// interval of the ray inside of it. Traversal stops as soon as the closest
+// hit lies in front of the next interval
+bool intersect_kd_tree(in Ray ray, in float t_min, in float t_max,
+                       inout HitRecord rec) {
+  vec3 inv_dir = vec3(1.0) / ray.direction;
+  float t_enter;
+  float t_exit;
+  {
+    vec3 t0s = (kd_bounds_min.xyz - ray.origin) * inv_dir;
+    vec3 t1s = (kd_bounds_max.xyz - ray.origin) * inv_dir;
+    vec3 t_smaller = min(t0s, t1s);
+    vec3 t_bigger = max(t0s, t1s);
+    t_enter = max(t_min, max(t_smaller.x, max(t_smaller.y, t_smaller.z)));
+    t_exit = min(t_max, min(t_bigger.x, min(t_bigger.y, t_bigger.z)));
+    if (t_enter > t_exit) {
+      return false;
+    }
+  }
+
+  bool hit_anything = false;
+  float closest_so_far = t_max;
+  uint stack_node[KD_STACK_SIZE];
+  float stack_enter[KD_STACK_SIZE];
+  float stack_exit[KD_STACK_SIZE];
+  int stack_size = 0;
+  uint node_index = 0;
+  while (closest_so_far >= t_enter) {
+    KdNode node = kd_nodes[node_index];
+    uint axis = node.data & 3;
+    if (axis != KD_LEAF) {
+      // Visit the child on the side of the ray origin first
+      float t_split = (node.split - ray.origin[axis]) * inv_dir[axis];
+      bool below_first =
+          ray.origin[axis] < node.split ||
+          (ray.origin[axis] == node.split && ray.direction[axis] <= 0.0);
+      uint first_child = below_first ? node_index + 1 : node.data >> 2;
+      uint second_child = below_first ? node.data >> 2 : node_index + 1;
+      if (ray.direction[axis] == 0.0 || t_split > t_exit || t_split <= 0.0) {
+        node_index = first_child;
+      } else if (t_split < t_enter) {
+        node_index = second_child;
+      } else {
+        stack_node[stack_size] = second_child;
+        stack_enter[stack_size] = t_split;
+        stack_exit[stack_size] = t_exit;
+        stack_size++;
+        node_index = first_child;
+        t_exit = t_split;
+      }
+      continue;
+    }
+
+    uint first = floatBitsToUint(node.split);
+    uint last = first + (node.data >> 2);
+    for (uint i = first; i < last; ++i) {
+      if (triangle_hit(ray, i, t_min, closest_so_far, rec)) {
+        hit_anything = true;
+        closest_so_far = rec.t;
+      }
+    }
+
+    if (stack_size == 0) {
+      break;
+    }
+    stack_size--;
+    node_index = stack_node[stack_size];
+    t_enter = stack_enter[stack_size];
+    t_exit = stack_exit[stack_size];
+  }
+  return hit_anything;
+}
+
+bool intersect(in Ray ray, in float t_min, in float t_max,
+               inout HitRecord rec) {
+  if (ACCELERATION_STRUCTURE == ACCELERATION_KD_TREE) {
+    return intersect_kd_tree(ray, t_min, t_max, rec);
+  }
+  if (BVH_WIDTH == 2) {
+    return intersect_binary(ray, t_min, t_max, rec);
+  }
+  return intersect_wide(ray, t_min, t_max, rec);
+}
+
+// Bounds of the whole scene. The root of the wide BVH only stores the bounds
+// of its children, whose unused slots hold empty boxes
+void scene_bounds(out vec3 bounds_min, out vec3 bounds_max) {
+  if (ACCELERATION_STRUCTURE == ACCELERATION_KD_TREE) {
+    bounds_min = kd_bounds_min.xyz;
+    bounds_max = kd_bounds_max.xyz;
+    return;
+  }
+  if (BVH_WIDTH == 2) {
+    bounds_min = nodes[0].min;
+    bounds_max = nodes[0].max;
+    return;
+  }
+
+  const uint GROUPS = BVH_WIDTH / 4;
+  bounds_min = vec3(INFINITY);
+  bounds_max = vec3(-INFINITY);
+  for (uint group = 0; group < GROUPS; ++group) {
+    for (int i = 0; i < 4; ++i) {
+      bounds_min = min(bounds_min, vec3(wide_nodes[group][i],
+                                        wide_nodes[GROUPS + group][i],
+                                        wide_nodes[2 * GROUPS + group][i]));
+      bounds_max = max(bounds_max, vec3(wide_nodes[3 * GROUPS + group][i],
+                                        wide_nodes[4 * GROUPS + group][i],
+                                        wide_nodes[5 * GROUPS + group][i]));
+    }
+  }
+}
\ No newline at end of file
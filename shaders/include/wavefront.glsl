@@ -0,0 +1,90 @@
+// Buffers shared by the stages of the wavefront path tracer. Every sample of
+// every pixel of a tile is a path. The stages hand paths to each other
+// through queues of path indices whose lengths are counted atomically.
+// Needs common.glsl
+
+// Threads per work group of every wavefront kernel
+const uint WAVEFRONT_GROUP_SIZE = 64;
+const uint NUM_MATERIALS = 3;
+
+// Tile the kernels work on, the bounce of the paths and the frame they
+// sample. Has to match ComputePushConstants
+layout(push_constant) uniform Wavefront {
+  uvec2 offset;
+  uvec2 size;
+  uint bounce;
+  uint frame_index;
+  uint sample_seed;
+}
+wave;
+
+// State of a path between the stages. The ray of the next bounce, the
+// product of the attenuations along the path and the light it gathered
+struct PathState {
+  vec4 origin;
+  vec4 direction;
+  vec4 throughput;
+  vec4 radiance;
+};
+
+layout(std430, binding = 5) buffer Paths { PathState paths[]; };
+
+// Two ray queues that the bounces alternate between, followed by a queue of
+// hit paths for every material and the rays of the current bounce sorted by
+// sort.glsl. Each queue can hold every path
+layout(std430, binding = 6) buffer Queues { uint queues[]; };
+
+// Closest hit of every path found by the extension kernel
+struct PathHit {
+  float t;
+  uint triangle;
+};
+
+layout(std430, binding = 7) buffer Hits { PathHit hits[]; };
+
+// Same layout as VkDispatchIndirectCommand
+struct DispatchArgs {
+  uint x;
+  uint y;
+  uint z;
+};
+
+// Lengths of the queues and the work groups needed to process them. The
+// persistent threads extension kernel fetches its rays with fetch_count.
+// traced_rays counts the rays of every bounce over all tiles of a
+// submission and only has room for the default of NUM_BOUNCES, since the
+// block layout cannot depend on a specialization constant. Has to match
+// WavefrontCounters
+layout(std430, binding = 8) buffer Counters {
+  DispatchArgs extend_args[2];
+  DispatchArgs shade_args[NUM_MATERIALS];
+  uint ray_count[2];
+  uint material_count[NUM_MATERIALS];
+  uint fetch_count;
+  uint traced_rays[3];
+};
+
+const uint RAY_QUEUES = 0;
+const uint MATERIAL_QUEUES = 2;
+const uint SORTED_QUEUE = MATERIAL_QUEUES + NUM_MATERIALS;
+
+// Number of paths the buffers hold. Every queue has room for all of them
+uint path_capacity() { return uint(paths.length()); }
+
+// Append a path to a queue. The dispatch arguments grow with the queue, so
+// the next stage runs just enough work groups
+void push_ray(in uint queue, in uint path) {
+  uint slot = atomicAdd(ray_count[queue], 1u);
+  queues[(RAY_QUEUES + queue) * path_capacity() + slot] = path;
+  atomicMax(extend_args[queue].x, slot / WAVEFRONT_GROUP_SIZE + 1);
+}
+
+void push_hit(in uint material, in uint path) {
+  uint slot = atomicAdd(material_count[material], 1u);
+  queues[(MATERIAL_QUEUES + material) * path_capacity() + slot] = path;
+  atomicMax(shade_args[material].x, slot / WAVEFRONT_GROUP_SIZE + 1);
+}
+
+Ray path_ray(in uint path) {
+  return Ray(paths[path].origin.xyz, paths[path].direction.xyz);
+}
\ No newline at end of file
@@ -10,12 +10,28 @@ namespace po = boost::program_options;
 std::string odin::Application::COMPUTE_SHADER_PATH;
 std::string odin::Application::FRAGMENT_SHADER_PATH;
 std::string odin::Application::VERTEX_SHADER_PATH;
+std::string odin::Application::WAVEFRONT_SHADER_DIRECTORY;
 std::string odin::Application::MODEL_PATH;
 std::string odin::Application::TEXTURE_PATH;
 const int odin::Application::WIDTH;
 const int odin::Application::HEIGHT;
 odin::Camera odin::Application::camera;
 
+namespace {
+// Work group sizes timed by tuneWorkGroupSize
+const std::array<std::pair<uint32_t, uint32_t>, 8> WORK_GROUP_CANDIDATES = {
+    {{8, 8}, {16, 8}, {8, 16}, {16, 16}, {32, 8}, {8, 32}, {32, 16}, {32, 32}}};
+// Frames timed per candidate after the first one, which only warms it up
+const int WORK_GROUP_TIMED_FRAMES = 3;
+
+bool fitsWorkGroupLimits(const VkPhysicalDeviceLimits &limits, uint32_t width,
+                         uint32_t height) {
+  return width <= limits.maxComputeWorkGroupSize[0] &&
+         height <= limits.maxComputeWorkGroupSize[1] &&
+         width * height <= limits.maxComputeWorkGroupInvocations;
+}
+}  // namespace
+
 odin::Application::Application(int argc, char *argv[]) {
   if (parseArguments(argc, argv)) {
     throw std::runtime_error("Unable to parse command line arguments!");
@@ -34,6 +50,7 @@ void odin::Application::keyCallback(GLFWwindow *window, int key, int scanCode,
   // Move the camera based on keystrokes
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
     glfwSetWindowShouldClose(window, GLFW_TRUE);
+    return;
   } else if (key == GLFW_KEY_W && keyPressed) {
     camera.origin.z -= 0.1;
   } else if (key == GLFW_KEY_A && keyPressed) {
@@ -42,7 +59,14 @@ void odin::Application::keyCallback(GLFWwindow *window, int key, int scanCode,
     camera.origin.z += 0.1;
   } else if (key == GLFW_KEY_D && keyPressed) {
     camera.origin.x += 0.1;
+  } else {
+    return;
   }
+
+  // The accumulated samples belong to the old view
+  auto app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
+  app->frameIndex = 0;
+  app->tileScheduler->restart();
 }
 
 void odin::Application::cleanup() {
@@ -52,13 +76,15 @@ void odin::Application::cleanup() {
 
   vkDestroySampler(deviceManager->getLogicalDevice(),
                    textureSampler->getSampler(), nullptr);
-  vkDestroyImageView(deviceManager->getLogicalDevice(),
-                     textureImage->getTextureImageView(), nullptr);
-
-  vkDestroyImage(deviceManager->getLogicalDevice(),
-                 textureImage->getTextureImage(), nullptr);
-  vkFreeMemory(deviceManager->getLogicalDevice(),
-               textureImage->getTextureImageMemory(), nullptr);
+  for (const std::unique_ptr<TextureImage> &outputImage : outputImages) {
+    vkDestroyImageView(deviceManager->getLogicalDevice(),
+                       outputImage->getTextureImageView(), nullptr);
+
+    vkDestroyImage(deviceManager->getLogicalDevice(),
+                   outputImage->getTextureImage(), nullptr);
+    deviceManager->getMemoryAllocator().free(
+        outputImage->getTextureImageMemory());
+  }
 
   vkDestroyDescriptorSetLayout(
       deviceManager->getLogicalDevice(),
@@ -70,8 +96,16 @@ void odin::Application::cleanup() {
 
   vkDestroyBuffer(deviceManager->getLogicalDevice(), bvhBuffer->getBuffer(),
                   nullptr);
-  vkFreeMemory(deviceManager->getLogicalDevice(), bvhBuffer->getBufferMemory(),
-               nullptr);
+  deviceManager->getMemoryAllocator().free(bvhBuffer->getBufferMemory());
+  vkDestroyBuffer(deviceManager->getLogicalDevice(),
+                  bvhBuffer->getTriangleBuffer(), nullptr);
+  deviceManager->getMemoryAllocator().free(
+      bvhBuffer->getTriangleBufferMemory());
+
+  vkDestroyBuffer(deviceManager->getLogicalDevice(),
+                  accumulationBuffer->getBuffer(), nullptr);
+  deviceManager->getMemoryAllocator().free(
+      accumulationBuffer->getDeviceMemory());
 
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     vkDestroySemaphore(deviceManager->getLogicalDevice(),
@@ -81,6 +115,9 @@ void odin::Application::cleanup() {
     vkDestroyFence(deviceManager->getLogicalDevice(), inFlightFences[i],
                    nullptr);
   }
+  for (VkSemaphore semaphore : computeFinishedSemaphores) {
+    vkDestroySemaphore(deviceManager->getLogicalDevice(), semaphore, nullptr);
+  }
 
   vkDestroyCommandPool(deviceManager->getLogicalDevice(),
                        commandPool->getComputeCommandPool(), nullptr);
@@ -88,6 +125,16 @@ void odin::Application::cleanup() {
   vkDestroyCommandPool(deviceManager->getLogicalDevice(),
                        commandPool->getGraphicsCommandPool(), nullptr);
 
+  commandPool->cleanupTransientCommands(deviceManager->getLogicalDevice());
+
+  stagingRing->cleanup(*deviceManager);
+
+  // Compiled pipelines are reused by the next run
+  deviceManager->getPipelineCache().save();
+  deviceManager->getPipelineCache().cleanup();
+
+  // Releases the memory blocks of all buffers and images
+  deviceManager->getMemoryAllocator().cleanup();
   vkDestroyDevice(deviceManager->getLogicalDevice(), nullptr);
 
   vkDestroySurfaceKHR(instance->getInstance(), surface, nullptr);
@@ -98,14 +145,74 @@ void odin::Application::cleanup() {
 }
 
 void odin::Application::cleanupComputePipeline() {
-  // Destroy compute fence
-  vkDestroyFence(deviceManager->getLogicalDevice(), computeFence, nullptr);
+  // Destroy compute fences
+  for (VkFence fence : computeFences) {
+    vkDestroyFence(deviceManager->getLogicalDevice(), fence, nullptr);
+  }
 
-  vkDestroyPipelineLayout(deviceManager->getLogicalDevice(),
-                          computePipeline->getPipelineLayout(), nullptr);
+  for (const std::unique_ptr<TimestampQuery> &timestamps : computeTimestamps) {
+    vkDestroyQueryPool(deviceManager->getLogicalDevice(),
+                       timestamps->getQueryPool(), nullptr);
+  }
 
-  vkDestroyPipeline(deviceManager->getLogicalDevice(),
-                    computePipeline->getComputePipeline(), nullptr);
+  computePipeline->cleanup(*deviceManager);
+
+  if (wavefrontPipeline) {
+    wavefrontPipeline->cleanup(*deviceManager);
+  }
+}
+
+void odin::Application::cleanupHeadless() {
+  vkDestroyImageView(deviceManager->getLogicalDevice(),
+                     storageImage->getImageView(), nullptr);
+  vkDestroyImage(deviceManager->getLogicalDevice(), storageImage->getImage(),
+                 nullptr);
+  deviceManager->getMemoryAllocator().free(storageImage->getImageMemory());
+
+  vkDestroyDescriptorPool(deviceManager->getLogicalDevice(),
+                          descriptorPool->getDescriptorPool(), nullptr);
+
+  vkDestroyBuffer(deviceManager->getLogicalDevice(), computeUbo->getBuffer(),
+                  nullptr);
+  deviceManager->getMemoryAllocator().free(computeUbo->getDeviceMemory());
+
+  cleanupComputePipeline();
+
+  vkDestroyDescriptorSetLayout(
+      deviceManager->getLogicalDevice(),
+      *graphicsDescriptorSetLayout->getDescriptorSetLayout(), nullptr);
+
+  vkDestroyDescriptorSetLayout(
+      deviceManager->getLogicalDevice(),
+      *computeDescriptorSetLayout->getDescriptorSetLayout(), nullptr);
+
+  vkDestroyBuffer(deviceManager->getLogicalDevice(), bvhBuffer->getBuffer(),
+                  nullptr);
+  deviceManager->getMemoryAllocator().free(bvhBuffer->getBufferMemory());
+  vkDestroyBuffer(deviceManager->getLogicalDevice(),
+                  bvhBuffer->getTriangleBuffer(), nullptr);
+  deviceManager->getMemoryAllocator().free(
+      bvhBuffer->getTriangleBufferMemory());
+
+  vkDestroyBuffer(deviceManager->getLogicalDevice(),
+                  accumulationBuffer->getBuffer(), nullptr);
+  deviceManager->getMemoryAllocator().free(
+      accumulationBuffer->getDeviceMemory());
+
+  vkDestroyCommandPool(deviceManager->getLogicalDevice(),
+                       commandPool->getComputeCommandPool(), nullptr);
+
+  commandPool->cleanupTransientCommands(deviceManager->getLogicalDevice());
+
+  stagingRing->cleanup(*deviceManager);
+
+  // Compiled pipelines are reused by the next run
+  deviceManager->getPipelineCache().save();
+  deviceManager->getPipelineCache().cleanup();
+
+  // Releases the memory blocks of all buffers and images
+  deviceManager->getMemoryAllocator().cleanup();
+  vkDestroyDevice(deviceManager->getLogicalDevice(), nullptr);
 }
 
 void odin::Application::cleanupSwapChain() {
@@ -136,43 +243,161 @@ void odin::Application::cleanupSwapChain() {
   vkDestroyBuffer(deviceManager->getLogicalDevice(), computeUbo->getBuffer(),
                   nullptr);
 
-  vkFreeMemory(deviceManager->getLogicalDevice(), computeUbo->getDeviceMemory(),
-               nullptr);
+  deviceManager->getMemoryAllocator().free(computeUbo->getDeviceMemory());
 
   vkDestroyDescriptorPool(deviceManager->getLogicalDevice(),
                           descriptorPool->getDescriptorPool(), nullptr);
 }
 
+void odin::Application::createAccumulationBuffer() {
+  // One RGBA float sum per pixel of the output image
+  VkDeviceSize bufferSize = sizeof(glm::vec4) * WIDTH * HEIGHT;
+  accumulationBuffer =
+      std::make_unique<StorageBuffer>(*deviceManager, bufferSize);
+}
+
 void odin::Application::createBvh() {
+  // Build the scene with every builder first so that they can be compared.
+  // The builders reorder the triangles, so each one works on a copy
+  std::vector<BvhStats> builds;
+  if (bvhBenchmark) {
+    for (BvhBuildMode mode : {BvhBuildMode::Median, BvhBuildMode::Sah,
+                              BvhBuildMode::Lbvh, BvhBuildMode::Sbvh}) {
+      std::vector<Triangle> sceneTriangles = triangles;
+      BvhBuildOptions options = bvhOptions;
+      options.mode = mode;
+      BVH benchmarkBvh;
+      builds.push_back(buildBvh(benchmarkBvh, sceneTriangles, options));
+    }
+  }
+
   std::cout << "Building BVH" << std::endl;
-  bvh.init(triangles);
-  std::cout << "Finished building BVH" << std::endl;
+  BvhStats stats = buildBvh(bvh, triangles, bvhOptions);
+  std::cout << "Finished building BVH in " << stats.buildTime
+            << " ms. Nodes: " << bvh.nodes.size()
+            << " Triangle references: " << bvh.triangles.size() << std::endl;
+  if (!bvhBenchmark) {
+    stats.print(std::cout);
+    builds.push_back(stats);
+  }
+
+  if (!bvhStatsPath.empty()) {
+    BvhStats::writeJsonFile(bvhStatsPath, MODEL_PATH, builds);
+    std::cout << "Wrote BVH stats to " << bvhStatsPath << std::endl;
+  }
+
+  if (bvhWidth > 2) {
+    wideBvh.init(bvh, bvhWidth);
+    std::cout << "Collapsed BVH to width " << bvhWidth
+              << ". Nodes: " << wideBvh.numNodes << std::endl;
+  }
+}
+
+odin::BvhStats odin::Application::buildBvh(BVH &target,
+                                           std::vector<Triangle> &sceneTriangles,
+                                           const BvhBuildOptions &options) {
+  auto startTime = std::chrono::high_resolution_clock::now();
+  target.init(sceneTriangles, options);
+  auto endTime = std::chrono::high_resolution_clock::now();
+  float buildTime =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          endTime - startTime)
+          .count();
+
+  BvhStats stats;
+  stats.compute(target, options, sceneTriangles.size(), buildTime);
+  if (bvhBenchmark) {
+    stats.print(std::cout);
+  }
+  return stats;
 }
 
 void odin::Application::createBvhBuffer() {
-  bvhBuffer =
-      std::make_unique<BvhBuffer>(*deviceManager, *commandPool, bvh.nodes);
+  if (accelerationStructure == AccelerationStructure::KdTree) {
+    bvhBuffer =
+        std::make_unique<BvhBuffer>(*deviceManager, *stagingRing, kdTree);
+  } else if (bvhWidth > 2) {
+    bvhBuffer = std::make_unique<BvhBuffer>(*deviceManager, *stagingRing, bvh,
+                                            wideBvh);
+  } else {
+    bvhBuffer =
+        std::make_unique<BvhBuffer>(*deviceManager, *stagingRing, bvh);
+  }
 }
 
 void odin::Application::createCommandBuffers() {
-  commandPool->createComputeCommandBuffers(
-      deviceManager->getLogicalDevice(), *renderPass, *computePipeline,
-      *descriptorPool, textureImage->getWidth(), textureImage->getHeight());
-
+  // The compute command buffer is recorded for every batch of tiles
   commandPool->createGraphicsCommandBuffers(
       deviceManager->getLogicalDevice(), *renderPass, *graphicsPipeline,
-      *descriptorPool, *swapChain, *textureImage);
+      *descriptorPool, *swapChain, outputImages);
 }
 
 void odin::Application::createCommandPool() {
-  commandPool =
-      std::make_unique<CommandPool>(deviceManager->getLogicalDevice(),
-                                    deviceManager->findQueueFamilies(surface));
+  commandPool = std::make_unique<CommandPool>(
+      deviceManager->getLogicalDevice(),
+      deviceManager->findQueueFamilies(surface), frameSlots);
 }
 
 void odin::Application::createComputePipeline() {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(deviceManager->getPhysicalDevice(),
+                                &properties);
+  if (!fitsWorkGroupLimits(properties.limits, workGroupWidth,
+                           workGroupHeight)) {
+    throw std::runtime_error("Work group size exceeds the device limits!");
+  }
+
+  ComputeSpecialization specialization;
+  specialization.bvhWidth = static_cast<uint32_t>(bvhWidth);
+  specialization.accelerationStructure =
+      static_cast<uint32_t>(accelerationStructure);
+  specialization.numSamples = samplesPerFrame;
+  specialization.numBounces = numBounces;
+  specialization.workGroupWidth = workGroupWidth;
+  specialization.workGroupHeight = workGroupHeight;
   computePipeline = std::make_unique<ComputePipeline>(
-      *deviceManager, *computeDescriptorSetLayout, COMPUTE_SHADER_PATH);
+      *deviceManager, *computeDescriptorSetLayout, COMPUTE_SHADER_PATH,
+      specialization);
+
+  if (wavefrontRender) {
+    std::cout << "Tracing paths with the wavefront kernels" << std::endl;
+    if (persistentGroups > 0) {
+      std::cout << "Extending paths with " << persistentGroups
+                << " persistent work groups" << std::endl;
+    }
+    if (sortRays) {
+      std::cout << "Sorting the rays of the secondary bounces" << std::endl;
+    }
+    WavefrontOptions options;
+    options.maxTiles = static_cast<uint32_t>(tileScheduler->getTileCount());
+    options.numSlots = frameSlots;
+    options.persistentGroups = persistentGroups;
+    options.sortRays = sortRays;
+    wavefrontPipeline = std::make_unique<WavefrontPipeline>(
+        *deviceManager, *computeDescriptorSetLayout,
+        WAVEFRONT_SHADER_DIRECTORY, specialization,
+        deviceManager->findQueueFamilies(surface).computeFamily.value(),
+        options);
+  }
+}
+
+void odin::Application::createComputeScheduler() {
+  computeTimestamps.clear();
+  for (uint32_t slot = 0; slot < frameSlots; slot++) {
+    computeTimestamps.push_back(std::make_unique<TimestampQuery>(
+        *deviceManager,
+        deviceManager->findQueueFamilies(surface).computeFamily.value()));
+  }
+  submittedTiles.assign(frameSlots, 0);
+
+  // The batches can only follow the budget if their time can be measured
+  float budget = frameBudget;
+  if (!computeTimestamps[0]->isSupported() && budget > 0.0f) {
+    std::cout << "Compute queue has no timestamps. Dispatching whole frames"
+              << std::endl;
+    budget = 0.0f;
+  }
+  tileScheduler = std::make_unique<TileScheduler>(WIDTH, HEIGHT, budget);
 }
 
 void odin::Application::createDepthResources() {
@@ -181,15 +406,26 @@ void odin::Application::createDepthResources() {
 }
 
 void odin::Application::createDescriptorPool() {
-  // Grab all of the needed descriptors for binding
-  std::vector<VkDescriptorBufferInfo> bufferInfos;
-  bufferInfos.push_back(computeUbo->getDescriptor());
-  bufferInfos.push_back(bvhBuffer->getDescriptor());
+  // Grab all of the needed descriptors for binding. Only the UBO differs
+  // between the frame slots
+  std::vector<std::vector<VkDescriptorBufferInfo>> bufferInfos(frameSlots);
+  for (uint32_t slot = 0; slot < frameSlots; slot++) {
+    bufferInfos[slot].push_back(computeUbo->getDescriptor(slot));
+    bufferInfos[slot].push_back(bvhBuffer->getDescriptor());
+    bufferInfos[slot].push_back(bvhBuffer->getTriangleDescriptor());
+    bufferInfos[slot].push_back(accumulationBuffer->getDescriptor());
+    if (wavefrontPipeline) {
+      for (const VkDescriptorBufferInfo &info :
+           wavefrontPipeline->getDescriptors()) {
+        bufferInfos[slot].push_back(info);
+      }
+    }
+  }
 
   // This also creates the necessary VkDescriptorSets
   descriptorPool = std::make_unique<DescriptorPool>(
       *deviceManager, *swapChain, *computeDescriptorSetLayout,
-      *graphicsDescriptorSetLayout, *textureImage, *textureSampler,
+      *graphicsDescriptorSetLayout, outputImages, *textureSampler,
       bufferInfos);
 }
 
@@ -202,8 +438,8 @@ void odin::Application::createDescriptorSetLayouts() {
 }
 
 void odin::Application::createDeviceManager() {
-  deviceManager = std::make_unique<DeviceManager>(*instance, surface,
-                                                  enableValidationLayers);
+  deviceManager = std::make_unique<DeviceManager>(
+      *instance, surface, enableValidationLayers, pipelineCacheDirectory);
 }
 
 void odin::Application::createFrameBuffers() {
@@ -213,12 +449,30 @@ void odin::Application::createFrameBuffers() {
 
 void odin::Application::createGraphicsPipeline() {
   graphicsPipeline = std::make_unique<GraphicsPipeline>(
-      deviceManager->getLogicalDevice(), *swapChain, *renderPass,
-      *graphicsDescriptorSetLayout, VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH);
+      deviceManager->getLogicalDevice(),
+      deviceManager->getPipelineCache().getPipelineCache(), *swapChain,
+      *renderPass, *graphicsDescriptorSetLayout, VERTEX_SHADER_PATH,
+      FRAGMENT_SHADER_PATH);
 }
 
 void odin::Application::createInstance() {
-  instance = std::make_unique<odin::Instance>(enableValidationLayers);
+  instance = std::make_unique<odin::Instance>(enableValidationLayers,
+                                              headlessRender);
+}
+
+void odin::Application::createKdTree() {
+  std::cout << "Building k-d tree" << std::endl;
+  auto startTime = std::chrono::high_resolution_clock::now();
+  kdTree.init(triangles);
+  auto endTime = std::chrono::high_resolution_clock::now();
+  float buildTime =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          endTime - startTime)
+          .count();
+  std::cout << "Finished building k-d tree in " << buildTime
+            << " ms. Nodes: " << kdTree.nodes.size()
+            << " Triangle references: " << kdTree.triangles.size()
+            << std::endl;
 }
 
 void odin::Application::createRenderPass() {
@@ -227,6 +481,11 @@ void odin::Application::createRenderPass() {
       DepthImage::findDepthFormat(*deviceManager));
 }
 
+void odin::Application::createStagingRing() {
+  stagingRing = std::make_unique<StagingRing>(
+      *deviceManager, deviceManager->findQueueFamilies(surface));
+}
+
 void odin::Application::createSurface() {
   if (glfwCreateWindowSurface(instance->getInstance(), window, nullptr,
                               &surface) != VK_SUCCESS) {
@@ -266,15 +525,26 @@ void odin::Application::createSyncObjects() {
     }
   }
 
-  if (vkCreateFence(deviceManager->getLogicalDevice(), &fenceInfo, nullptr,
-                    &computeFence) != VK_SUCCESS) {
-    throw std::runtime_error("Unable to create fence for compute pipeline!");
+  computeFences.resize(frameSlots);
+  computeFinishedSemaphores.resize(frameSlots);
+  for (uint32_t slot = 0; slot < frameSlots; slot++) {
+    if (vkCreateFence(deviceManager->getLogicalDevice(), &fenceInfo, nullptr,
+                      &computeFences[slot]) != VK_SUCCESS ||
+        vkCreateSemaphore(deviceManager->getLogicalDevice(), &semaphoreInfo,
+                          nullptr,
+                          &computeFinishedSemaphores[slot]) != VK_SUCCESS) {
+      throw std::runtime_error("Unable to create fence for compute pipeline!");
+    }
   }
 }
 
 void odin::Application::createTextureImage() {
-  textureImage = std::make_unique<TextureImage>(
-      *deviceManager, *commandPool, *swapChain, *textureSampler, WIDTH, HEIGHT);
+  outputImages.clear();
+  for (uint32_t slot = 0; slot < frameSlots; slot++) {
+    outputImages.push_back(std::make_unique<TextureImage>(
+        *deviceManager, *commandPool, *swapChain, *textureSampler, WIDTH,
+        HEIGHT));
+  }
 }
 
 void odin::Application::createTextureSampler() {
@@ -282,33 +552,25 @@ void odin::Application::createTextureSampler() {
 }
 
 void odin::Application::createUniformBuffers() {
-  // Initialize camera
-  glm::vec3 lookFrom(0.0f, 0.0f, 6.0f);
-  glm::vec3 lookAt(0.0f, 0.0f, -1.0f);
-  float distToFocus = glm::length(lookFrom - lookAt);
-  float aperture = 2.0;
-
-  camera.init(lookFrom, lookAt, glm::vec3(0.0f, 1.0f, 0.0f), 20,
-              static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), aperture,
-              distToFocus);
-
-  // Create a UBO to pass various information to the compute shader
+  // Create a UBO to pass the camera to the compute shader. Every frame slot
+  // has its own copy, so that a slot can be updated while the others are in
+  // flight
   VkDeviceSize bufferSize = sizeof(Camera);
-  computeUbo = std::make_unique<UniformBuffer>(*deviceManager, bufferSize);
-
-  // Copy camera data into memory
-  void *data;
-  vkMapMemory(deviceManager->getLogicalDevice(), computeUbo->getDeviceMemory(),
-              0, sizeof(Camera), 0, &data);
-  memcpy(data, &camera, sizeof(Camera));
-  vkUnmapMemory(deviceManager->getLogicalDevice(),
-                computeUbo->getDeviceMemory());
+  computeUbo =
+      std::make_unique<UniformBuffer>(*deviceManager, bufferSize, frameSlots);
+  for (uint32_t slot = 0; slot < frameSlots; slot++) {
+    updateUniformBuffer(slot);
+  }
 }
 
 void odin::Application::drawFrame() {
-  vkWaitForFences(deviceManager->getLogicalDevice(), 1,
-                  &inFlightFences[currentFrame], VK_TRUE,
-                  std::numeric_limits<uint64_t>::max());
+  // The CPU only waits when the graphics and compute submissions of this
+  // slot from MAX_FRAMES_IN_FLIGHT frames ago are still executing
+  std::array<VkFence, 2> slotFences = {inFlightFences[currentFrame],
+                                       computeFences[currentFrame]};
+  vkWaitForFences(deviceManager->getLogicalDevice(),
+                  static_cast<uint32_t>(slotFences.size()), slotFences.data(),
+                  VK_TRUE, std::numeric_limits<uint64_t>::max());
 
   uint32_t imageIndex;
   VkResult result = vkAcquireNextImageKHR(
@@ -323,21 +585,34 @@ void odin::Application::drawFrame() {
     throw std::runtime_error("Failed to acquire swap chain image!");
   }
 
-  updateUniformBuffer(imageIndex);
+  uint32_t slot = static_cast<uint32_t>(currentFrame);
+  measureComputeTiles(slot);
+
+  // The previous compute pass of this slot is done reading its camera
+  updateUniformBuffer(slot);
+
+  vkResetFences(deviceManager->getLogicalDevice(), 1, &computeFences[slot]);
+  if (submitComputeTiles(slot)) {
+    // The next compute pass adds to the samples of this one
+    frameIndex++;
+  }
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+  // Only the fragment shader has to wait for the output image of the slot
+  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame],
+                                  computeFinishedSemaphores[slot]};
   VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+  submitInfo.waitSemaphoreCount = 2;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers =
-      commandPool->getGraphicsCommandBuffer(imageIndex);
+      commandPool->getGraphicsCommandBuffer(slot, imageIndex);
 
   VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
   submitInfo.signalSemaphoreCount = 1;
@@ -375,45 +650,118 @@ void odin::Application::drawFrame() {
     throw std::runtime_error("Failed to present swap chain image!");
   }
 
-  // Wait for compute buffer to before submitting again
-  vkWaitForFences(deviceManager->getLogicalDevice(), 1, &computeFence, VK_TRUE,
-                  UINT64_MAX);
-  vkResetFences(deviceManager->getLogicalDevice(), 1, &computeFence);
+  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
 
-  VkSubmitInfo computeSubmitInfo = {};
-  computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  computeSubmitInfo.commandBufferCount = 1;
-  computeSubmitInfo.pCommandBuffers = commandPool->getComputeCommandBuffer();
+void odin::Application::initCamera() {
+  glm::vec3 lookFrom(0.0f, 0.0f, 6.0f);
+  glm::vec3 lookAt(0.0f, 0.0f, -1.0f);
+  float distToFocus = glm::length(lookFrom - lookAt);
+  float aperture = 2.0;
 
-  if (vkQueueSubmit(deviceManager->getComputeQueue(), 1, &computeSubmitInfo,
-                    computeFence) != VK_SUCCESS) {
-    throw std::runtime_error("Unable to submit to compute queue!");
+  camera.init(lookFrom, lookAt, glm::vec3(0.0f, 1.0f, 0.0f), 20,
+              static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), aperture,
+              distToFocus);
+  frameIndex = 0;
+}
+
+// Creates only what the compute pipeline needs. There is no window, surface
+// or swapchain, so this also works on render nodes without a display and on
+// software implementations such as lavapipe
+void odin::Application::initHeadless() {
+  createInstance();
+  createDeviceManager();
+  initCamera();
+  createUniformBuffers();
+  loadModel();
+  if (accelerationStructure == AccelerationStructure::KdTree) {
+    createKdTree();
+  } else {
+    createBvh();
   }
+  createDescriptorSetLayouts();
+  createCommandPool();
+  createStagingRing();
+  createBvhBuffer();
+  createComputeScheduler();
+  storageImage = std::make_unique<StorageImage>(*deviceManager, *commandPool,
+                                                WIDTH, HEIGHT);
+  createComputePipeline();
+  createAccumulationBuffer();
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  std::vector<VkDescriptorBufferInfo> bufferInfos;
+  bufferInfos.push_back(computeUbo->getDescriptor());
+  bufferInfos.push_back(bvhBuffer->getDescriptor());
+  bufferInfos.push_back(bvhBuffer->getTriangleDescriptor());
+  bufferInfos.push_back(accumulationBuffer->getDescriptor());
+  if (wavefrontPipeline) {
+    for (const VkDescriptorBufferInfo &info :
+         wavefrontPipeline->getDescriptors()) {
+      bufferInfos.push_back(info);
+    }
+  }
+  descriptorPool = std::make_unique<DescriptorPool>(
+      *deviceManager, *computeDescriptorSetLayout,
+      storageImage->getDescriptor(), bufferInfos);
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  computeFences.resize(1);
+  if (vkCreateFence(deviceManager->getLogicalDevice(), &fenceInfo, nullptr,
+                    &computeFences[0]) != VK_SUCCESS) {
+    throw std::runtime_error("Unable to create fence for compute pipeline!");
+  }
+
+  // The layout transition of the storage image and the uploads finish
+  // before the first dispatch
+  commandPool->waitTransientCommands(*deviceManager);
+  stagingRing->wait(*deviceManager);
+
+  if (tuneWorkGroup) {
+    tuneWorkGroupSize();
+  }
 }
 
 void odin::Application::initVulkan() {
+  // Compute and graphics of one frame overlap with those of the others
+  frameSlots = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
   createInstance();
   createSurface();
   createDeviceManager();
+  initCamera();
   createUniformBuffers();
   loadModel();
-  createBvh();
+  if (accelerationStructure == AccelerationStructure::KdTree) {
+    createKdTree();
+  } else {
+    createBvh();
+  }
   createDescriptorSetLayouts();
   createSwapChain();
   createRenderPass();
   createCommandPool();
+  // The acceleration structure uploads while the pipelines are created
+  createStagingRing();
+  createBvhBuffer();
+  createComputeScheduler();
   createTextureSampler();
   createTextureImage();
   createGraphicsPipeline();
   createComputePipeline();
-  createBvhBuffer();
+  createAccumulationBuffer();
   createDescriptorPool();
   createDepthResources();
   createFrameBuffers();
   createSyncObjects();
   createCommandBuffers();
+
+  // The layout transitions of all images run in one submission
+  commandPool->waitTransientCommands(*deviceManager);
+  stagingRing->wait(*deviceManager);
+
+  if (tuneWorkGroup) {
+    tuneWorkGroupSize();
+  }
 }
 
 void odin::Application::initWindow() {
@@ -483,12 +831,95 @@ void odin::Application::mainLoop() {
   vkDeviceWaitIdle(deviceManager->getLogicalDevice());
 }
 
+void odin::Application::measureComputeTiles(uint32_t slot) {
+  if (submittedTiles[slot] > 0 && computeTimestamps[slot]->isSupported()) {
+    tileScheduler->reportTime(
+        submittedTiles[slot],
+        computeTimestamps[slot]->getElapsedTime(*deviceManager));
+  }
+  if (submittedTiles[slot] > 0 && wavefrontPipeline) {
+    wavefrontPipeline->addStats(*deviceManager, slot, submittedTiles[slot],
+                                wavefrontStats);
+  }
+  submittedTiles[slot] = 0;
+}
+
 int odin::Application::parseArguments(int argc, char *argv[]) {
+  std::string accel;
+  std::string bvhBuilder;
+  std::string cpuSimd;
+  std::string workGroup;
   po::options_description desc("Allowed options");
   desc.add_options()("help", "Produce help message")(
       "demo", "Runs odin with pre-defined values")(
       "obj", po::value<std::string>(&MODEL_PATH), "OBJ model file path")(
-      "tex", po::value<std::string>(&TEXTURE_PATH), "Texture file path");
+      "tex", po::value<std::string>(&TEXTURE_PATH), "Texture file path")(
+      "accel", po::value<std::string>(&accel)->default_value("bvh"),
+      "Acceleration structure to trace against (bvh, kdtree)")(
+      "bvh", po::value<std::string>(&bvhBuilder)->default_value("sah"),
+      "BVH builder to use (sah, median, lbvh, sbvh)")(
+      "bvh-bins", po::value<int>(&bvhOptions.numBins)->default_value(16),
+      "Number of bins evaluated by the SAH builder (2-64)")(
+      "bvh-leaf-size",
+      po::value<int>(&bvhOptions.maxLeafSize)->default_value(4),
+      "Maximum number of triangles in a BVH leaf (1-16)")(
+      "bvh-threads",
+      po::value<unsigned>(&bvhOptions.numThreads)->default_value(0),
+      "Number of threads used to build the BVH (0 uses all cores)")(
+      "bvh-morton-bits",
+      po::value<int>(&bvhOptions.mortonBits)->default_value(30),
+      "Size of the Morton codes used by the LBVH builder (30 or 63)")(
+      "bvh-split-budget",
+      po::value<float>(&bvhOptions.splitBudget)->default_value(0.3f),
+      "Extra triangle references the SBVH may create per triangle")(
+      "bvh-width", po::value<int>(&bvhWidth)->default_value(2),
+      "Number of children per BVH node used for traversal (2, 4 or 8). The "
+      "binary BVH is traversed unless a wide one is asked for")(
+      "bvh-stats", po::value<std::string>(&bvhStatsPath),
+      "Write the quality stats of the BVH to a JSON file")(
+      "bvh-benchmark",
+      "Build the scene with every BVH builder and report their stats")(
+      "cpu", "Render a single image on the CPU instead of opening a window")(
+      "headless",
+      "Render a single image with Vulkan compute without opening a window")(
+      "samples", po::value<uint32_t>(&numSamples)->default_value(16),
+      "Samples per pixel of the headless renderer, rounded up to whole "
+      "frames of --frame-samples")(
+      "frame-samples",
+      po::value<uint32_t>(&samplesPerFrame)->default_value(16),
+      "Samples per pixel that every frame of the compute shaders adds, and "
+      "of the image of the CPU renderer")(
+      "bounces", po::value<uint32_t>(&numBounces)->default_value(3),
+      "Most bounces of a path traced by the compute shaders and the CPU "
+      "renderer")(
+      "work-group", po::value<std::string>(&workGroup)->default_value("16x16"),
+      "Work group size of the compute megakernel as WxH, or auto to time "
+      "candidates on the device at startup")(
+      "frame-budget", po::value<float>(&frameBudget)->default_value(16.0f),
+      "GPU milliseconds a single compute submission may take. The image is "
+      "rendered in tiles over several submissions to stay within it (0 "
+      "renders whole frames)")(
+      "output", po::value<std::string>(&outputPath)->default_value("odin.png"),
+      "PNG file the CPU and headless renderers write to")(
+      "cpu-simd", po::value<std::string>(&cpuSimd)->default_value("auto"),
+      "Instruction set used to trace camera rays on the CPU (auto, avx2, "
+      "sse, scalar)")(
+      "wavefront",
+      "Trace paths with separate generation, extension and shading kernels "
+      "instead of the compute megakernel")(
+      "persistent-groups",
+      po::value<uint32_t>(&persistentGroups)->default_value(0),
+      "Work groups of persistent threads that fetch the rays of the "
+      "wavefront extension stage from a global queue (0 dispatches a thread "
+      "per ray)")(
+      "sort-rays",
+      "Sort the rays of the secondary bounces of the wavefront kernels by "
+      "direction and origin before extending them")(
+      "pipeline-cache",
+      po::value<std::string>(&pipelineCacheDirectory)
+          ->default_value(PipelineCache::getDefaultDirectory()),
+      "Directory the compiled pipelines are cached in between runs (empty "
+      "disables the cache)");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -499,10 +930,96 @@ int odin::Application::parseArguments(int argc, char *argv[]) {
     return 1;
   }
 
+  if (accel == "bvh") {
+    accelerationStructure = AccelerationStructure::Bvh;
+  } else if (accel == "kdtree") {
+    accelerationStructure = AccelerationStructure::KdTree;
+  } else {
+    std::cout << "Unknown acceleration structure: " << accel << std::endl;
+    return 1;
+  }
+
+  if (bvhBuilder == "sah") {
+    bvhOptions.mode = BvhBuildMode::Sah;
+  } else if (bvhBuilder == "median") {
+    bvhOptions.mode = BvhBuildMode::Median;
+  } else if (bvhBuilder == "lbvh") {
+    bvhOptions.mode = BvhBuildMode::Lbvh;
+  } else if (bvhBuilder == "sbvh") {
+    bvhOptions.mode = BvhBuildMode::Sbvh;
+  } else {
+    std::cout << "Unknown BVH builder: " << bvhBuilder << std::endl;
+    return 1;
+  }
+
+  if (cpuSimd == "auto") {
+    packetIsa = PacketIsa::Auto;
+  } else if (cpuSimd == "avx2") {
+    packetIsa = PacketIsa::Avx2;
+  } else if (cpuSimd == "sse") {
+    packetIsa = PacketIsa::Sse;
+  } else if (cpuSimd == "scalar") {
+    packetIsa = PacketIsa::Scalar;
+  } else {
+    std::cout << "Unknown CPU instruction set: " << cpuSimd << std::endl;
+    return 1;
+  }
+
+  bvhBenchmark = vm.count("bvh-benchmark") > 0;
+  cpuRender = vm.count("cpu") > 0;
+  headlessRender = vm.count("headless") > 0;
+  wavefrontRender = vm.count("wavefront") > 0;
+  sortRays = vm.count("sort-rays") > 0;
+
+  if (persistentGroups > 0 && !wavefrontRender) {
+    std::cout << "Persistent work groups need the wavefront kernels"
+              << std::endl;
+    return 1;
+  }
+  if (sortRays && !wavefrontRender) {
+    std::cout << "Sorting rays needs the wavefront kernels" << std::endl;
+    return 1;
+  }
+
+  if (samplesPerFrame == 0) {
+    std::cout << "Frames need at least one sample" << std::endl;
+    return 1;
+  }
+  // The traced ray counters of the wavefront kernels have a fixed layout
+  if (numBounces == 0 ||
+      (wavefrontRender && numBounces != WavefrontPipeline::NUM_BOUNCES)) {
+    std::cout << "Unsupported number of bounces: " << numBounces << std::endl;
+    return 1;
+  }
+
+  if (workGroup == "auto") {
+    if (wavefrontRender) {
+      std::cout << "Tuning the work group size needs the megakernel"
+                << std::endl;
+      return 1;
+    }
+    tuneWorkGroup = true;
+  } else {
+    char separator = 0;
+    std::istringstream stream(workGroup);
+    if (!(stream >> workGroupWidth >> separator >> workGroupHeight) ||
+        separator != 'x' || !stream.eof() || workGroupWidth == 0 ||
+        workGroupHeight == 0) {
+      std::cout << "Invalid work group size: " << workGroup << std::endl;
+      return 1;
+    }
+  }
+
+  if (bvhWidth != 2 && bvhWidth != 4 && bvhWidth != 8) {
+    std::cout << "Unsupported BVH width: " << bvhWidth << std::endl;
+    return 1;
+  }
+
   // Set these by default
   COMPUTE_SHADER_PATH = "shaders/comp.spv";
   FRAGMENT_SHADER_PATH = "shaders/frag.spv";
   VERTEX_SHADER_PATH = "shaders/vert.spv";
+  WAVEFRONT_SHADER_DIRECTORY = "shaders/";
 
   // Check if we have enabled demo mode
   if (vm.count("demo")) {
@@ -521,6 +1038,11 @@ int odin::Application::parseArguments(int argc, char *argv[]) {
     return 1;
   }
 
+  // The offline renderers do not display the image in a textured window
+  if (cpuRender || headlessRender) {
+    return 0;
+  }
+
   if (vm.count("tex")) {
     std::cout << "Texture file path: " << TEXTURE_PATH << std::endl;
   } else {
@@ -532,6 +1054,53 @@ int odin::Application::parseArguments(int argc, char *argv[]) {
   return 0;
 }
 
+void odin::Application::printMemoryStats() const {
+  if (!enableValidationLayers) {
+    return;
+  }
+
+  MemoryStats stats = deviceManager->getMemoryAllocator().getStats();
+  std::cout << "Device memory: " << stats.allocationCount
+            << " allocations in " << stats.blockCount << " blocks, "
+            << stats.usedBytes / 1024 << " of " << stats.blockBytes / 1024
+            << " KiB used, " << stats.freeRangeCount
+            << " free ranges, largest " << stats.largestFreeRange / 1024
+            << " KiB" << std::endl;
+}
+
+void odin::Application::printWavefrontStats() const {
+  if (!wavefrontPipeline) {
+    return;
+  }
+
+  // Secondary bounces are incoherent, which is where the persistent threads
+  // and sorting should pay off
+  std::cout << "Extension stage with "
+            << (wavefrontPipeline->isPersistent() ? "persistent threads"
+                                                  : "a thread per ray")
+            << (wavefrontPipeline->isSorting() ? " and sorted rays" : "")
+            << ":" << std::endl;
+  for (size_t bounce = 0; bounce < wavefrontStats.rays.size(); bounce++) {
+    std::cout << "  Bounce " << bounce << ": " << wavefrontStats.rays[bounce]
+              << " rays";
+    if (wavefrontStats.time[bounce] > 0.0) {
+      std::cout << " in " << wavefrontStats.time[bounce] << " ms, "
+                << wavefrontStats.rays[bounce] /
+                       (wavefrontStats.time[bounce] * 1000.0)
+                << " Mrays/s";
+    }
+    // The sort only pays off if the extension gains more than it costs
+    if (wavefrontStats.sortTime[bounce] > 0.0) {
+      double totalTime =
+          wavefrontStats.time[bounce] + wavefrontStats.sortTime[bounce];
+      std::cout << ", sorted in " << wavefrontStats.sortTime[bounce]
+                << " ms, " << wavefrontStats.rays[bounce] / (totalTime * 1000.0)
+                << " Mrays/s with sorting";
+    }
+    std::cout << std::endl;
+  }
+}
+
 void odin::Application::recreateSwapChain() {
   // This is done in case the window is minimized too small
   int width = 0, height = 0;
@@ -549,26 +1118,237 @@ void odin::Application::recreateSwapChain() {
   createGraphicsPipeline();
   createDepthResources();
   createFrameBuffers();
+  // The camera, the accumulated frames and the progress of the tile scheduler
+  // outlive the swapchain, so the copies of the camera are only written again
   createUniformBuffers();
   createDescriptorPool();
   createCommandBuffers();
+  commandPool->waitTransientCommands(*deviceManager);
+}
+
+void odin::Application::renderCpu() {
+  loadModel();
+  initCamera();
+  createBvh();
+
+  ThreadPool pool(bvhOptions.numThreads);
+  CpuRenderer renderer(bvh, pool, packetIsa, samplesPerFrame, numBounces);
+  std::cout << "Rendering on the CPU with " << renderer.getPacketIsaName()
+            << " packets" << std::endl;
+  std::vector<uint8_t> pixels;
+  auto startTime = std::chrono::high_resolution_clock::now();
+  renderer.render(camera, WIDTH, HEIGHT, pixels);
+  auto endTime = std::chrono::high_resolution_clock::now();
+  float renderTime =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          endTime - startTime)
+          .count();
+  std::cout << "Finished rendering in " << renderTime << " ms on "
+            << pool.getThreadCount() << " threads" << std::endl;
+
+  ImageWriter::writePng(outputPath, WIDTH, HEIGHT, pixels);
+  std::cout << "Wrote image to " << outputPath << std::endl;
+}
+
+void odin::Application::renderHeadless() {
+  initHeadless();
+
+  // Every pass adds the samples of one frame to the accumulation buffer
+  uint32_t numFrames = (numSamples + samplesPerFrame - 1) / samplesPerFrame;
+  std::cout << "Rendering headless with " << numFrames * samplesPerFrame
+            << " samples per pixel" << std::endl;
+  auto startTime = std::chrono::high_resolution_clock::now();
+  size_t numSubmissions = 0;
+  frameIndex = 0;
+  while (frameIndex < numFrames) {
+    updateUniformBuffer(0);
+    bool frameFinished = submitComputeTiles(0);
+    numSubmissions++;
+
+    vkWaitForFences(deviceManager->getLogicalDevice(), 1, &computeFences[0],
+                    VK_TRUE, UINT64_MAX);
+    vkResetFences(deviceManager->getLogicalDevice(), 1, &computeFences[0]);
+    measureComputeTiles(0);
+
+    if (frameFinished) {
+      frameIndex++;
+    }
+  }
+  auto endTime = std::chrono::high_resolution_clock::now();
+  float renderTime =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          endTime - startTime)
+          .count();
+  std::cout << "Finished rendering in " << renderTime << " ms with "
+            << numSubmissions << " submissions" << std::endl;
+  printWavefrontStats();
+  printMemoryStats();
+
+  std::vector<uint8_t> pixels;
+  storageImage->readPixels(*deviceManager, *commandPool, pixels);
+  // The compute shader does not write alpha
+  for (size_t i = 3; i < pixels.size(); i += 4) {
+    pixels[i] = 255;
+  }
+  ImageWriter::writePng(outputPath, WIDTH, HEIGHT, pixels);
+  std::cout << "Wrote image to " << outputPath << std::endl;
+
+  cleanupHeadless();
 }
 
 void odin::Application::run() {
+  if (cpuRender) {
+    renderCpu();
+    return;
+  }
+
+  if (headlessRender) {
+    renderHeadless();
+    return;
+  }
+
   initWindow();
   initVulkan();
   mainLoop();
+  printWavefrontStats();
+  printMemoryStats();
   cleanup();
 }
 
-// TODO Read up on what 'Push Constants' are. These are more efficient
-// compared to the current way of allocating UBOs
-void odin::Application::updateUniformBuffer(uint32_t currentImage) {
-  // Copy camera data into memory
-  void *data;
-  vkMapMemory(deviceManager->getLogicalDevice(), computeUbo->getDeviceMemory(),
-              0, sizeof(Camera), 0, &data);
-  memcpy(data, &camera, sizeof(Camera));
-  vkUnmapMemory(deviceManager->getLogicalDevice(),
-                computeUbo->getDeviceMemory());
+bool odin::Application::submitComputeTiles(uint32_t slot) {
+  std::vector<ComputeTile> tiles;
+  bool frameFinished = tileScheduler->nextBatch(tiles);
+
+  // A batch of only some tiles starts from the latest image, which the
+  // previous slot rendered
+  const TextureImage *previousImage = nullptr;
+  const TextureImage *outputImage = nullptr;
+  if (outputImages.size() > 1 && tiles.size() < tileScheduler->getTileCount()) {
+    previousImage =
+        outputImages[(slot + outputImages.size() - 1) % outputImages.size()]
+            .get();
+    outputImage = outputImages[slot].get();
+  }
+  // Every frame draws different samples
+  ComputePushConstants frameConstants = {};
+  frameConstants.frameIndex = frameIndex;
+  frameConstants.sampleSeed = frameIndex * samplesPerFrame;
+  commandPool->recordComputeCommandBuffer(
+      slot, *computePipeline, *descriptorPool, tiles, frameConstants,
+      *computeTimestamps[slot], wavefrontPipeline.get(), previousImage,
+      outputImage);
+
+  VkSubmitInfo computeSubmitInfo = {};
+  computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  computeSubmitInfo.commandBufferCount = 1;
+  computeSubmitInfo.pCommandBuffers =
+      commandPool->getComputeCommandBuffer(slot);
+  // The graphics submission of the slot samples the output image. There is
+  // none when rendering headless
+  if (!computeFinishedSemaphores.empty()) {
+    computeSubmitInfo.signalSemaphoreCount = 1;
+    computeSubmitInfo.pSignalSemaphores = &computeFinishedSemaphores[slot];
+  }
+
+  if (vkQueueSubmit(deviceManager->getComputeQueue(), 1, &computeSubmitInfo,
+                    computeFences[slot]) != VK_SUCCESS) {
+    throw std::runtime_error("Unable to submit to compute queue!");
+  }
+
+  submittedTiles[slot] = tiles.size();
+  return frameFinished;
+}
+
+void odin::Application::tuneWorkGroupSize() {
+  if (!computeTimestamps[0]->isSupported()) {
+    std::cout << "Compute queue has no timestamps. Keeping work groups of "
+              << workGroupWidth << "x" << workGroupHeight << std::endl;
+    return;
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(deviceManager->getPhysicalDevice(),
+                                &properties);
+
+  // Every candidate renders the whole frame in one submission
+  std::vector<ComputeTile> tiles;
+  TileScheduler(WIDTH, HEIGHT, 0.0f).nextBatch(tiles);
+  updateUniformBuffer(0);
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(deviceManager->getLogicalDevice(), &fenceInfo, nullptr,
+                    &fence) != VK_SUCCESS) {
+    throw std::runtime_error("Unable to create fence for work group tuning!");
+  }
+
+  ComputeSpecialization specialization = computePipeline->getSpecialization();
+  float bestTime = std::numeric_limits<float>::max();
+  for (const std::pair<uint32_t, uint32_t> &candidate :
+       WORK_GROUP_CANDIDATES) {
+    if (!fitsWorkGroupLimits(properties.limits, candidate.first,
+                             candidate.second)) {
+      continue;
+    }
+    specialization.workGroupWidth = candidate.first;
+    specialization.workGroupHeight = candidate.second;
+    ComputePipeline pipeline(*deviceManager, *computeDescriptorSetLayout,
+                             COMPUTE_SHADER_PATH, specialization);
+
+    float time = 0.0f;
+    for (int frame = 0; frame <= WORK_GROUP_TIMED_FRAMES; frame++) {
+      ComputePushConstants frameConstants = {};
+      frameConstants.frameIndex = 0;
+      frameConstants.sampleSeed = 0;
+      commandPool->recordComputeCommandBuffer(0, pipeline, *descriptorPool,
+                                              tiles, frameConstants,
+                                              *computeTimestamps[0]);
+
+      VkSubmitInfo submitInfo = {};
+      submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submitInfo.commandBufferCount = 1;
+      submitInfo.pCommandBuffers = commandPool->getComputeCommandBuffer(0);
+      if (vkQueueSubmit(deviceManager->getComputeQueue(), 1, &submitInfo,
+                        fence) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to submit to compute queue!");
+      }
+      vkWaitForFences(deviceManager->getLogicalDevice(), 1, &fence, VK_TRUE,
+                      UINT64_MAX);
+      vkResetFences(deviceManager->getLogicalDevice(), 1, &fence);
+
+      if (frame > 0) {
+        time += computeTimestamps[0]->getElapsedTime(*deviceManager);
+      }
+    }
+    time /= WORK_GROUP_TIMED_FRAMES;
+    std::cout << "Work groups of " << candidate.first << "x"
+              << candidate.second << ": " << time << " ms" << std::endl;
+
+    if (time < bestTime) {
+      bestTime = time;
+      workGroupWidth = candidate.first;
+      workGroupHeight = candidate.second;
+    }
+    pipeline.cleanup(*deviceManager);
+  }
+  vkDestroyFence(deviceManager->getLogicalDevice(), fence, nullptr);
+  std::cout << "Using work groups of " << workGroupWidth << "x"
+            << workGroupHeight << std::endl;
+
+  computePipeline->cleanup(*deviceManager);
+  specialization.workGroupWidth = workGroupWidth;
+  specialization.workGroupHeight = workGroupHeight;
+  computePipeline = std::make_unique<ComputePipeline>(
+      *deviceManager, *computeDescriptorSetLayout, COMPUTE_SHADER_PATH,
+      specialization);
+
+  // The timed frames wrote into the accumulation buffer
+  frameIndex = 0;
+}
+
+// Copies the camera into the mapped copy of a slot. The values that change
+// with every frame are pushed with the dispatches instead
+void odin::Application::updateUniformBuffer(uint32_t slot) {
+  computeUbo->write(slot, &camera, sizeof(Camera));
 }
\ No newline at end of file
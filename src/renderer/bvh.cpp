@@ -0,0 +1,1003 @@
+#include "renderer/bvh.hpp"
+
+#include "utils/arena.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace {
+// Past this depth the builder only does median splits, which halve the
+// triangle count on every level. This keeps the tree shallow enough for the
+// fixed size traversal stack in shaders/include/traversal.glsl
+const int MAX_SAH_DEPTH = 32;
+
+// LBVH subtrees deeper than this are rebuilt with median splits. Morton codes
+// of tightly clustered geometry share long prefixes and would otherwise
+// overflow the traversal stack
+const int MAX_LBVH_DEPTH = 40;
+
+// Subtrees with fewer triangles are built serially by a single task
+const size_t PARALLEL_SUBTREE_SIZE = 4096;
+
+// Marks an LBVH split without a child split on one side
+const uint32_t NO_SPLIT = std::numeric_limits<uint32_t>::max();
+
+// Nodes with at least this many triangles compute their bounds and bins in
+// parallel chunks. Only the top levels of the tree are this large
+const size_t PARALLEL_BINNING_SIZE = 1 << 16;
+const size_t PARALLEL_CHUNK_SIZE = 1 << 14;
+
+// Spatial splits are only evaluated for nodes whose object split children
+// overlap by more than this fraction of the surface area of the root
+const float SPATIAL_SPLIT_ALPHA = 1e-5f;
+
+// A bin used to sort triangle centroids along an axis for the SAH
+struct Bin {
+  odin::AABB box = odin::AABB::emptyBox();
+  size_t count = 0;
+};
+
+// A bin of the SBVH spatial split. Triangles are clipped to every bin they
+// overlap and counted in the bins in which they enter and exit
+struct SpatialBin {
+  odin::AABB box = odin::AABB::emptyBox();
+  size_t entries = 0;
+  size_t exits = 0;
+};
+
+// A triangle sorted by the Morton code of its centroid
+struct MortonPrimitive {
+  uint64_t code;
+  uint32_t index;
+};
+
+odin::AABB nodeBox(const odin::BvhNode &node) {
+  return odin::AABB{node.min, node.max};
+}
+
+void setNodeBox(odin::BvhNode &node, const odin::AABB &box) {
+  node.min = box.min;
+  node.max = box.max;
+}
+
+bool isEmpty(const odin::AABB &box) {
+  return box.min.x > box.max.x || box.min.y > box.max.y ||
+         box.min.z > box.max.z;
+}
+
+// Surface area of a box weighted by the number of triangles in it
+float weightedArea(const odin::AABB &box, size_t count) {
+  return count > 0 ? box.surfaceArea() * count : 0.0f;
+}
+
+// Share the free space of a range of references between its two children in
+// proportion to their size. Returns the start of the right child
+size_t rightChildBegin(size_t begin, size_t limit, size_t leftCount,
+                       size_t rightCount) {
+  size_t slack = limit - begin - leftCount - rightCount;
+  double leftShare =
+      static_cast<double>(leftCount) / static_cast<double>(leftCount + rightCount);
+  return begin + leftCount + static_cast<size_t>(slack * leftShare);
+}
+
+odin::BvhTriangle packTriangle(const odin::Triangle &triangle) {
+  odin::BvhTriangle packed;
+  packed.v0 = glm::vec4(triangle.v0, triangle.normal.x);
+  packed.v1 = glm::vec4(triangle.v1, triangle.normal.y);
+  packed.v2 = glm::vec4(triangle.v2, triangle.normal.z);
+  return packed;
+}
+
+int longestAxis(const odin::AABB &box) {
+  glm::vec3 extent = box.max - box.min;
+  if (extent.x > extent.y && extent.x > extent.z) {
+    return 0;
+  }
+  return extent.y > extent.z ? 1 : 2;
+}
+
+// Insert two zero bits in front of each of the lower 21 bits of x
+uint64_t expandBits(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+// Quantize a point inside of box to bitsPerAxis bits on every axis and
+// interleave the results into a single Morton code
+uint64_t mortonCode(const glm::vec3 &point, const odin::AABB &box,
+                    int bitsPerAxis) {
+  const float cells = static_cast<float>(1u << bitsPerAxis);
+  uint64_t code = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    float extent = box.max[axis] - box.min[axis];
+    float offset = extent > 0.0f ? (point[axis] - box.min[axis]) / extent : 0.0f;
+    float cell = std::min(std::max(offset * cells, 0.0f), cells - 1.0f);
+    code |= expandBits(static_cast<uint64_t>(cell)) << (2 - axis);
+  }
+  return code;
+}
+
+// LSD radix sort of the primitives by their Morton code, 8 bits per pass.
+// The sorted result always ends up in primitives
+void radixSort(MortonPrimitive *primitives, MortonPrimitive *scratch,
+               size_t count, int bits) {
+  MortonPrimitive *source = primitives;
+  MortonPrimitive *target = scratch;
+  for (int shift = 0; shift < bits; shift += 8) {
+    size_t offsets[256] = {};
+    for (size_t i = 0; i < count; i++) {
+      offsets[(source[i].code >> shift) & 0xff]++;
+    }
+
+    size_t offset = 0;
+    for (auto &bucket : offsets) {
+      size_t bucketSize = bucket;
+      bucket = offset;
+      offset += bucketSize;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      target[offsets[(source[i].code >> shift) & 0xff]++] = source[i];
+    }
+    std::swap(source, target);
+  }
+
+  if (source != primitives) {
+    std::copy(source, source + count, primitives);
+  }
+}
+
+size_t numChunks(odin::ThreadPool *pool, size_t begin, size_t end) {
+  size_t count = end - begin;
+  if (pool == nullptr || count < PARALLEL_BINNING_SIZE) {
+    return 1;
+  }
+  return (count + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+}
+
+// Split [begin, end) into numChunks() chunks and run
+// body(chunk, chunkBegin, chunkEnd) on each of them. The caller merges the
+// results in chunk order, which keeps them independent of the thread count
+template <typename Body>
+void forEachChunk(odin::ThreadPool *pool, size_t begin, size_t end,
+                  const Body &body) {
+  size_t chunks = numChunks(pool, begin, end);
+  if (chunks == 1) {
+    body(0, begin, end);
+    return;
+  }
+
+  odin::TaskGroup group(*pool);
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    size_t chunkBegin = begin + chunk * PARALLEL_CHUNK_SIZE;
+    size_t chunkEnd = std::min(end, chunkBegin + PARALLEL_CHUNK_SIZE);
+    group.run([&body, chunk, chunkBegin, chunkEnd]() {
+      body(chunk, chunkBegin, chunkEnd);
+    });
+  }
+  group.wait();
+}
+
+
+// Reorder the items so that items[i] becomes the old items[index(i)]. Every
+// cycle of the permutation is rotated in place and the indices are
+// overwritten to mark the items that were already moved
+template <typename T, typename Index>
+void permute(T *items, size_t count, const Index &index) {
+  for (size_t i = 0; i < count; i++) {
+    if (index(i) == i) {
+      continue;
+    }
+
+    T first = items[i];
+    size_t current = i;
+    while (index(current) != i) {
+      size_t next = index(current);
+      items[current] = items[next];
+      index(current) = static_cast<uint32_t>(current);
+      current = next;
+    }
+    items[current] = first;
+    index(current) = static_cast<uint32_t>(current);
+  }
+}
+}  // namespace
+
+void odin::BVH::init(std::vector<Triangle> &triangles,
+                     const BvhBuildOptions &options) {
+  if (triangles.size() == 0) {
+    throw std::runtime_error("No triangles available to build BVH!");
+  }
+
+  if (triangles.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Too many triangles to build BVH!");
+  }
+
+  if (options.numBins < 2 || options.numBins > MAX_BINS) {
+    throw std::runtime_error("BVH needs between 2 and 64 bins for the SAH!");
+  }
+
+  if (options.maxLeafSize < 1 || options.maxLeafSize > MAX_LEAF_SIZE) {
+    throw std::runtime_error("Unsupported BVH leaf size!");
+  }
+
+  if (options.mortonBits != 30 && options.mortonBits != 63) {
+    throw std::runtime_error("LBVH Morton codes need to be 30 or 63 bits!");
+  }
+
+  if (!(options.splitBudget >= 0.0f)) {
+    throw std::runtime_error("SBVH split budget cannot be negative!");
+  }
+
+  buildOptions = options;
+
+  // The SBVH can add references up to its budget
+  size_t count = triangles.size();
+  size_t capacity = count;
+  if (options.mode == BvhBuildMode::Sbvh) {
+    double budget = static_cast<double>(count) * options.splitBudget;
+    if (budget > std::numeric_limits<uint32_t>::max() - count) {
+      throw std::runtime_error("SBVH split budget is too large!");
+    }
+    capacity += static_cast<size_t>(budget);
+  }
+
+  // All per triangle data of the build comes from one allocation
+  size_t arenaSize = Arena::requiredSize<PrimitiveRef>(capacity);
+  if (options.mode == BvhBuildMode::Sbvh) {
+    arenaSize += Arena::requiredSize<PrimitiveRef>(capacity);
+  }
+  if (options.mode == BvhBuildMode::Lbvh) {
+    arenaSize += Arena::requiredSize<PrimitiveRef>(count) +
+                 2 * Arena::requiredSize<MortonPrimitive>(count) +
+                 3 * Arena::requiredSize<uint32_t>(count);
+  }
+  Arena arena(arenaSize);
+
+  primitives.refs = arena.allocate<PrimitiveRef>(capacity);
+  primitives.triangles = triangles.data();
+  primitives.capacity = capacity;
+  primitives.scratch = options.mode == BvhBuildMode::Sbvh
+                           ? arena.allocate<PrimitiveRef>(capacity)
+                           : nullptr;
+
+  // Compute the bounds of every triangle once so that the builder
+  // does not have to recompute them on every level
+  for (size_t i = 0; i < count; i++) {
+    AABB box;
+    triangles[i].boundingBox(box);
+    primitives.refs[i].boxMin = box.min;
+    primitives.refs[i].index = static_cast<uint32_t>(i);
+    primitives.refs[i].boxMax = box.max;
+    primitives.refs[i].padding = 0;
+  }
+
+  nodes.clear();
+  nodes.reserve(2 * count);
+  if (options.mode == BvhBuildMode::Lbvh) {
+    buildLbvh(count, arena);
+  } else if (options.mode == BvhBuildMode::Sbvh) {
+    AABB box, centroidBox;
+    computeBounds(0, count, box, centroidBox, nullptr);
+    buildSbvh(0, count, capacity, 0, box.surfaceArea());
+  } else if (options.numThreads == 1) {
+    buildBVH(0, count, 0, nodes);
+  } else {
+    // Build the top of the tree with parallel binning and hand independent
+    // subtrees to the pool. All split decisions are the same as in the
+    // serial builder, so stitching the subtrees together in depth-first
+    // order gives exactly the same node array
+    ThreadPool pool(options.numThreads);
+    Subtree root;
+    {
+      TaskGroup group(pool);
+      buildSubtree(pool, group, 0, count, 0, root);
+      group.wait();
+    }
+    appendSubtree(root);
+  }
+
+  if (options.mode == BvhBuildMode::Sbvh) {
+    // Close the gaps that unused budget left between the leaves. Leaves are
+    // stored in the same order as their references, so this moves every
+    // reference towards the front
+    size_t numRefs = 0;
+    for (BvhNode &node : nodes) {
+      if (node.count > 0) {
+        std::copy(primitives.refs + node.offset,
+                  primitives.refs + node.offset + node.count,
+                  primitives.refs + numRefs);
+        node.offset = static_cast<uint32_t>(numRefs);
+        numRefs += node.count;
+      }
+    }
+
+    this->triangles.resize(numRefs);
+    for (size_t i = 0; i < numRefs; i++) {
+      this->triangles[i] = packTriangle(triangles[primitives.refs[i].index]);
+    }
+    primitives = BuildPrimitives();
+    return;
+  }
+
+  // Store the triangles in the order in which the leaves reference them
+  permute(triangles.data(), count,
+          [this](size_t i) -> uint32_t & { return primitives.refs[i].index; });
+  primitives = BuildPrimitives();
+
+  this->triangles.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    this->triangles[i] = packTriangle(triangles[i]);
+  }
+}
+
+void odin::BVH::appendSubtree(const Subtree &subtree) {
+  if (!subtree.left) {
+    // Serially built subtrees index their nodes relative to their own root
+    uint32_t offset = static_cast<uint32_t>(nodes.size());
+    for (auto node : subtree.nodes) {
+      if (node.count == 0) {
+        node.offset += offset;
+      }
+      nodes.push_back(node);
+    }
+    return;
+  }
+
+  size_t nodeIndex = nodes.size();
+  nodes.push_back(subtree.node);
+  appendSubtree(*subtree.left);
+  nodes[nodeIndex].offset = static_cast<uint32_t>(nodes.size());
+  appendSubtree(*subtree.right);
+}
+
+void odin::BVH::buildBVH(size_t begin, size_t end, int depth,
+                         std::vector<BvhNode> &out) {
+  // Nodes are emitted in depth-first order with the root at index 0
+  size_t nodeIndex = out.size();
+  out.push_back(BvhNode());
+
+  AABB box, centroidBox;
+  computeBounds(begin, end, box, centroidBox, nullptr);
+  setNodeBox(out[nodeIndex], box);
+
+  // Small nodes become leaves unless splitting them is predicted to be
+  // cheaper than intersecting all of their triangles
+  size_t count = end - begin;
+  bool fitsLeaf = count <= static_cast<size_t>(buildOptions.maxLeafSize);
+  if (count == 1 || (fitsLeaf && buildOptions.mode != BvhBuildMode::Sah)) {
+    out[nodeIndex].offset = static_cast<uint32_t>(begin);
+    out[nodeIndex].count = static_cast<uint32_t>(count);
+    return;
+  }
+
+  float splitCost;
+  size_t mid = splitRange(begin, end, depth, box, centroidBox, nullptr,
+                          splitCost);
+  if (fitsLeaf && BVH_TRAVERSAL_COST + splitCost >= count) {
+    out[nodeIndex].offset = static_cast<uint32_t>(begin);
+    out[nodeIndex].count = static_cast<uint32_t>(count);
+    return;
+  }
+
+  // The left subtree directly follows this node. The right subtree starts
+  // once the left one has been emitted completely
+  buildBVH(begin, mid, depth + 1, out);
+  out[nodeIndex].offset = static_cast<uint32_t>(out.size());
+  buildBVH(mid, end, depth + 1, out);
+}
+
+void odin::BVH::buildLbvh(size_t count, Arena &arena) {
+  AABB box, centroidBox;
+  computeBounds(0, count, box, centroidBox, nullptr);
+
+  // Sort the triangles along the Z-order curve through their centroids
+  MortonPrimitive *sorted = arena.allocate<MortonPrimitive>(count);
+  MortonPrimitive *scratch = arena.allocate<MortonPrimitive>(count);
+  for (size_t i = 0; i < count; i++) {
+    const PrimitiveRef &ref = primitives.refs[i];
+    glm::vec3 centroid = 0.5f * (ref.boxMin + ref.boxMax);
+    sorted[i].code =
+        mortonCode(centroid, centroidBox, buildOptions.mortonBits / 3);
+    sorted[i].index = static_cast<uint32_t>(i);
+  }
+  radixSort(sorted, scratch, count, buildOptions.mortonBits);
+
+  // Gather the references in Morton order
+  PrimitiveRef *unsorted = primitives.refs;
+  primitives.refs = arena.allocate<PrimitiveRef>(count);
+  for (size_t i = 0; i < count; i++) {
+    primitives.refs[i] = unsorted[sorted[i].index];
+  }
+
+  // Split i lies between triangle i and i + 1. A range of triangles is split
+  // where the highest bit in which neighbouring codes differ is largest.
+  // Equal codes are split by their position instead, which halves them.
+  // These are the maxima of a Cartesian tree over the splits, so all of them
+  // are found with a single stack based pass
+  size_t numSplits = count - 1;
+  auto higherSplit = [sorted](size_t a, size_t b) {
+    uint64_t codeA = sorted[a].code ^ sorted[a + 1].code;
+    uint64_t codeB = sorted[b].code ^ sorted[b + 1].code;
+    if (codeA != codeB) {
+      return codeA > codeB;
+    }
+    return (a ^ (a + 1)) > (b ^ (b + 1));
+  };
+
+  // Triangle counts were checked to fit into 32 bits
+  uint32_t *leftSplits = arena.allocate<uint32_t>(numSplits);
+  uint32_t *rightSplits = arena.allocate<uint32_t>(numSplits);
+  uint32_t *stack = arena.allocate<uint32_t>(numSplits);
+  size_t stackSize = 0;
+  for (size_t i = 0; i < numSplits; i++) {
+    uint32_t last = NO_SPLIT;
+    while (stackSize > 0 && higherSplit(i, stack[stackSize - 1])) {
+      last = stack[--stackSize];
+    }
+    leftSplits[i] = last;
+    rightSplits[i] = NO_SPLIT;
+    if (stackSize > 0) {
+      rightSplits[stack[stackSize - 1]] = static_cast<uint32_t>(i);
+    }
+    stack[stackSize++] = static_cast<uint32_t>(i);
+  }
+
+  uint32_t root = stackSize > 0 ? stack[0] : NO_SPLIT;
+  emitLbvh(leftSplits, rightSplits, 0, count - 1, root, 0);
+}
+
+// Build the SBVH over the references in [begin, end). Spatial splits write
+// their duplicated references into the free space up to limit, which is the
+// part of the reference budget this subtree may use
+void odin::BVH::buildSbvh(size_t begin, size_t end, size_t limit, int depth,
+                          float rootArea) {
+  size_t nodeIndex = nodes.size();
+  nodes.push_back(BvhNode());
+
+  AABB box, centroidBox;
+  computeBounds(begin, end, box, centroidBox, nullptr);
+  setNodeBox(nodes[nodeIndex], box);
+
+  size_t count = end - begin;
+  if (count == 1) {
+    nodes[nodeIndex].offset = static_cast<uint32_t>(begin);
+    nodes[nodeIndex].count = 1;
+    return;
+  }
+
+  float splitCost;
+  size_t mid = splitRange(begin, end, depth, box, centroidBox, nullptr,
+                          splitCost);
+
+  // Spatial splits only pay off where the children of the object split
+  // overlap, and they need budget left for the duplicated references
+  SpatialSplit spatialSplit;
+  if (depth < MAX_SAH_DEPTH && limit > end) {
+    AABB leftBox, rightBox, unused;
+    computeBounds(begin, mid, leftBox, unused, nullptr);
+    computeBounds(mid, end, rightBox, unused, nullptr);
+    AABB overlap{glm::max(leftBox.min, rightBox.min),
+                 glm::min(leftBox.max, rightBox.max)};
+    if (!isEmpty(overlap) &&
+        overlap.surfaceArea() > SPATIAL_SPLIT_ALPHA * rootArea) {
+      spatialSplit = findSpatialSplit(begin, end, box);
+    }
+  }
+
+  bool fitsLeaf = count <= static_cast<size_t>(buildOptions.maxLeafSize);
+  float cost = std::min(splitCost, spatialSplit.cost);
+  if (fitsLeaf && BVH_TRAVERSAL_COST + cost >= count) {
+    nodes[nodeIndex].offset = static_cast<uint32_t>(begin);
+    nodes[nodeIndex].count = static_cast<uint32_t>(count);
+    return;
+  }
+
+  size_t leftEnd, rightBegin, rightEnd;
+  if (spatialSplit.cost >= splitCost ||
+      !partitionSpatial(begin, end, limit, spatialSplit, leftEnd, rightBegin,
+                        rightEnd)) {
+    // Move the right half of the object split behind the free space of the
+    // left half
+    size_t rightCount = end - mid;
+    leftEnd = mid;
+    rightBegin = rightChildBegin(begin, limit, mid - begin, rightCount);
+    rightEnd = rightBegin + rightCount;
+    std::copy_backward(primitives.refs + mid, primitives.refs + end,
+                       primitives.refs + rightEnd);
+  }
+
+  buildSbvh(begin, leftEnd, rightBegin, depth + 1, rootArea);
+  nodes[nodeIndex].offset = static_cast<uint32_t>(nodes.size());
+  buildSbvh(rightBegin, rightEnd, limit, depth + 1, rootArea);
+}
+
+void odin::BVH::buildSubtree(ThreadPool &pool, TaskGroup &group, size_t begin,
+                             size_t end, int depth, Subtree &subtree) {
+  if (end - begin < PARALLEL_SUBTREE_SIZE) {
+    buildBVH(begin, end, depth, subtree.nodes);
+    return;
+  }
+
+  // Nodes this large never fit into a leaf and are always split
+  AABB box, centroidBox;
+  computeBounds(begin, end, box, centroidBox, &pool);
+  float splitCost;
+  size_t mid =
+      splitRange(begin, end, depth, box, centroidBox, &pool, splitCost);
+
+  subtree.node = BvhNode();
+  setNodeBox(subtree.node, box);
+  subtree.left = std::make_unique<Subtree>();
+  subtree.right = std::make_unique<Subtree>();
+
+  Subtree *left = subtree.left.get();
+  Subtree *right = subtree.right.get();
+  group.run([this, &pool, &group, begin, mid, depth, left]() {
+    buildSubtree(pool, group, begin, mid, depth + 1, *left);
+  });
+  group.run([this, &pool, &group, mid, end, depth, right]() {
+    buildSubtree(pool, group, mid, end, depth + 1, *right);
+  });
+}
+
+void odin::BVH::computeBounds(size_t begin, size_t end, AABB &box,
+                              AABB &centroidBox, ThreadPool *pool) {
+  auto bounds = [this](size_t chunkBegin, size_t chunkEnd, AABB &chunkBox,
+                       AABB &chunkCentroidBox) {
+    chunkBox = AABB::emptyBox();
+    chunkCentroidBox = AABB::emptyBox();
+    for (size_t i = chunkBegin; i < chunkEnd; i++) {
+      const PrimitiveRef &ref = primitives.refs[i];
+      chunkBox.expand(ref.boxMin);
+      chunkBox.expand(ref.boxMax);
+      chunkCentroidBox.expand(0.5f * (ref.boxMin + ref.boxMax));
+    }
+  };
+
+  size_t chunks = numChunks(pool, begin, end);
+  if (chunks == 1) {
+    bounds(begin, end, box, centroidBox);
+    return;
+  }
+
+  std::vector<AABB> boxes(chunks);
+  std::vector<AABB> centroidBoxes(chunks);
+  forEachChunk(pool, begin, end,
+               [&](size_t chunk, size_t chunkBegin, size_t chunkEnd) {
+                 bounds(chunkBegin, chunkEnd, boxes[chunk],
+                        centroidBoxes[chunk]);
+               });
+
+  // Min and max are exact, so merging the chunks gives the same bounds as
+  // a single serial pass
+  box = AABB::emptyBox();
+  centroidBox = AABB::emptyBox();
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    box = AABB::surroundingBox(box, boxes[chunk]);
+    centroidBox = AABB::surroundingBox(centroidBox, centroidBoxes[chunk]);
+  }
+}
+
+odin::AABB odin::BVH::emitLbvh(const uint32_t *leftSplits,
+                               const uint32_t *rightSplits, size_t first,
+                               size_t last, uint32_t split, int depth) {
+  size_t count = last - first + 1;
+  if (count > static_cast<size_t>(buildOptions.maxLeafSize) &&
+      depth >= MAX_LBVH_DEPTH) {
+    size_t nodeIndex = nodes.size();
+    buildBVH(first, last + 1, depth, nodes);
+    return nodeBox(nodes[nodeIndex]);
+  }
+
+  size_t nodeIndex = nodes.size();
+  nodes.push_back(BvhNode());
+
+  if (count <= static_cast<size_t>(buildOptions.maxLeafSize)) {
+    AABB box = AABB::emptyBox();
+    for (size_t i = first; i <= last; i++) {
+      box.expand(primitives.refs[i].boxMin);
+      box.expand(primitives.refs[i].boxMax);
+    }
+    setNodeBox(nodes[nodeIndex], box);
+    nodes[nodeIndex].offset = static_cast<uint32_t>(first);
+    nodes[nodeIndex].count = static_cast<uint32_t>(count);
+    return box;
+  }
+
+  // Boxes are only known once both children have been emitted
+  AABB leftBox = emitLbvh(leftSplits, rightSplits, first, split,
+                          leftSplits[split], depth + 1);
+  nodes[nodeIndex].offset = static_cast<uint32_t>(nodes.size());
+  AABB rightBox = emitLbvh(leftSplits, rightSplits, split + 1, last,
+                           rightSplits[split], depth + 1);
+  AABB box = AABB::surroundingBox(leftBox, rightBox);
+  setNodeBox(nodes[nodeIndex], box);
+  return box;
+}
+
+// Bin the references along every axis of the node box. References are
+// clipped to every bin they overlap, so the bins bound the actual triangle
+// pieces instead of the whole triangles
+odin::BVH::SpatialSplit odin::BVH::findSpatialSplit(size_t begin, size_t end,
+                                                    const AABB &box) const {
+  const int numBins = buildOptions.numBins;
+  SpatialBin bins[3 * MAX_BINS];
+  glm::vec3 binSize = (box.max - box.min) / static_cast<float>(numBins);
+  for (size_t i = begin; i < end; i++) {
+    const PrimitiveRef &ref = primitives.refs[i];
+    for (int axis = 0; axis < 3; axis++) {
+      if (binSize[axis] <= 0.0f) {
+        continue;
+      }
+
+      SpatialBin *axisBins = &bins[axis * numBins];
+      auto binOf = [&](float position) {
+        int b = static_cast<int>((position - box.min[axis]) / binSize[axis]);
+        return std::min(numBins - 1, std::max(0, b));
+      };
+      int firstBin = binOf(ref.boxMin[axis]);
+      int lastBin = std::max(firstBin, binOf(ref.boxMax[axis]));
+      axisBins[firstBin].entries++;
+      axisBins[lastBin].exits++;
+
+      // Chop off the part of the reference inside of every bin
+      PrimitiveRef rest = ref;
+      for (int b = firstBin; b < lastBin; b++) {
+        float plane = box.min[axis] + binSize[axis] * (b + 1);
+        AABB leftBox, rightBox;
+        splitReference(rest, axis, plane, leftBox, rightBox);
+        if (!isEmpty(leftBox)) {
+          axisBins[b].box = AABB::surroundingBox(axisBins[b].box, leftBox);
+        }
+        rest.boxMin = rightBox.min;
+        rest.boxMax = rightBox.max;
+      }
+      AABB restBox{rest.boxMin, rest.boxMax};
+      if (!isEmpty(restBox)) {
+        axisBins[lastBin].box =
+            AABB::surroundingBox(axisBins[lastBin].box, restBox);
+      }
+    }
+  }
+
+  SpatialSplit best;
+  float rightAreas[MAX_BINS];
+  size_t rightCounts[MAX_BINS];
+  for (int axis = 0; axis < 3; axis++) {
+    if (binSize[axis] <= 0.0f) {
+      continue;
+    }
+    const SpatialBin *axisBins = &bins[axis * numBins];
+
+    // References are on the right of a plane until their exit bin is passed
+    AABB rightBox = AABB::emptyBox();
+    size_t rightCount = 0;
+    for (int b = numBins - 1; b > 0; b--) {
+      rightBox = AABB::surroundingBox(rightBox, axisBins[b].box);
+      rightCount += axisBins[b].exits;
+      rightAreas[b] = weightedArea(rightBox, rightCount);
+      rightCounts[b] = rightCount;
+    }
+
+    // and on the left once their entry bin is passed
+    AABB leftBox = AABB::emptyBox();
+    size_t leftCount = 0;
+    for (int b = 1; b < numBins; b++) {
+      leftBox = AABB::surroundingBox(leftBox, axisBins[b - 1].box);
+      leftCount += axisBins[b - 1].entries;
+      if (leftCount == 0 || rightCounts[b] == 0) {
+        continue;
+      }
+
+      float cost = weightedArea(leftBox, leftCount) + rightAreas[b];
+      if (cost < best.cost) {
+        best.axis = axis;
+        best.position = box.min[axis] + binSize[axis] * b;
+        best.cost = cost;
+      }
+    }
+  }
+
+  // Same units as the object split cost
+  float area = box.surfaceArea();
+  if (best.axis >= 0) {
+    best.cost = area > 0.0f ? best.cost / area
+                            : std::numeric_limits<float>::max();
+  }
+  return best;
+}
+
+size_t odin::BVH::partitionMedian(size_t begin, size_t end,
+                                  const AABB &centroidBox) {
+  int axis = longestAxis(centroidBox);
+  size_t mid = begin + (end - begin) / 2;
+  std::nth_element(primitives.refs + begin, primitives.refs + mid,
+                   primitives.refs + end,
+                   [axis](const PrimitiveRef &a, const PrimitiveRef &b) {
+                     return a.boxMin[axis] + a.boxMax[axis] <
+                            b.boxMin[axis] + b.boxMax[axis];
+                   });
+  return mid;
+}
+
+size_t odin::BVH::partitionSah(size_t begin, size_t end, const AABB &box,
+                               const AABB &centroidBox, ThreadPool *pool,
+                               float &splitCost) {
+  const int numBins = buildOptions.numBins;
+
+  // Axes along which all centroids lie on one plane cannot be split
+  glm::vec3 scale;
+  for (int axis = 0; axis < 3; axis++) {
+    float extent = centroidBox.max[axis] - centroidBox.min[axis];
+    scale[axis] = extent > 0.0f ? numBins / extent : 0.0f;
+  }
+
+  // Sort the triangle centroids into bins along all three axes at once
+  auto binPrimitives = [&](size_t chunkBegin, size_t chunkEnd, Bin *bins) {
+    for (size_t i = chunkBegin; i < chunkEnd; i++) {
+      const PrimitiveRef &ref = primitives.refs[i];
+      AABB refBox{ref.boxMin, ref.boxMax};
+      glm::vec3 centroid = 0.5f * (ref.boxMin + ref.boxMax);
+      for (int axis = 0; axis < 3; axis++) {
+        float offset = centroid[axis] - centroidBox.min[axis];
+        int b = std::min(numBins - 1,
+                         static_cast<int>(offset * scale[axis]));
+        Bin &bin = bins[axis * numBins + b];
+        bin.box = AABB::surroundingBox(bin.box, refBox);
+        bin.count++;
+      }
+    }
+  };
+
+  Bin bins[3 * MAX_BINS];
+  size_t chunks = numChunks(pool, begin, end);
+  if (chunks == 1) {
+    binPrimitives(begin, end, bins);
+  } else {
+    // Every chunk fills its own set of bins which are merged afterwards
+    std::vector<Bin> chunkBins(chunks * 3 * numBins);
+    forEachChunk(pool, begin, end,
+                 [&](size_t chunk, size_t chunkBegin, size_t chunkEnd) {
+                   binPrimitives(chunkBegin, chunkEnd,
+                                 &chunkBins[chunk * 3 * numBins]);
+                 });
+
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      for (int b = 0; b < 3 * numBins; b++) {
+        const Bin &bin = chunkBins[chunk * 3 * numBins + b];
+        bins[b].box = AABB::surroundingBox(bins[b].box, bin.box);
+        bins[b].count += bin.count;
+      }
+    }
+  }
+
+  float rightAreas[MAX_BINS];
+  size_t rightCounts[MAX_BINS];
+  float bestCost = std::numeric_limits<float>::max();
+  int bestAxis = -1;
+  int bestSplit = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (scale[axis] == 0.0f) {
+      continue;
+    }
+    const Bin *axisBins = &bins[axis * numBins];
+
+    // Sweep from the right to gather the cost of every right partition
+    AABB rightBox = AABB::emptyBox();
+    size_t rightCount = 0;
+    for (int b = numBins - 1; b > 0; b--) {
+      rightBox = AABB::surroundingBox(rightBox, axisBins[b].box);
+      rightCount += axisBins[b].count;
+      rightAreas[b] = rightBox.surfaceArea();
+      rightCounts[b] = rightCount;
+    }
+
+    // Sweep from the left and evaluate every plane between two bins
+    AABB leftBox = AABB::emptyBox();
+    size_t leftCount = 0;
+    for (int b = 1; b < numBins; b++) {
+      leftBox = AABB::surroundingBox(leftBox, axisBins[b - 1].box);
+      leftCount += axisBins[b - 1].count;
+      if (leftCount == 0 || rightCounts[b] == 0) {
+        continue;
+      }
+
+      float cost = leftBox.surfaceArea() * leftCount +
+                   rightAreas[b] * rightCounts[b];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = b;
+      }
+    }
+  }
+
+  if (bestAxis < 0) {
+    return begin;
+  }
+
+  // Expected cost of the split in units of triangle intersections
+  float area = box.surfaceArea();
+  splitCost = area > 0.0f ? bestCost / area : std::numeric_limits<float>::max();
+
+  // Move all triangles left of the best plane to the front of the range
+  float axisMin = centroidBox.min[bestAxis];
+  float axisScale = scale[bestAxis];
+  PrimitiveRef *middle = std::partition(
+      primitives.refs + begin, primitives.refs + end,
+      [&](const PrimitiveRef &ref) {
+        float centroid = 0.5f * (ref.boxMin[bestAxis] + ref.boxMax[bestAxis]);
+        float offset = centroid - axisMin;
+        int b = std::min(numBins - 1, static_cast<int>(offset * axisScale));
+        return b < bestSplit;
+      });
+
+  return static_cast<size_t>(middle - primitives.refs);
+}
+
+// Distribute the references to the two sides of a spatial split plane.
+// References straddling the plane are split in two unless keeping them on
+// one side is cheaper. Returns false if the duplicated references do not fit
+// into the budget of this range
+bool odin::BVH::partitionSpatial(size_t begin, size_t end, size_t limit,
+                                 const SpatialSplit &split, size_t &leftEnd,
+                                 size_t &rightBegin, size_t &rightEnd) {
+  // The left side grows from the front of the scratch space and the right
+  // side from its back. The references of the range stay untouched until
+  // the split is known to fit, since the object split falls back to them
+  int axis = split.axis;
+  PrimitiveRef *left = primitives.scratch;
+  PrimitiveRef *right = primitives.scratch + primitives.capacity;
+  // Every duplicate takes one more reference of the budget of the range, so
+  // the two sides never overlap in the scratch space either
+  size_t maxDuplicates = limit - end;
+  size_t numDuplicates = 0;
+  size_t numLeft = 0;
+  size_t numRight = 0;
+  AABB leftBox = AABB::emptyBox();
+  AABB rightBox = AABB::emptyBox();
+  for (size_t i = begin; i < end; i++) {
+    const PrimitiveRef &ref = primitives.refs[i];
+    AABB refBox{ref.boxMin, ref.boxMax};
+    if (ref.boxMax[axis] <= split.position) {
+      left[numLeft++] = ref;
+      leftBox = AABB::surroundingBox(leftBox, refBox);
+    } else if (ref.boxMin[axis] >= split.position) {
+      *(right - ++numRight) = ref;
+      rightBox = AABB::surroundingBox(rightBox, refBox);
+    }
+  }
+
+  // The straddling references are distributed in a second pass, once the
+  // sides of all others are known
+  for (size_t i = begin; i < end; i++) {
+    const PrimitiveRef &ref = primitives.refs[i];
+    if (ref.boxMax[axis] <= split.position ||
+        ref.boxMin[axis] >= split.position) {
+      continue;
+    }
+
+    AABB refBox{ref.boxMin, ref.boxMax};
+    AABB leftPart, rightPart;
+    splitReference(ref, axis, split.position, leftPart, rightPart);
+    if (isEmpty(leftPart) || isEmpty(rightPart)) {
+      // Rounding left nothing on one side of the plane
+      if (isEmpty(rightPart)) {
+        left[numLeft++] = ref;
+        leftBox = AABB::surroundingBox(leftBox, refBox);
+      } else {
+        *(right - ++numRight) = ref;
+        rightBox = AABB::surroundingBox(rightBox, refBox);
+      }
+      continue;
+    }
+
+    // Reference unsplitting from Stich et al.
+    AABB splitLeftBox = AABB::surroundingBox(leftBox, leftPart);
+    AABB splitRightBox = AABB::surroundingBox(rightBox, rightPart);
+    AABB wholeLeftBox = AABB::surroundingBox(leftBox, refBox);
+    AABB wholeRightBox = AABB::surroundingBox(rightBox, refBox);
+    float splitCost = weightedArea(splitLeftBox, numLeft + 1) +
+                      weightedArea(splitRightBox, numRight + 1);
+    float leftCost = weightedArea(wholeLeftBox, numLeft + 1) +
+                     weightedArea(rightBox, numRight);
+    float rightCost = weightedArea(leftBox, numLeft) +
+                      weightedArea(wholeRightBox, numRight + 1);
+    if (splitCost < leftCost && splitCost < rightCost) {
+      if (numDuplicates == maxDuplicates) {
+        return false;
+      }
+      numDuplicates++;
+      left[numLeft] = ref;
+      left[numLeft].boxMin = leftPart.min;
+      left[numLeft].boxMax = leftPart.max;
+      numLeft++;
+      numRight++;
+      *(right - numRight) = ref;
+      (right - numRight)->boxMin = rightPart.min;
+      (right - numRight)->boxMax = rightPart.max;
+      leftBox = splitLeftBox;
+      rightBox = splitRightBox;
+    } else if (leftCost <= rightCost) {
+      left[numLeft++] = ref;
+      leftBox = wholeLeftBox;
+    } else {
+      *(right - ++numRight) = ref;
+      rightBox = wholeRightBox;
+    }
+  }
+
+  if (numLeft == 0 || numRight == 0) {
+    return false;
+  }
+
+  leftEnd = begin + numLeft;
+  rightBegin = rightChildBegin(begin, limit, numLeft, numRight);
+  rightEnd = rightBegin + numRight;
+  std::copy(left, left + numLeft, primitives.refs + begin);
+  // The right side was written back to front
+  std::reverse_copy(right - numRight, right, primitives.refs + rightBegin);
+  return true;
+}
+
+size_t odin::BVH::splitRange(size_t begin, size_t end, int depth,
+                             const AABB &box, const AABB &centroidBox,
+                             ThreadPool *pool, float &splitCost) {
+  size_t mid = begin;
+  splitCost = std::numeric_limits<float>::max();
+  bool useSah = buildOptions.mode == BvhBuildMode::Sah ||
+                buildOptions.mode == BvhBuildMode::Sbvh;
+  if (useSah && depth < MAX_SAH_DEPTH) {
+    mid = partitionSah(begin, end, box, centroidBox, pool, splitCost);
+  }
+
+  // Fall back to the median if no useful split plane was found
+  if (mid == begin || mid == end) {
+    splitCost = std::numeric_limits<float>::max();
+    mid = partitionMedian(begin, end, centroidBox);
+  }
+  return mid;
+}
+
+// Split the triangle of a reference at a plane and return the bounds of the
+// two pieces, limited to the bounds of the reference
+void odin::BVH::splitReference(const PrimitiveRef &ref, int axis,
+                               float position, AABB &leftBox,
+                               AABB &rightBox) const {
+  const Triangle &triangle = primitives.triangles[ref.index];
+  const glm::vec3 vertices[3] = {triangle.v0, triangle.v1, triangle.v2};
+  leftBox = AABB::emptyBox();
+  rightBox = AABB::emptyBox();
+  for (int i = 0; i < 3; i++) {
+    const glm::vec3 &a = vertices[i];
+    const glm::vec3 &b = vertices[(i + 1) % 3];
+    if (a[axis] <= position) {
+      leftBox.expand(a);
+    }
+    if (a[axis] >= position) {
+      rightBox.expand(a);
+    }
+
+    // Edges crossing the plane add their intersection to both sides
+    if ((a[axis] < position && b[axis] > position) ||
+        (a[axis] > position && b[axis] < position)) {
+      float t = (position - a[axis]) / (b[axis] - a[axis]);
+      glm::vec3 intersection = a + (b - a) * std::min(1.0f, std::max(0.0f, t));
+      intersection[axis] = position;
+      leftBox.expand(intersection);
+      rightBox.expand(intersection);
+    }
+  }
+
+  leftBox.max[axis] = std::min(leftBox.max[axis], position);
+  rightBox.min[axis] = std::max(rightBox.min[axis], position);
+  leftBox = AABB{glm::max(leftBox.min, ref.boxMin),
+                 glm::min(leftBox.max, ref.boxMax)};
+  rightBox = AABB{glm::max(rightBox.min, ref.boxMin),
+                  glm::min(rightBox.max, ref.boxMax)};
+}
@@ -0,0 +1,186 @@
+#include "renderer/bvh_stats.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+float nodeArea(const odin::BvhNode &node) {
+  glm::vec3 extent = glm::max(node.max - node.min, glm::vec3(0.0f));
+  return 2.0f * (extent.x * extent.y + extent.y * extent.z +
+                 extent.z * extent.x);
+}
+
+float overlapArea(const odin::BvhNode &a, const odin::BvhNode &b) {
+  odin::BvhNode overlap;
+  overlap.min = glm::max(a.min, b.min);
+  overlap.max = glm::min(a.max, b.max);
+  return nodeArea(overlap);
+}
+
+void writeJsonString(std::ostream &out, const std::string &value) {
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+// JSON has no infinity or NaN, which degenerate scenes can produce
+void writeJsonNumber(std::ostream &out, float value) {
+  if (std::isfinite(value)) {
+    out << value;
+  } else {
+    out << "null";
+  }
+}
+} // namespace
+
+const char *odin::bvhBuildModeName(BvhBuildMode mode) {
+  switch (mode) {
+  case BvhBuildMode::Median:
+    return "median";
+  case BvhBuildMode::Sah:
+    return "sah";
+  case BvhBuildMode::Lbvh:
+    return "lbvh";
+  case BvhBuildMode::Sbvh:
+    return "sbvh";
+  }
+  return "unknown";
+}
+
+void odin::BvhStats::compute(const BVH &bvh, const BvhBuildOptions &options,
+                             size_t numTriangles, float buildTime) {
+  *this = BvhStats();
+  this->options = options;
+  this->buildTime = buildTime;
+  this->numTriangles = numTriangles;
+  numReferences = bvh.triangles.size();
+  numNodes = bvh.nodes.size();
+  nodeBytes = numNodes * sizeof(BvhNode);
+  triangleBytes = numReferences * sizeof(BvhTriangle);
+  if (numNodes == 0) {
+    return;
+  }
+
+  // Children always come after their parent in the depth-first layout, so
+  // the depth of every node is known before it is visited
+  std::vector<int> depths(numNodes, 0);
+  float rootArea = nodeArea(bvh.nodes[0]);
+  double cost = 0.0;
+  double overlapSum = 0.0;
+  size_t leafDepthSum = 0;
+  for (size_t i = 0; i < numNodes; i++) {
+    const BvhNode &node = bvh.nodes[i];
+    int depth = depths[i] + 1;
+    maxDepth = std::max(maxDepth, depth);
+    float area = nodeArea(node);
+
+    if (node.count > 0) {
+      numLeaves++;
+      leafDepthSum += depth;
+      size_t bucket = std::min<size_t>(node.count, leafSizes.size()) - 1;
+      leafSizes[bucket]++;
+      cost += area * node.count;
+      continue;
+    }
+
+    const BvhNode &left = bvh.nodes[i + 1];
+    const BvhNode &right = bvh.nodes[node.offset];
+    depths[i + 1] = depth;
+    depths[node.offset] = depth;
+    cost += area * BVH_TRAVERSAL_COST;
+    if (area > 0.0f) {
+      overlapSum += overlapArea(left, right) / area;
+    }
+  }
+
+  size_t numInterior = numNodes - numLeaves;
+  sahCost = rootArea > 0.0f ? static_cast<float>(cost / rootArea)
+                            : static_cast<float>(numReferences);
+  overlapRatio =
+      numInterior > 0 ? static_cast<float>(overlapSum / numInterior) : 0.0f;
+  if (numLeaves > 0) {
+    averageLeafDepth = static_cast<float>(leafDepthSum) / numLeaves;
+    averageLeafSize = static_cast<float>(numReferences) / numLeaves;
+  }
+}
+
+void odin::BvhStats::print(std::ostream &out) const {
+  out << "BVH stats (" << bvhBuildModeName(options.mode) << ")" << std::endl
+      << "  Build time: " << buildTime << " ms" << std::endl
+      << "  Triangles: " << numTriangles << " References: " << numReferences
+      << std::endl
+      << "  Nodes: " << numNodes << " Leaves: " << numLeaves << std::endl
+      << "  Depth: max " << maxDepth << " average leaf " << averageLeafDepth
+      << std::endl
+      << "  SAH cost: " << sahCost << std::endl
+      << "  Child overlap: " << overlapRatio * 100.0f << " %" << std::endl
+      << "  Memory: " << nodeBytes / 1024 << " KiB nodes, "
+      << triangleBytes / 1024 << " KiB triangles" << std::endl
+      << "  Leaf sizes (average " << averageLeafSize << "):" << std::endl;
+  for (size_t i = 0; i < leafSizes.size(); i++) {
+    if (leafSizes[i] > 0) {
+      out << "    " << std::setw(2) << i + 1 << ": " << leafSizes[i]
+          << std::endl;
+    }
+  }
+}
+
+void odin::BvhStats::writeJson(std::ostream &out) const {
+  out << "{\"builder\": \"" << bvhBuildModeName(options.mode) << "\", "
+      << "\"bins\": " << options.numBins << ", "
+      << "\"maxLeafSize\": " << options.maxLeafSize << ", "
+      << "\"threads\": " << options.numThreads << ", "
+      << "\"buildTimeMs\": ";
+  writeJsonNumber(out, buildTime);
+  out << ", "
+      << "\"triangles\": " << numTriangles << ", "
+      << "\"references\": " << numReferences << ", "
+      << "\"nodes\": " << numNodes << ", "
+      << "\"leaves\": " << numLeaves << ", "
+      << "\"maxDepth\": " << maxDepth << ", "
+      << "\"averageLeafDepth\": ";
+  writeJsonNumber(out, averageLeafDepth);
+  out << ", \"averageLeafSize\": ";
+  writeJsonNumber(out, averageLeafSize);
+  out << ", \"sahCost\": ";
+  writeJsonNumber(out, sahCost);
+  out << ", \"overlapRatio\": ";
+  writeJsonNumber(out, overlapRatio);
+  out << ", "
+      << "\"nodeBytes\": " << nodeBytes << ", "
+      << "\"triangleBytes\": " << triangleBytes << ", "
+      << "\"leafSizes\": [";
+  for (size_t i = 0; i < leafSizes.size(); i++) {
+    out << (i > 0 ? ", " : "") << leafSizes[i];
+  }
+  out << "]}";
+}
+
+void odin::BvhStats::writeJsonFile(const std::string &path,
+                                   const std::string &scene,
+                                   const std::vector<BvhStats> &builds) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open BVH stats file!");
+  }
+
+  file << "{\"scene\": ";
+  writeJsonString(file, scene);
+  file << ", \"builds\": [";
+  for (size_t i = 0; i < builds.size(); i++) {
+    file << (i > 0 ? ",\n  " : "\n  ");
+    builds[i].writeJson(file);
+  }
+  file << "\n]}" << std::endl;
+
+  if (!file) {
+    throw std::runtime_error("Failed to write BVH stats file!");
+  }
+}
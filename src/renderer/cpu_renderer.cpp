@@ -0,0 +1,377 @@
+#include "renderer/cpu_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "utils/thread_pool.hpp"
+
+namespace {
+// Same constants as shaders/include/common.glsl and traversal.glsl
+const float EPSILON = 0.000000001f;
+const float INFINITY_DISTANCE = std::numeric_limits<float>::infinity();
+const int BVH_STACK_SIZE = 64;
+
+const int LAMBERTIAN = 1;
+const int METAL = 2;
+
+float fract(float x) { return x - std::floor(x); }
+
+// Pseudo-random numbers in [-1, 1) computed from a 2D seed like rand in
+// the shader
+float rand(const glm::vec2 &co) {
+  return 2.0f *
+             fract(std::sin(glm::dot(co, glm::vec2(12.9898f, 78.233f))) *
+                   43758.5453f) -
+         1.0f;
+}
+
+glm::vec3 randomInUnitDisk(const glm::vec2 &co) {
+  glm::vec3 p;
+  int n = 0;
+  do {
+    p = glm::vec3(rand(co), rand(glm::vec2(co.y, co.x)), 0.0f) -
+        glm::vec3(1.0f, 1.0f, 0.0f);
+  } while (glm::dot(p, p) >= 1.0f && ++n < 3);
+  return p;
+}
+
+glm::vec3 randomInUnitSphere(glm::vec3 p) {
+  int n = 0;
+  do {
+    p = glm::vec3(rand(glm::vec2(p.x, p.y)), rand(glm::vec2(p.z, p.y)),
+                  rand(glm::vec2(p.x, p.z)));
+  } while (glm::length(p) * glm::length(p) >= 1.0f && ++n < 3);
+  return p;
+}
+
+bool aabbHit(const glm::vec3 &origin, const glm::vec3 &invDir,
+             const glm::vec3 &boxMin, const glm::vec3 &boxMax, float tMin,
+             float tMax, float &tEnter) {
+  glm::vec3 t0s = (boxMin - origin) * invDir;
+  glm::vec3 t1s = (boxMax - origin) * invDir;
+  glm::vec3 tSmaller = glm::min(t1s, t0s);
+  glm::vec3 tBigger = glm::max(t0s, t1s);
+  tMin = std::max(tMin, std::max(tSmaller.x, std::max(tSmaller.y, tSmaller.z)));
+  tMax = std::min(tMax, std::min(tBigger.x, std::min(tBigger.y, tBigger.z)));
+  tEnter = tMin;
+  return tMin <= tMax;
+}
+
+bool refract(const glm::vec3 &v, const glm::vec3 &n, float niOverNt,
+             glm::vec3 &refracted) {
+  glm::vec3 uv = glm::normalize(v);
+  float dt = glm::dot(uv, n);
+  float discriminant = 1.0f - niOverNt * niOverNt * (1.0f - dt * dt);
+  if (discriminant > 0.0f) {
+    refracted = niOverNt * (uv - n * dt) - n * std::sqrt(discriminant);
+    return true;
+  }
+  return false;
+}
+
+// Schlick approximation function
+float schlick(float cosine, float refIdx) {
+  float r0 = (1.0f - refIdx) / (1.0f + refIdx);
+  r0 = r0 * r0;
+  return r0 + (1.0f - r0) * std::pow(1.0f - cosine, 5.0f);
+}
+
+uint8_t toUnorm(float value) {
+  return static_cast<uint8_t>(
+      std::lround(std::min(1.0f, std::max(0.0f, value)) * 255.0f));
+}
+}  // namespace
+
+odin::CpuRenderer::CpuRenderer(const BVH &bvh, ThreadPool &pool,
+                               PacketIsa packetIsa, uint32_t numSamples,
+                               uint32_t numBounces)
+    : bvh(bvh),
+      pool(pool),
+      packetTracer(bvh, packetIsa),
+      numSamples(numSamples),
+      numBounces(numBounces) {}
+
+const char *odin::CpuRenderer::getPacketIsaName() const {
+  return packetTracer.getIsaName();
+}
+
+void odin::CpuRenderer::render(const Camera &camera, uint32_t width,
+                               uint32_t height,
+                               std::vector<uint8_t> &pixels) const {
+  if (bvh.nodes.empty()) {
+    throw std::runtime_error("Cannot render without a BVH!");
+  }
+
+  pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+  TaskGroup group(pool);
+  for (uint32_t tileY = 0; tileY < height; tileY += TILE_SIZE) {
+    for (uint32_t tileX = 0; tileX < width; tileX += TILE_SIZE) {
+      group.run([&, tileX, tileY] {
+        renderTile(camera, width, height, tileX, tileY, pixels.data());
+      });
+    }
+  }
+  group.wait();
+}
+
+// Does the work of one invocation of main in the shader for every pixel of
+// the tile. The camera rays of one sample of a row of pixels form a packet
+void odin::CpuRenderer::renderTile(const Camera &camera, uint32_t width,
+                                   uint32_t height, uint32_t tileX,
+                                   uint32_t tileY, uint8_t *pixels) const {
+  uint32_t endX = std::min(width, tileX + TILE_SIZE);
+  uint32_t endY = std::min(height, tileY + TILE_SIZE);
+  for (uint32_t y = tileY; y < endY; y++) {
+    for (uint32_t startX = tileX; startX < endX; startX += RayPacket::SIZE) {
+      uint32_t numRays = std::min<uint32_t>(RayPacket::SIZE, endX - startX);
+      glm::vec3 finalColors[RayPacket::SIZE] = {};
+      Ray rays[RayPacket::SIZE];
+      RayPacket packet;
+      packet.tMin = EPSILON;
+      for (uint32_t s = 0; s < numSamples; s++) {
+        for (uint32_t i = 0; i < RayPacket::SIZE; i++) {
+          uint32_t x = startX + std::min(i, numRays - 1);
+          glm::vec2 seed(static_cast<float>(x + s), static_cast<float>(y + s));
+          float u = (x + rand(seed)) / width;
+          float v = (y + rand(seed)) / height;
+          rays[i] = getRay(camera, u, v);
+          packet.originX[i] = rays[i].origin.x;
+          packet.originY[i] = rays[i].origin.y;
+          packet.originZ[i] = rays[i].origin.z;
+          packet.directionX[i] = rays[i].direction.x;
+          packet.directionY[i] = rays[i].direction.y;
+          packet.directionZ[i] = rays[i].direction.z;
+          // Lanes past the end of the tile are not traced
+          packet.tMax[i] = i < numRays ? INFINITY_DISTANCE : -1.0f;
+        }
+        packetTracer.intersect(packet);
+
+        for (uint32_t i = 0; i < numRays; i++) {
+          HitRecord rec = {};
+          bool hit = packet.triangle[i] != RayPacket::INVALID_TRIANGLE;
+          if (hit) {
+            recordHit(rays[i], packet.triangle[i], packet.tMax[i], rec);
+          }
+          finalColors[i] += trace(rays[i], hit, rec);
+        }
+      }
+
+      for (uint32_t i = 0; i < numRays; i++) {
+        // Normalize the color with the number of samples
+        glm::vec3 finalColor =
+            finalColors[i] / static_cast<float>(numSamples);
+        // Simple gamma-correction at 1/2
+        finalColor = glm::sqrt(finalColor);
+
+        uint8_t *pixel =
+            pixels + (static_cast<size_t>(y) * width + startX + i) * 4;
+        pixel[0] = toUnorm(finalColor.x);
+        pixel[1] = toUnorm(finalColor.y);
+        pixel[2] = toUnorm(finalColor.z);
+        pixel[3] = 255;
+      }
+    }
+  }
+}
+
+glm::vec3 odin::CpuRenderer::trace(Ray ray, bool hit, HitRecord rec) const {
+  glm::vec3 totalAttenuation(1.0f);
+  // Iterate for a max number of bounces
+  for (uint32_t i = 0; i < numBounces; i++) {
+    if (i > 0) {
+      hit = intersect(ray, EPSILON, INFINITY_DISTANCE, rec);
+    }
+
+    if (hit) {
+      // Intersected an object and need to bounce the ray
+      Ray scattered;
+      glm::vec3 attenuation;
+      if (scatter(ray, rec, attenuation, scattered)) {
+        totalAttenuation *= attenuation;
+        ray = scattered;
+      } else {
+        totalAttenuation *= glm::vec3(0.0f);
+      }
+    } else {
+      // No objects intersected. Return background color
+      glm::vec3 unitDirection = glm::normalize(ray.direction);
+      float t = 0.5f * (unitDirection.y + 1.0f);
+      return totalAttenuation * ((1.0f - t) * glm::vec3(1.0f) +
+                                 t * glm::vec3(0.5f, 0.7f, 1.0f));
+    }
+  }
+
+  // Paths that are still bouncing after the last bounce carry no light
+  return glm::vec3(0.0f);
+}
+
+// Same front to back walk as intersect_binary in
+// shaders/include/traversal.glsl
+bool odin::CpuRenderer::intersect(const Ray &ray, float tMin, float tMax,
+                                  HitRecord &rec) const {
+  glm::vec3 invDir = glm::vec3(1.0f) / ray.direction;
+  bool hitAnything = false;
+  float closestSoFar = tMax;
+
+  float tEnter;
+  if (!aabbHit(ray.origin, invDir, bvh.nodes[0].min, bvh.nodes[0].max, tMin,
+               closestSoFar, tEnter)) {
+    return false;
+  }
+
+  uint32_t stack[BVH_STACK_SIZE];
+  int stackSize = 0;
+  uint32_t nodeIndex = 0;
+  while (true) {
+    const BvhNode &node = bvh.nodes[nodeIndex];
+    if (node.count > 0) {
+      for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+        if (triangleHit(ray, i, tMin, closestSoFar, rec)) {
+          hitAnything = true;
+          closestSoFar = rec.t;
+        }
+      }
+    } else {
+      uint32_t nearChild = nodeIndex + 1;
+      uint32_t farChild = node.offset;
+      float tNear, tFar;
+      bool hitNear =
+          aabbHit(ray.origin, invDir, bvh.nodes[nearChild].min,
+                  bvh.nodes[nearChild].max, tMin, closestSoFar, tNear);
+      bool hitFar =
+          aabbHit(ray.origin, invDir, bvh.nodes[farChild].min,
+                  bvh.nodes[farChild].max, tMin, closestSoFar, tFar);
+      if (hitNear && hitFar) {
+        // Visit the child that the ray enters first
+        if (tFar < tNear) {
+          std::swap(nearChild, farChild);
+        }
+        stack[stackSize++] = farChild;
+        nodeIndex = nearChild;
+        continue;
+      } else if (hitNear) {
+        nodeIndex = nearChild;
+        continue;
+      } else if (hitFar) {
+        nodeIndex = farChild;
+        continue;
+      }
+    }
+
+    if (stackSize == 0) {
+      break;
+    }
+    nodeIndex = stack[--stackSize];
+  }
+  return hitAnything;
+}
+
+bool odin::CpuRenderer::triangleHit(const Ray &ray, uint32_t triangleIndex,
+                                    float tMin, float tMax,
+                                    HitRecord &rec) const {
+  const BvhTriangle &tri = bvh.triangles[triangleIndex];
+  glm::vec3 v0(tri.v0.x, tri.v0.y, tri.v0.z);
+  glm::vec3 v0v1 = glm::vec3(tri.v1.x, tri.v1.y, tri.v1.z) - v0;
+  glm::vec3 v0v2 = glm::vec3(tri.v2.x, tri.v2.y, tri.v2.z) - v0;
+  glm::vec3 pvec = glm::cross(ray.direction, v0v2);
+  float d = glm::dot(v0v1, pvec);
+  if (std::abs(d) < EPSILON) {
+    // Plane is parallel to ray. No intersection
+    return false;
+  }
+
+  float invD = 1.0f / d;
+  glm::vec3 tvec = ray.origin - v0;
+  float u = glm::dot(tvec, pvec) * invD;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+
+  glm::vec3 qvec = glm::cross(tvec, v0v1);
+  float v = glm::dot(ray.direction, qvec) * invD;
+  if (v < 0.0f || u + v > 1.0f) {
+    return false;
+  }
+
+  // Only accept hits inside of the search interval
+  float t = glm::dot(v0v2, qvec) * invD;
+  if (t < tMin || t > tMax) {
+    return false;
+  }
+
+  recordHit(ray, triangleIndex, t, rec);
+  return true;
+}
+
+void odin::CpuRenderer::recordHit(const Ray &ray, uint32_t triangleIndex,
+                                  float t, HitRecord &rec) const {
+  const BvhTriangle &tri = bvh.triangles[triangleIndex];
+  rec.t = t;
+  rec.p = ray.origin + t * ray.direction;
+  rec.normal = glm::vec3(tri.v0.w, tri.v1.w, tri.v2.w);
+  // Diffuse material for testing, as in the shader
+  rec.mat.albedo = glm::vec3(0.8f, 0.0f, 0.0f);
+  rec.mat.fuzz = 0.0f;
+  rec.mat.ref_idx = 0.0f;
+  rec.mat.scatter_function = LAMBERTIAN;
+}
+
+odin::CpuRenderer::Ray odin::CpuRenderer::getRay(const Camera &camera,
+                                                 float s, float t) {
+  glm::vec3 rd = camera.lens_radius * randomInUnitDisk(glm::vec2(s, t));
+  glm::vec3 offset = camera.u * rd.x + camera.v * rd.y;
+  return Ray{camera.origin + offset, camera.lower_left_corner +
+                                         s * camera.horizontal +
+                                         t * camera.vertical - camera.origin -
+                                         offset};
+}
+
+bool odin::CpuRenderer::scatter(const Ray &ray, const HitRecord &rec,
+                                glm::vec3 &attenuation, Ray &scattered) {
+  if (rec.mat.scatter_function == LAMBERTIAN) {
+    glm::vec3 target = rec.p + rec.normal + randomInUnitSphere(rec.p);
+    scattered = Ray{rec.p, target - rec.p};
+    attenuation = rec.mat.albedo;
+    return true;
+  } else if (rec.mat.scatter_function == METAL) {
+    glm::vec3 reflected =
+        glm::reflect(glm::normalize(ray.direction), rec.normal);
+    scattered =
+        Ray{rec.p, reflected + rec.mat.fuzz * randomInUnitSphere(rec.p)};
+    attenuation = rec.mat.albedo;
+    return glm::dot(scattered.direction, rec.normal) > 0.0f;
+  }
+
+  // Dielectric
+  glm::vec3 outwardNormal;
+  glm::vec3 reflected = glm::reflect(ray.direction, rec.normal);
+  float niOverNt;
+  float cosine;
+  float reflectProb;
+  glm::vec3 refracted;
+  attenuation = glm::vec3(1.0f);
+  if (glm::dot(ray.direction, rec.normal) > 0.0f) {
+    outwardNormal = -rec.normal;
+    niOverNt = rec.mat.ref_idx;
+    cosine = rec.mat.ref_idx * glm::dot(ray.direction, rec.normal) /
+             glm::length(ray.direction);
+  } else {
+    outwardNormal = rec.normal;
+    niOverNt = 1.0f / rec.mat.ref_idx;
+    cosine = -glm::dot(ray.direction, rec.normal) / glm::length(ray.direction);
+  }
+
+  if (refract(ray.direction, outwardNormal, niOverNt, refracted)) {
+    reflectProb = schlick(cosine, rec.mat.ref_idx);
+  } else {
+    reflectProb = 1.0f;
+  }
+
+  if (rand(glm::vec2(ray.direction.x, ray.direction.y)) < reflectProb) {
+    scattered = Ray{rec.p, reflected};
+  } else {
+    scattered = Ray{rec.p, refracted};
+  }
+  return true;
+}
@@ -0,0 +1,351 @@
+#include "renderer/kd_tree.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Costs of traversing a node and intersecting a triangle used by the SAH.
+// These are the values suggested by Wald and Havran
+const float TRAVERSAL_COST = 15.0f;
+const float INTERSECTION_COST = 20.0f;
+
+// Splits that cut off empty space get their cost reduced by this fraction
+const float EMPTY_BONUS = 0.2f;
+
+// Child indices and triangle counts share a 32 bit word with the axis
+const uint32_t MAX_KD_INDEX = (1u << 30) - 1;
+
+// Clipping a triangle against the six planes of a box adds at most one
+// vertex per plane
+const int MAX_CLIP_VERTICES = 9;
+
+odin::AABB triangleBox(const odin::Triangle &triangle) {
+  odin::AABB box = odin::AABB::emptyBox();
+  box.expand(triangle.v0);
+  box.expand(triangle.v1);
+  box.expand(triangle.v2);
+  return box;
+}
+
+// Clip a triangle against a box and return the bounds of what is left. This
+// is what makes the splits "perfect": a triangle that straddles a split plane
+// only gets the part of its bounds that lies inside of each child
+bool clippedBox(const odin::Triangle &triangle, const odin::AABB &voxel,
+                odin::AABB &box) {
+  glm::vec3 polygon[MAX_CLIP_VERTICES];
+  glm::vec3 clipped[MAX_CLIP_VERTICES];
+  polygon[0] = triangle.v0;
+  polygon[1] = triangle.v1;
+  polygon[2] = triangle.v2;
+  int numVertices = 3;
+  for (int axis = 0; axis < 3; axis++) {
+    for (int side = 0; side < 2; side++) {
+      // Keep the part of the polygon with a non-negative distance
+      float plane = side == 0 ? voxel.min[axis] : voxel.max[axis];
+      float sign = side == 0 ? 1.0f : -1.0f;
+      int numClipped = 0;
+      for (int i = 0; i < numVertices; i++) {
+        const glm::vec3 &a = polygon[i];
+        const glm::vec3 &b = polygon[(i + 1) % numVertices];
+        float distanceA = sign * (a[axis] - plane);
+        float distanceB = sign * (b[axis] - plane);
+        if (distanceA >= 0.0f) {
+          clipped[numClipped++] = a;
+        }
+        if ((distanceA < 0.0f) != (distanceB < 0.0f)) {
+          glm::vec3 intersection =
+              a + (b - a) * (distanceA / (distanceA - distanceB));
+          intersection[axis] = plane;
+          clipped[numClipped++] = intersection;
+        }
+      }
+
+      numVertices = numClipped;
+      if (numVertices == 0) {
+        return false;
+      }
+      std::copy(clipped, clipped + numVertices, polygon);
+    }
+  }
+
+  box = odin::AABB::emptyBox();
+  for (int i = 0; i < numVertices; i++) {
+    box.expand(polygon[i]);
+  }
+
+  // Guard against rounding pushing the bounds out of the voxel
+  for (int axis = 0; axis < 3; axis++) {
+    box.min[axis] = std::max(box.min[axis], voxel.min[axis]);
+    box.max[axis] = std::min(box.max[axis], voxel.max[axis]);
+  }
+  return true;
+}
+
+// SAH cost of splitting a voxel with the given extent at leftLength along
+// an axis. The areas of the children follow from the extent directly
+float sahCost(const glm::vec3 &extent, float invArea, int axis,
+              float leftLength, size_t numLeft, size_t numRight) {
+  float u = extent[(axis + 1) % 3];
+  float v = extent[(axis + 2) % 3];
+  float leftArea = 2.0f * (u * v + leftLength * (u + v));
+  float rightArea = 2.0f * (u * v + (extent[axis] - leftLength) * (u + v));
+  float cost = TRAVERSAL_COST + INTERSECTION_COST * invArea *
+                                    (leftArea * numLeft + rightArea * numRight);
+  if (numLeft == 0 || numRight == 0) {
+    cost *= 1.0f - EMPTY_BONUS;
+  }
+  return cost;
+}
+} // namespace
+
+void odin::KdTree::init(const std::vector<Triangle> &triangles) {
+  if (triangles.size() == 0) {
+    throw std::runtime_error("No triangles available to build k-d tree!");
+  }
+
+  if (triangles.size() > MAX_KD_INDEX) {
+    throw std::runtime_error("Too many triangles to build k-d tree!");
+  }
+
+  size_t count = triangles.size();
+  bounds = AABB::emptyBox();
+  for (const Triangle &triangle : triangles) {
+    bounds = AABB::surroundingBox(bounds, triangleBox(triangle));
+  }
+
+  // Sorting the events once up front is the only sort over all triangles.
+  // Every node keeps the order of its events when they are split
+  std::vector<Event> events;
+  events.reserve(6 * count);
+  for (size_t i = 0; i < count; i++) {
+    addEvents(events, static_cast<uint32_t>(i), triangleBox(triangles[i]));
+  }
+  std::sort(events.begin(), events.end(), EventOrder());
+
+  // Depth limit suggested by pbrt
+  float depth = 8.0f + 1.3f * std::log2(static_cast<float>(count));
+  maxDepth = std::min(MAX_DEPTH, static_cast<int>(depth));
+  sides.assign(count, BOTH);
+  nodes.clear();
+  this->triangles.clear();
+  buildNode(triangles, events, count, bounds, 0);
+
+  sides.clear();
+  sides.shrink_to_fit();
+}
+
+void odin::KdTree::buildNode(const std::vector<Triangle> &source,
+                             std::vector<Event> &events, size_t count,
+                             const AABB &voxel, int depth) {
+  if (nodes.size() > MAX_KD_INDEX) {
+    throw std::runtime_error("Too many nodes in k-d tree!");
+  }
+
+  size_t nodeIndex = nodes.size();
+  nodes.emplace_back();
+
+  Split split = findSplit(events, count, voxel);
+  if (depth >= maxDepth || split.axis < 0 ||
+      split.cost > INTERSECTION_COST * count) {
+    addLeaf(source, events, count, nodeIndex);
+    return;
+  }
+
+  AABB leftVoxel = voxel;
+  AABB rightVoxel = voxel;
+  leftVoxel.max[split.axis] = split.position;
+  rightVoxel.min[split.axis] = split.position;
+
+  std::vector<Event> leftEvents;
+  std::vector<Event> rightEvents;
+  size_t leftCount;
+  size_t rightCount;
+  splitEvents(source, events, split, leftVoxel, rightVoxel, leftEvents,
+              rightEvents, leftCount, rightCount);
+
+  // The events of this node are not needed anymore
+  std::vector<Event>().swap(events);
+
+  buildNode(source, leftEvents, leftCount, leftVoxel, depth + 1);
+  nodes[nodeIndex].split = split.position;
+  uint32_t aboveChild = static_cast<uint32_t>(nodes.size());
+  nodes[nodeIndex].data = aboveChild << 2 | static_cast<uint32_t>(split.axis);
+  buildNode(source, rightEvents, rightCount, rightVoxel, depth + 1);
+}
+
+// Sweep over the sorted events of every axis and evaluate the SAH at every
+// candidate plane. Triangles lying in the plane are tried on both sides
+odin::KdTree::Split odin::KdTree::findSplit(const std::vector<Event> &events,
+                                            size_t count,
+                                            const AABB &voxel) const {
+  Split best;
+  float area = voxel.surfaceArea();
+  if (area <= 0.0f) {
+    return best;
+  }
+  float invArea = 1.0f / area;
+  glm::vec3 extent = voxel.max - voxel.min;
+
+  size_t numLeft[3] = {0, 0, 0};
+  size_t numRight[3] = {count, count, count};
+  size_t i = 0;
+  while (i < events.size()) {
+    int axis = events[i].axis;
+    float position = events[i].position;
+    size_t numEnding = 0;
+    size_t numPlanar = 0;
+    size_t numStarting = 0;
+    while (i < events.size() && events[i].axis == axis &&
+           events[i].position == position) {
+      if (events[i].type == END) {
+        numEnding++;
+      } else if (events[i].type == PLANAR) {
+        numPlanar++;
+      } else {
+        numStarting++;
+      }
+      i++;
+    }
+
+    numRight[axis] -= numPlanar + numEnding;
+    // Planes on the boundary of the voxel would produce a child that is
+    // identical to this node
+    if (position > voxel.min[axis] && position < voxel.max[axis]) {
+      float leftLength = position - voxel.min[axis];
+      float leftCost = sahCost(extent, invArea, axis, leftLength,
+                               numLeft[axis] + numPlanar, numRight[axis]);
+      float rightCost = sahCost(extent, invArea, axis, leftLength,
+                                numLeft[axis], numRight[axis] + numPlanar);
+      float cost = std::min(leftCost, rightCost);
+      if (best.axis < 0 || cost < best.cost) {
+        best.axis = axis;
+        best.position = position;
+        best.cost = cost;
+        best.planarLeft = leftCost < rightCost;
+      }
+    }
+    numLeft[axis] += numStarting + numPlanar;
+  }
+  return best;
+}
+
+// Distribute the events of a node to its children. Events of triangles that
+// lie entirely on one side keep their order. Triangles straddling the plane
+// are clipped to both children and their new events are merged in
+void odin::KdTree::splitEvents(const std::vector<Triangle> &source,
+                               const std::vector<Event> &events,
+                               const Split &split, const AABB &leftVoxel,
+                               const AABB &rightVoxel,
+                               std::vector<Event> &leftEvents,
+                               std::vector<Event> &rightEvents,
+                               size_t &leftCount, size_t &rightCount) {
+  for (const Event &event : events) {
+    if (event.axis != split.axis) {
+      continue;
+    }
+
+    if (event.type == END && event.position <= split.position) {
+      sides[event.triangle] = LEFT;
+    } else if (event.type == START && event.position >= split.position) {
+      sides[event.triangle] = RIGHT;
+    } else if (event.type == PLANAR) {
+      bool left = event.position < split.position ||
+                  (event.position == split.position && split.planarLeft);
+      sides[event.triangle] = left ? LEFT : RIGHT;
+    }
+  }
+
+  leftEvents.reserve(events.size());
+  rightEvents.reserve(events.size());
+  for (const Event &event : events) {
+    if (sides[event.triangle] == LEFT) {
+      leftEvents.push_back(event);
+    } else if (sides[event.triangle] == RIGHT) {
+      rightEvents.push_back(event);
+    }
+  }
+
+  // Every triangle has exactly one start or planar event on each axis
+  leftCount = 0;
+  rightCount = 0;
+  std::vector<Event> straddlingLeft;
+  std::vector<Event> straddlingRight;
+  for (const Event &event : events) {
+    if (event.axis != 0 || event.type == END) {
+      continue;
+    }
+
+    uint32_t triangle = event.triangle;
+    Side side = sides[triangle];
+    sides[triangle] = BOTH;
+    if (side == LEFT) {
+      leftCount++;
+      continue;
+    } else if (side == RIGHT) {
+      rightCount++;
+      continue;
+    }
+
+    AABB box;
+    if (clippedBox(source[triangle], leftVoxel, box)) {
+      addEvents(straddlingLeft, triangle, box);
+      leftCount++;
+    }
+    if (clippedBox(source[triangle], rightVoxel, box)) {
+      addEvents(straddlingRight, triangle, box);
+      rightCount++;
+    }
+  }
+
+  // Only the few clipped events have to be sorted. Merging them keeps the
+  // events of the children sorted
+  auto merge = [](std::vector<Event> &sorted, std::vector<Event> &added) {
+    std::sort(added.begin(), added.end(), EventOrder());
+    size_t middle = sorted.size();
+    sorted.insert(sorted.end(), added.begin(), added.end());
+    std::inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end(),
+                       EventOrder());
+  };
+  merge(leftEvents, straddlingLeft);
+  merge(rightEvents, straddlingRight);
+}
+
+void odin::KdTree::addLeaf(const std::vector<Triangle> &source,
+                           const std::vector<Event> &events, size_t count,
+                           size_t nodeIndex) {
+  if (count > MAX_KD_INDEX) {
+    throw std::runtime_error("Too many triangles in k-d tree leaf!");
+  }
+
+  uint32_t first = static_cast<uint32_t>(triangles.size());
+  std::memcpy(&nodes[nodeIndex].split, &first, sizeof(first));
+  nodes[nodeIndex].data = static_cast<uint32_t>(count) << 2 | KD_LEAF;
+
+  for (const Event &event : events) {
+    if (event.axis != 0 || event.type == END) {
+      continue;
+    }
+
+    const Triangle &triangle = source[event.triangle];
+    BvhTriangle packed;
+    packed.v0 = glm::vec4(triangle.v0, triangle.normal.x);
+    packed.v1 = glm::vec4(triangle.v1, triangle.normal.y);
+    packed.v2 = glm::vec4(triangle.v2, triangle.normal.z);
+    triangles.push_back(packed);
+  }
+}
+
+void odin::KdTree::addEvents(std::vector<Event> &events, uint32_t triangle,
+                             const AABB &box) {
+  for (int axis = 0; axis < 3; axis++) {
+    uint8_t eventAxis = static_cast<uint8_t>(axis);
+    if (box.min[axis] == box.max[axis]) {
+      events.push_back(Event{box.min[axis], triangle, eventAxis, PLANAR});
+    } else {
+      events.push_back(Event{box.min[axis], triangle, eventAxis, START});
+      events.push_back(Event{box.max[axis], triangle, eventAxis, END});
+    }
+  }
+}
@@ -0,0 +1,102 @@
+// This file is compiled with AVX2 enabled. Its functions are only called
+// once PacketTracer has checked that the CPU supports AVX2
+#include "renderer/packet_kernel.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+struct Avx2Mask {
+  __m256 v;
+
+  int bits() const { return _mm256_movemask_ps(v); }
+};
+
+struct Avx2Float {
+  static const int WIDTH = 8;
+  using Mask = Avx2Mask;
+
+  __m256 v;
+
+  static Avx2Float load(const float *p) { return {_mm256_loadu_ps(p)}; }
+
+  static Avx2Float broadcast(float value) { return {_mm256_set1_ps(value)}; }
+
+  void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+Avx2Float operator+(Avx2Float a, Avx2Float b) {
+  return {_mm256_add_ps(a.v, b.v)};
+}
+
+Avx2Float operator-(Avx2Float a, Avx2Float b) {
+  return {_mm256_sub_ps(a.v, b.v)};
+}
+
+Avx2Float operator*(Avx2Float a, Avx2Float b) {
+  return {_mm256_mul_ps(a.v, b.v)};
+}
+
+Avx2Float operator/(Avx2Float a, Avx2Float b) {
+  return {_mm256_div_ps(a.v, b.v)};
+}
+
+// The operands are swapped so that NaNs are handled like std::min/std::max
+Avx2Float min(Avx2Float a, Avx2Float b) {
+  return {_mm256_min_ps(b.v, a.v)};
+}
+
+Avx2Float max(Avx2Float a, Avx2Float b) {
+  return {_mm256_max_ps(b.v, a.v)};
+}
+
+Avx2Float abs(Avx2Float a) {
+  return {_mm256_and_ps(a.v,
+                        _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)))};
+}
+
+Avx2Mask operator<(Avx2Float a, Avx2Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+
+Avx2Mask operator<=(Avx2Float a, Avx2Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};
+}
+
+Avx2Mask operator>(Avx2Float a, Avx2Float b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+
+Avx2Mask operator&(Avx2Mask a, Avx2Mask b) {
+  return {_mm256_and_ps(a.v, b.v)};
+}
+
+Avx2Mask operator|(Avx2Mask a, Avx2Mask b) {
+  return {_mm256_or_ps(a.v, b.v)};
+}
+
+Avx2Mask operator!(Avx2Mask a) {
+  return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))};
+}
+
+Avx2Float select(Avx2Mask mask, Avx2Float a, Avx2Float b) {
+  return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+}
+}  // namespace
+
+bool odin::packetAvx2Available() { return true; }
+
+void odin::intersectPacketAvx2(const BvhNode *nodes,
+                               const BvhTriangle *triangles,
+                               RayPacket &packet) {
+  intersectPacket<Avx2Float>(nodes, triangles, packet);
+}
+#else
+bool odin::packetAvx2Available() { return false; }
+
+void odin::intersectPacketAvx2(const BvhNode *nodes,
+                               const BvhTriangle *triangles,
+                               RayPacket &packet) {
+  throw std::runtime_error("AVX2 packet traversal was not compiled in!");
+}
+#endif
@@ -0,0 +1,69 @@
+#include "renderer/packet_kernel.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace {
+struct SseMask {
+  __m128 v;
+
+  int bits() const { return _mm_movemask_ps(v); }
+};
+
+struct SseFloat {
+  static const int WIDTH = 4;
+  using Mask = SseMask;
+
+  __m128 v;
+
+  static SseFloat load(const float *p) { return {_mm_loadu_ps(p)}; }
+
+  static SseFloat broadcast(float value) { return {_mm_set1_ps(value)}; }
+
+  void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+SseFloat operator+(SseFloat a, SseFloat b) { return {_mm_add_ps(a.v, b.v)}; }
+SseFloat operator-(SseFloat a, SseFloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+SseFloat operator*(SseFloat a, SseFloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+SseFloat operator/(SseFloat a, SseFloat b) { return {_mm_div_ps(a.v, b.v)}; }
+
+// The operands are swapped so that NaNs are handled like std::min/std::max
+SseFloat min(SseFloat a, SseFloat b) { return {_mm_min_ps(b.v, a.v)}; }
+SseFloat max(SseFloat a, SseFloat b) { return {_mm_max_ps(b.v, a.v)}; }
+
+SseFloat abs(SseFloat a) {
+  return {_mm_and_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)))};
+}
+
+SseMask operator<(SseFloat a, SseFloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+SseMask operator<=(SseFloat a, SseFloat b) { return {_mm_cmple_ps(a.v, b.v)}; }
+SseMask operator>(SseFloat a, SseFloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+
+SseMask operator&(SseMask a, SseMask b) { return {_mm_and_ps(a.v, b.v)}; }
+SseMask operator|(SseMask a, SseMask b) { return {_mm_or_ps(a.v, b.v)}; }
+SseMask operator!(SseMask a) {
+  return {_mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1)))};
+}
+
+SseFloat select(SseMask mask, SseFloat a, SseFloat b) {
+  return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+}  // namespace
+
+bool odin::packetSseAvailable() { return true; }
+
+void odin::intersectPacketSse(const BvhNode *nodes,
+                              const BvhTriangle *triangles,
+                              RayPacket &packet) {
+  intersectPacket<SseFloat>(nodes, triangles, packet);
+}
+#else
+bool odin::packetSseAvailable() { return false; }
+
+void odin::intersectPacketSse(const BvhNode *nodes,
+                              const BvhTriangle *triangles,
+                              RayPacket &packet) {
+  throw std::runtime_error("SSE packet traversal was not compiled in!");
+}
+#endif
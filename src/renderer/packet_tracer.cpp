@@ -0,0 +1,121 @@
+#include "renderer/packet_tracer.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "renderer/packet_kernel.hpp"
+
+namespace {
+// A vector of a single float used where no SIMD instruction set is
+// available. Packets are then traced one ray at a time
+struct ScalarMask {
+  bool v;
+
+  int bits() const { return v ? 1 : 0; }
+};
+
+struct ScalarFloat {
+  static const int WIDTH = 1;
+  using Mask = ScalarMask;
+
+  float v;
+
+  static ScalarFloat load(const float *p) { return {*p}; }
+
+  static ScalarFloat broadcast(float value) { return {value}; }
+
+  void store(float *p) const { *p = v; }
+};
+
+ScalarFloat operator+(ScalarFloat a, ScalarFloat b) { return {a.v + b.v}; }
+ScalarFloat operator-(ScalarFloat a, ScalarFloat b) { return {a.v - b.v}; }
+ScalarFloat operator*(ScalarFloat a, ScalarFloat b) { return {a.v * b.v}; }
+ScalarFloat operator/(ScalarFloat a, ScalarFloat b) { return {a.v / b.v}; }
+
+ScalarFloat min(ScalarFloat a, ScalarFloat b) { return {std::min(a.v, b.v)}; }
+ScalarFloat max(ScalarFloat a, ScalarFloat b) { return {std::max(a.v, b.v)}; }
+ScalarFloat abs(ScalarFloat a) { return {std::abs(a.v)}; }
+
+ScalarMask operator<(ScalarFloat a, ScalarFloat b) { return {a.v < b.v}; }
+ScalarMask operator<=(ScalarFloat a, ScalarFloat b) { return {a.v <= b.v}; }
+ScalarMask operator>(ScalarFloat a, ScalarFloat b) { return {a.v > b.v}; }
+
+ScalarMask operator&(ScalarMask a, ScalarMask b) { return {a.v && b.v}; }
+ScalarMask operator|(ScalarMask a, ScalarMask b) { return {a.v || b.v}; }
+ScalarMask operator!(ScalarMask a) { return {!a.v}; }
+
+ScalarFloat select(ScalarMask mask, ScalarFloat a, ScalarFloat b) {
+  return mask.v ? a : b;
+}
+
+bool cpuSupportsAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+}  // namespace
+
+void odin::intersectPacketScalar(const BvhNode *nodes,
+                                 const BvhTriangle *triangles,
+                                 RayPacket &packet) {
+  intersectPacket<ScalarFloat>(nodes, triangles, packet);
+}
+
+odin::PacketTracer::PacketTracer(const BVH &bvh, PacketIsa isa) : bvh(bvh) {
+  if (isa == PacketIsa::Auto) {
+    if (isSupported(PacketIsa::Avx2)) {
+      isa = PacketIsa::Avx2;
+    } else if (isSupported(PacketIsa::Sse)) {
+      isa = PacketIsa::Sse;
+    } else {
+      isa = PacketIsa::Scalar;
+    }
+  }
+
+  if (!isSupported(isa)) {
+    throw std::runtime_error(
+        "Packet traversal instruction set is not supported!");
+  }
+
+  this->isa = isa;
+  switch (isa) {
+  case PacketIsa::Avx2:
+    intersectFunction = intersectPacketAvx2;
+    break;
+  case PacketIsa::Sse:
+    intersectFunction = intersectPacketSse;
+    break;
+  default:
+    intersectFunction = intersectPacketScalar;
+    break;
+  }
+}
+
+const char *odin::PacketTracer::getIsaName() const {
+  switch (isa) {
+  case PacketIsa::Avx2:
+    return "AVX2";
+  case PacketIsa::Sse:
+    return "SSE";
+  default:
+    return "scalar";
+  }
+}
+
+void odin::PacketTracer::intersect(RayPacket &packet) const {
+  intersectFunction(bvh.nodes.data(), bvh.triangles.data(), packet);
+}
+
+bool odin::PacketTracer::isSupported(PacketIsa isa) {
+  switch (isa) {
+  case PacketIsa::Avx2:
+    return packetAvx2Available() && cpuSupportsAvx2();
+  case PacketIsa::Sse:
+    // SSE2 is part of every x86-64 CPU
+    return packetSseAvailable();
+  default:
+    return true;
+  }
+}
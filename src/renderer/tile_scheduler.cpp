@@ -0,0 +1,64 @@
+#include "renderer/tile_scheduler.hpp"
+
+#include <algorithm>
+
+namespace {
+// Weight of the newest measurement in the running average. Smooths out
+// spikes without taking long to follow changes of the view
+const float TIME_SMOOTHING = 0.25f;
+}  // namespace
+
+const uint32_t odin::TileScheduler::TILE_SIZE;
+
+odin::TileScheduler::TileScheduler(uint32_t width, uint32_t height,
+                                   float frameBudget)
+    : frameBudget(frameBudget) {
+  for (uint32_t y = 0; y < height; y += TILE_SIZE) {
+    for (uint32_t x = 0; x < width; x += TILE_SIZE) {
+      tiles.push_back({x, y, std::min(TILE_SIZE, width - x),
+                       std::min(TILE_SIZE, height - y)});
+    }
+  }
+}
+
+bool odin::TileScheduler::nextBatch(std::vector<ComputeTile> &batch) {
+  size_t remaining = tiles.size() - nextTile;
+  size_t batchSize = remaining;
+  if (frameBudget > 0.0f) {
+    // Start with a single tile until there is a measurement
+    batchSize = 1;
+    if (tileTime > 0.0f) {
+      // Clamped before the conversion, since a tiny tile time makes the
+      // quotient too large for size_t or even infinite
+      batchSize = static_cast<size_t>(std::min(
+          frameBudget / tileTime, static_cast<float>(remaining)));
+    }
+    batchSize = std::max<size_t>(1, std::min(batchSize, remaining));
+  }
+
+  batch.assign(tiles.begin() + nextTile,
+               tiles.begin() + nextTile + batchSize);
+  nextTile += batchSize;
+  if (nextTile == tiles.size()) {
+    nextTile = 0;
+    return true;
+  }
+  return false;
+}
+
+void odin::TileScheduler::reportTime(size_t numTiles, float time) {
+  if (numTiles == 0) {
+    return;
+  }
+
+  float measuredTime = time / numTiles;
+  if (tileTime == 0.0f) {
+    tileTime = measuredTime;
+  } else {
+    tileTime += TIME_SMOOTHING * (measuredTime - tileTime);
+  }
+}
+
+void odin::TileScheduler::restart() { nextTile = 0; }
+
+size_t odin::TileScheduler::getTileCount() const { return tiles.size(); }
\ No newline at end of file
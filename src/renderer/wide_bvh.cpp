@@ -0,0 +1,133 @@
+#include "renderer/wide_bvh.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Number of 32 bit fields in the structure of arrays of a wide node
+const int NODE_FIELDS = 8;
+
+float surfaceArea(const odin::BvhNode &node) {
+  glm::vec3 extent = node.max - node.min;
+  return 2.0f *
+         (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+float bitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+} // namespace
+
+void odin::WideBVH::init(const BVH &bvh, int width) {
+  if (width != 4 && width != 8) {
+    throw std::runtime_error("Wide BVH nodes need 4 or 8 children!");
+  }
+
+  if (bvh.nodes.empty()) {
+    throw std::runtime_error("Cannot collapse an empty BVH!");
+  }
+
+  this->width = width;
+  // Every wide node replaces up to width - 1 interior binary nodes
+  nodes.clear();
+  nodes.reserve((bvh.nodes.size() / (2 * (width - 1)) + 1) * NODE_FIELDS *
+                width);
+  numNodes = 0;
+  addNode();
+
+  int stackSize = collapseNode(bvh, 0, 0);
+  if (stackSize > STACK_SIZE) {
+    throw std::runtime_error("Wide BVH is too deep for the traversal stack!");
+  }
+}
+
+// Fill the wide node at wideIndex with the descendants of a binary node and
+// collapse its interior children recursively. Returns the number of stack
+// entries the traversal of this subtree needs at most
+int odin::WideBVH::collapseNode(const BVH &bvh, uint32_t binaryIndex,
+                                uint32_t wideIndex) {
+  uint32_t children[8];
+  int numChildren = 0;
+  const BvhNode &node = bvh.nodes[binaryIndex];
+  if (node.count > 0) {
+    // Only happens for a root that is a leaf
+    children[numChildren++] = binaryIndex;
+  } else {
+    children[numChildren++] = binaryIndex + 1;
+    children[numChildren++] = node.offset;
+  }
+
+  // Open up the interior child with the largest surface area until the node
+  // is full. Large boxes are the most likely ones to be hit by a ray
+  while (numChildren < width) {
+    int largest = -1;
+    float largestArea = -1.0f;
+    for (int i = 0; i < numChildren; i++) {
+      const BvhNode &child = bvh.nodes[children[i]];
+      if (child.count == 0 && surfaceArea(child) > largestArea) {
+        largest = i;
+        largestArea = surfaceArea(child);
+      }
+    }
+
+    if (largest < 0) {
+      break;
+    }
+
+    uint32_t opened = children[largest];
+    children[largest] = opened + 1;
+    children[numChildren++] = bvh.nodes[opened].offset;
+  }
+
+  int interiorChildren = 0;
+  int childStackSize = 0;
+  for (int slot = 0; slot < numChildren; slot++) {
+    const BvhNode &child = bvh.nodes[children[slot]];
+    if (child.count > 0) {
+      setChild(wideIndex, slot, child, child.offset, child.count);
+      continue;
+    }
+
+    // Allocate the child before recursing so nodes stay in depth-first order
+    uint32_t childIndex = addNode();
+    setChild(wideIndex, slot, child, childIndex, 0);
+    childStackSize = std::max(childStackSize,
+                              collapseNode(bvh, children[slot], childIndex));
+    interiorChildren++;
+  }
+
+  // All but one of the interior children can end up on the stack
+  return interiorChildren > 0 ? interiorChildren - 1 + childStackSize : 0;
+}
+
+// Append a node whose children all have an empty box
+uint32_t odin::WideBVH::addNode() {
+  uint32_t wideIndex = static_cast<uint32_t>(numNodes++);
+  nodes.resize(numNodes * NODE_FIELDS * width, bitsToFloat(0));
+  const float infinity = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; axis++) {
+    std::fill_n(field(wideIndex, static_cast<Field>(MIN_X + axis)), width,
+                infinity);
+    std::fill_n(field(wideIndex, static_cast<Field>(MAX_X + axis)), width,
+                -infinity);
+  }
+  return wideIndex;
+}
+
+void odin::WideBVH::setChild(uint32_t wideIndex, int slot, const BvhNode &node,
+                             uint32_t child, uint32_t count) {
+  for (int axis = 0; axis < 3; axis++) {
+    field(wideIndex, static_cast<Field>(MIN_X + axis))[slot] = node.min[axis];
+    field(wideIndex, static_cast<Field>(MAX_X + axis))[slot] = node.max[axis];
+  }
+  field(wideIndex, CHILD)[slot] = bitsToFloat(child);
+  field(wideIndex, COUNT)[slot] = bitsToFloat(count);
+}
+
+float *odin::WideBVH::field(uint32_t wideIndex, Field field) {
+  return &nodes[(static_cast<size_t>(wideIndex) * NODE_FIELDS + field) *
+                width];
+}
@@ -0,0 +1,20 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "utils/image_writer.hpp"
+
+#include <stb_image_write.h>
+
+#include <stdexcept>
+
+void odin::ImageWriter::writePng(const std::string &filename, uint32_t width,
+                                 uint32_t height,
+                                 const std::vector<uint8_t> &pixels) {
+  if (pixels.size() != static_cast<size_t>(width) * height * 4) {
+    throw std::runtime_error("Image size does not match its pixels!");
+  }
+
+  if (!stbi_write_png(filename.c_str(), static_cast<int>(width),
+                      static_cast<int>(height), 4, pixels.data(),
+                      static_cast<int>(width * 4))) {
+    throw std::runtime_error("Failed to write PNG image!");
+  }
+}
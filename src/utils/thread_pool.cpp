@@ -0,0 +1,154 @@
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+thread_local const odin::ThreadPool *odin::ThreadPool::currentPool = nullptr;
+thread_local size_t odin::ThreadPool::currentWorker = 0;
+
+odin::ThreadPool::ThreadPool(unsigned numThreads)
+    : queuedTasks(0), running(true) {
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned i = 0; i <= numThreads; i++) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+
+  for (unsigned i = 0; i < numThreads; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+odin::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    running = false;
+  }
+  sleepCondition.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+size_t odin::ThreadPool::getThreadCount() const { return workers.size(); }
+
+void odin::ThreadPool::submit(std::function<void()> task) {
+  auto &queue = *queues[currentQueue()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  queuedTasks++;
+
+  // Taking the lock makes sure a worker that is about to sleep either sees
+  // the new task or receives the notification
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  sleepCondition.notify_one();
+}
+
+bool odin::ThreadPool::tryRunTask() {
+  std::function<void()> task;
+  if (!popTask(currentQueue(), task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+size_t odin::ThreadPool::currentQueue() const {
+  // Threads that are not part of this pool share the last queue
+  return currentPool == this ? currentWorker : workers.size();
+}
+
+bool odin::ThreadPool::popTask(size_t queueIndex,
+                               std::function<void()> &task) {
+  if (queuedTasks == 0) {
+    return false;
+  }
+
+  // Newest task of our own queue first since its data is likely still cached
+  {
+    auto &queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      queuedTasks--;
+      return true;
+    }
+  }
+
+  // Steal the oldest task of another queue. These tend to be the largest
+  for (size_t i = 1; i < queues.size(); i++) {
+    auto &queue = *queues[(queueIndex + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      queuedTasks--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void odin::ThreadPool::workerLoop(size_t workerIndex) {
+  currentPool = this;
+  currentWorker = workerIndex;
+
+  while (true) {
+    if (tryRunTask()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepCondition.wait(lock,
+                        [this]() { return !running || queuedTasks > 0; });
+    if (!running) {
+      return;
+    }
+  }
+}
+
+odin::TaskGroup::TaskGroup(ThreadPool &pool) : pool(pool), pendingTasks(0) {}
+
+odin::TaskGroup::~TaskGroup() {
+  // Never leave tasks behind that reference this group
+  while (pendingTasks > 0) {
+    if (!pool.tryRunTask()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void odin::TaskGroup::run(std::function<void()> task) {
+  pendingTasks++;
+  pool.submit([this, task = std::move(task)]() {
+    try {
+      task();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(exceptionMutex);
+      if (!exception) {
+        exception = std::current_exception();
+      }
+    }
+    pendingTasks--;
+  });
+}
+
+void odin::TaskGroup::wait() {
+  while (pendingTasks > 0) {
+    // Help out instead of blocking so that nested waits cannot deadlock
+    if (!pool.tryRunTask()) {
+      std::this_thread::yield();
+    }
+  }
+
+  if (exception) {
+    std::rethrow_exception(std::exchange(exception, nullptr));
+  }
+}
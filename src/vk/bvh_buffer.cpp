@@ -1,48 +1,39 @@
 #include "vk/bvh_buffer.hpp"
 
-#include "vk/command_pool.hpp"
-
 odin::BvhBuffer::BvhBuffer(const DeviceManager &deviceManager,
-                           const CommandPool &commandPool,
-                           const std::vector<BvhNode> &nodes) {
-  numNodes = nodes.size();
-  VkDeviceSize bufferSize = sizeof(nodes[0]) * numNodes;
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(deviceManager.getPhysicalDevice(),
-               deviceManager.getLogicalDevice(), bufferSize,
-               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
-
-  void *data;
-  vkMapMemory(deviceManager.getLogicalDevice(), stagingBufferMemory, 0,
-              bufferSize, 0, &data);
-  memcpy(data, nodes.data(), static_cast<size_t>(bufferSize));
-  vkUnmapMemory(deviceManager.getLogicalDevice(), stagingBufferMemory);
-
-  createBuffer(deviceManager.getPhysicalDevice(),
-               deviceManager.getLogicalDevice(), bufferSize,
-               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                   VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bvhBufferMemory);
-
-  copyBuffer(deviceManager, commandPool, stagingBuffer, buffer, bufferSize);
+                           StagingRing &stagingRing, const BVH &bvh) {
+  numNodes = bvh.nodes.size();
+  uploadBuffers(deviceManager, stagingRing, bvh.nodes.data(),
+                sizeof(bvh.nodes[0]) * numNodes, bvh.triangles);
+}
 
-  vkDestroyBuffer(deviceManager.getLogicalDevice(), stagingBuffer, nullptr);
-  vkFreeMemory(deviceManager.getLogicalDevice(), stagingBufferMemory, nullptr);
+odin::BvhBuffer::BvhBuffer(const DeviceManager &deviceManager,
+                           StagingRing &stagingRing, const BVH &bvh,
+                           const WideBVH &wideBvh) {
+  numNodes = wideBvh.numNodes;
+  uploadBuffers(deviceManager, stagingRing, wideBvh.nodes.data(),
+                sizeof(wideBvh.nodes[0]) * wideBvh.nodes.size(),
+                bvh.triangles);
+}
 
-  // Setup descriptor
-  descriptor.offset = 0;
-  descriptor.buffer = buffer;
-  descriptor.range = VK_WHOLE_SIZE;
+odin::BvhBuffer::BvhBuffer(const DeviceManager &deviceManager,
+                           StagingRing &stagingRing,
+                           const KdTree &kdTree) {
+  // The shader clips rays to the scene bounds stored in front of the nodes
+  numNodes = kdTree.nodes.size();
+  size_t nodeDataSize = sizeof(kdTree.nodes[0]) * numNodes;
+  std::vector<glm::vec4> data(2 + (nodeDataSize + sizeof(glm::vec4) - 1) /
+                                      sizeof(glm::vec4));
+  data[0] = glm::vec4(kdTree.bounds.min, 0.0f);
+  data[1] = glm::vec4(kdTree.bounds.max, 0.0f);
+  memcpy(&data[2], kdTree.nodes.data(), nodeDataSize);
+  uploadBuffers(deviceManager, stagingRing, data.data(),
+                sizeof(data[0]) * data.size(), kdTree.triangles);
 }
 
 const VkBuffer odin::BvhBuffer::getBuffer() const { return buffer; }
 
-const VkDeviceMemory odin::BvhBuffer::getBufferMemory() const {
+const odin::MemoryAllocation &odin::BvhBuffer::getBufferMemory() const {
   return bvhBufferMemory;
 }
 
@@ -50,4 +41,56 @@ const VkDescriptorBufferInfo odin::BvhBuffer::getDescriptor() const {
   return descriptor;
 }
 
-const size_t odin::BvhBuffer::getNodeCount() const { return numNodes; }
\ No newline at end of file
+const size_t odin::BvhBuffer::getNodeCount() const { return numNodes; }
+
+const VkBuffer odin::BvhBuffer::getTriangleBuffer() const {
+  return triangleBuffer;
+}
+
+const odin::MemoryAllocation &odin::BvhBuffer::getTriangleBufferMemory()
+    const {
+  return triangleBufferMemory;
+}
+
+const VkDescriptorBufferInfo odin::BvhBuffer::getTriangleDescriptor() const {
+  return triangleDescriptor;
+}
+
+const size_t odin::BvhBuffer::getTriangleCount() const { return numTriangles; }
+
+void odin::BvhBuffer::uploadBuffers(const DeviceManager &deviceManager,
+                                    StagingRing &stagingRing,
+                                    const void *nodeData,
+                                    VkDeviceSize nodeDataSize,
+                                    const std::vector<BvhTriangle> &triangles) {
+  uploadBuffer(deviceManager, stagingRing, nodeData, nodeDataSize, buffer,
+               bvhBufferMemory);
+
+  numTriangles = triangles.size();
+  uploadBuffer(deviceManager, stagingRing, triangles.data(),
+               sizeof(triangles[0]) * numTriangles, triangleBuffer,
+               triangleBufferMemory);
+
+  // Setup descriptors
+  descriptor.offset = 0;
+  descriptor.buffer = buffer;
+  descriptor.range = VK_WHOLE_SIZE;
+
+  triangleDescriptor.offset = 0;
+  triangleDescriptor.buffer = triangleBuffer;
+  triangleDescriptor.range = VK_WHOLE_SIZE;
+}
+
+void odin::BvhBuffer::uploadBuffer(const DeviceManager &deviceManager,
+                                   StagingRing &stagingRing,
+                                   const void *data, VkDeviceSize bufferSize,
+                                   VkBuffer &deviceBuffer,
+                                   MemoryAllocation &deviceBufferMemory) {
+  createBuffer(deviceManager, bufferSize,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                   VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, deviceBuffer,
+               deviceBufferMemory, stagingRing.getQueueFamilies());
+
+  stagingRing.upload(deviceManager, deviceBuffer, data, bufferSize);
+}
\ No newline at end of file
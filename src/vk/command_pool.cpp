@@ -4,20 +4,52 @@
 #include "vk/descriptor_pool.hpp"
 #include "vk/graphics_pipeline.hpp"
 #include "vk/texture_image.hpp"
+#include "vk/timestamp_query.hpp"
+#include "vk/wavefront_pipeline.hpp"
 
 odin::CommandPool::CommandPool(
     const VkDevice& logicalDevice,
-    const odin::QueueFamilyIndices& queueFamilyIndices) {
+    const odin::QueueFamilyIndices& queueFamilyIndices, uint32_t numSlots) {
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily.value();
-  poolInfo.flags = 0;
+  // The compute command buffer is recorded again for every batch of tiles
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
   if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr,
                           &computeCommandPool) != VK_SUCCESS) {
     throw std::runtime_error("Failed to create compute command pool!");
   }
 
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool = computeCommandPool;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = numSlots;
+
+  computeCommandBuffers.resize(numSlots);
+  if (vkAllocateCommandBuffers(logicalDevice, &allocInfo,
+                               computeCommandBuffers.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate command buffers!");
+  }
+
+  // One-shot work goes to the graphics queue if there is one. Its command
+  // buffers are short-lived and recorded again whenever they are reused
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value_or(
+      queueFamilyIndices.computeFamily.value());
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr,
+                          &transientCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create transient command pool!");
+  }
+
+  if (!queueFamilyIndices.graphicsFamily.has_value()) {
+    return;
+  }
+
+  poolInfo.flags = 0;
+
   // Create separate queue for graphics since indices might be different
   poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
   if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr,
@@ -26,71 +58,84 @@ odin::CommandPool::CommandPool(
   }
 }
 
-const VkCommandBuffer odin::CommandPool::beginSingleTimeCommands(
-    const VkDevice& logicalDevice) const {
-  VkCommandBufferAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = graphicsCommandPool;
-  allocInfo.commandBufferCount = 1;
+const VkCommandBuffer odin::CommandPool::beginTransientCommands(
+    const VkDevice& logicalDevice) {
+  if (recordingTransient) {
+    return transientCommandBuffers[transientIndex];
+  }
 
-  VkCommandBuffer commandBuffer;
-  vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+  // Reuse the first command buffer whose submission has finished
+  transientIndex = 0;
+  while (transientIndex < transientCommandBuffers.size() &&
+         vkGetFenceStatus(logicalDevice, transientFences[transientIndex]) !=
+             VK_SUCCESS) {
+    transientIndex++;
+  }
 
-  VkCommandBufferBeginInfo beginInfo = {};
-  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (transientIndex == transientCommandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = transientCommandPool;
+    allocInfo.commandBufferCount = 1;
 
-  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to allocate transient command buffer!");
+    }
 
-  return commandBuffer;
-}
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 
-void odin::CommandPool::createComputeCommandBuffers(
-    const VkDevice& logicalDevice, const RenderPass& renderPass,
-    const ComputePipeline& computePipeline,
-    const DescriptorPool& descriptorPool, uint32_t texWidth,
-    uint32_t texHeight) {
-  VkCommandBufferAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = computeCommandPool;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = 1;
+    VkFence fence;
+    if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to create transient fence!");
+    }
 
-  if (vkAllocateCommandBuffers(logicalDevice, &allocInfo,
-                               &computeCommandBuffer) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to allocate command buffers!");
+    transientCommandBuffers.push_back(commandBuffer);
+    transientFences.push_back(fence);
+  } else {
+    vkResetFences(logicalDevice, 1, &transientFences[transientIndex]);
   }
 
-  VkCommandBufferBeginInfo commandBufferInfo = {};
-  commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-  if (vkBeginCommandBuffer(computeCommandBuffer, &commandBufferInfo) !=
-      VK_SUCCESS) {
-    throw std::runtime_error(
-        "Unable to begin recording compute command buffer commands!");
+  if (vkBeginCommandBuffer(transientCommandBuffers[transientIndex],
+                           &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin transient command buffer!");
   }
+  recordingTransient = true;
 
-  // Record commands for the compute pipeline
-  vkCmdBindPipeline(computeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                    computePipeline.getComputePipeline());
-  vkCmdBindDescriptorSets(computeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                          computePipeline.getPipelineLayout(), 0, 1,
-                          descriptorPool.getComputeDescriptorSet(), 0, 0);
-  // Break up raytracing task into work groups
-  vkCmdDispatch(computeCommandBuffer, texWidth / WORK_GROUP_SIZE,
-                texHeight / WORK_GROUP_SIZE, 1);
+  return transientCommandBuffers[transientIndex];
+}
 
-  vkEndCommandBuffer(computeCommandBuffer);
+void odin::CommandPool::cleanupTransientCommands(
+    const VkDevice& logicalDevice) {
+  if (!transientFences.empty()) {
+    vkWaitForFences(logicalDevice,
+                    static_cast<uint32_t>(transientFences.size()),
+                    transientFences.data(), VK_TRUE, UINT64_MAX);
+  }
+  for (VkFence fence : transientFences) {
+    vkDestroyFence(logicalDevice, fence, nullptr);
+  }
+  transientFences.clear();
+  transientCommandBuffers.clear();
+  vkDestroyCommandPool(logicalDevice, transientCommandPool, nullptr);
 }
 
 void odin::CommandPool::createGraphicsCommandBuffers(
     const VkDevice& logicalDevice, const RenderPass& renderPass,
     const GraphicsPipeline& graphicsPipeline,
     const DescriptorPool& descriptorPool, const Swapchain& swapChain,
-    const TextureImage& texture) {
+    const std::vector<std::unique_ptr<TextureImage>>& outputImages) {
   // Allocate command buffers first
-  graphicsCommandBuffers.resize(swapChain.getFrameBufferSizes());
+  numImages = static_cast<uint32_t>(swapChain.getFrameBufferSizes());
+  graphicsCommandBuffers.resize(outputImages.size() * numImages);
   VkCommandBufferAllocateInfo allocInfo = {};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.commandPool = graphicsCommandPool;
@@ -115,13 +160,15 @@ void odin::CommandPool::createGraphicsCommandBuffers(
   renderPassBeginInfo.renderPass = renderPass.getRenderPass();
   renderPassBeginInfo.renderArea.offset.x = 0;
   renderPassBeginInfo.renderArea.offset.y = 0;
-  renderPassBeginInfo.renderArea.extent.height = texture.getHeight();
-  renderPassBeginInfo.renderArea.extent.width = texture.getWidth();
+  renderPassBeginInfo.renderArea.extent.height = outputImages[0]->getHeight();
+  renderPassBeginInfo.renderArea.extent.width = outputImages[0]->getWidth();
   renderPassBeginInfo.clearValueCount = 2;
   renderPassBeginInfo.pClearValues = clearValues;
 
   for (uint32_t i = 0; i < graphicsCommandBuffers.size(); i++) {
-    renderPassBeginInfo.framebuffer = swapChain.getFrameBuffer(i);
+    uint32_t slot = i / numImages;
+    const TextureImage& texture = *outputImages[slot];
+    renderPassBeginInfo.framebuffer = swapChain.getFrameBuffer(i % numImages);
 
     if (vkBeginCommandBuffer(graphicsCommandBuffers[i], &commandBufferInfo) !=
         VK_SUCCESS) {
@@ -166,7 +213,7 @@ void odin::CommandPool::createGraphicsCommandBuffers(
     vkCmdBindDescriptorSets(
         graphicsCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
         graphicsPipeline.getPipelineLayout(), 0, 1,
-        descriptorPool.getGraphicsDescriptorSet(), 0, nullptr);
+        descriptorPool.getGraphicsDescriptorSet(slot), 0, nullptr);
 
     vkCmdBindPipeline(graphicsCommandBuffers[i],
                       VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -183,26 +230,9 @@ void odin::CommandPool::createGraphicsCommandBuffers(
   }
 }
 
-void odin::CommandPool::endSingleTimeCommands(
-    const DeviceManager& deviceManager, VkCommandBuffer commandBuffer) const {
-  vkEndCommandBuffer(commandBuffer);
-
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffer;
-
-  vkQueueSubmit(deviceManager.getGraphicsQueue(), 1, &submitInfo,
-                VK_NULL_HANDLE);
-
-  vkQueueWaitIdle(deviceManager.getGraphicsQueue());
-
-  vkFreeCommandBuffers(deviceManager.getLogicalDevice(), graphicsCommandPool, 1,
-                       &commandBuffer);
-}
-
-const VkCommandBuffer* odin::CommandPool::getComputeCommandBuffer() const {
-  return &computeCommandBuffer;
+const VkCommandBuffer* odin::CommandPool::getComputeCommandBuffer(
+    uint32_t slot) const {
+  return &computeCommandBuffers[slot];
 }
 
 const VkCommandPool odin::CommandPool::getComputeCommandPool() const {
@@ -210,8 +240,8 @@ const VkCommandPool odin::CommandPool::getComputeCommandPool() const {
 }
 
 const VkCommandBuffer* odin::CommandPool::getGraphicsCommandBuffer(
-    uint32_t bufferIndex) const {
-  return &graphicsCommandBuffers[bufferIndex];
+    uint32_t slot, uint32_t imageIndex) const {
+  return &graphicsCommandBuffers[slot * numImages + imageIndex];
 }
 
 const std::vector<VkCommandBuffer>
@@ -225,4 +255,180 @@ const size_t odin::CommandPool::getGraphicsCommandBufferSize() const {
 
 const VkCommandPool odin::CommandPool::getGraphicsCommandPool() const {
   return graphicsCommandPool;
+}
+
+const VkQueue odin::CommandPool::getTransientQueue(
+    const DeviceManager& deviceManager) const {
+  return graphicsCommandPool != VK_NULL_HANDLE
+             ? deviceManager.getGraphicsQueue()
+             : deviceManager.getComputeQueue();
+}
+
+void odin::CommandPool::recordComputeCommandBuffer(
+    uint32_t slot, const ComputePipeline& computePipeline,
+    const DescriptorPool& descriptorPool,
+    const std::vector<ComputeTile>& tiles,
+    const ComputePushConstants& frameConstants,
+    const TimestampQuery& timestampQuery,
+    const WavefrontPipeline* wavefrontPipeline,
+    const TextureImage* previousImage, const TextureImage* outputImage) {
+  VkCommandBuffer computeCommandBuffer = computeCommandBuffers[slot];
+  VkCommandBufferBeginInfo commandBufferInfo = {};
+  commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  commandBufferInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(computeCommandBuffer, &commandBufferInfo) !=
+      VK_SUCCESS) {
+    throw std::runtime_error(
+        "Unable to begin recording compute command buffer commands!");
+  }
+
+  if (timestampQuery.isSupported()) {
+    timestampQuery.reset(computeCommandBuffer);
+    timestampQuery.writeStart(computeCommandBuffer);
+  }
+
+  // The accumulation buffer is read and written again by every frame, and
+  // the submissions of the other slots may have copied images and buffers
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+      VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      computeCommandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+  if (previousImage != nullptr && outputImage != nullptr) {
+    recordImageCopy(computeCommandBuffer, *previousImage, *outputImage);
+  }
+
+  if (wavefrontPipeline != nullptr) {
+    wavefrontPipeline->recordTiles(computeCommandBuffer, descriptorPool, slot,
+                                   tiles, frameConstants);
+  } else {
+    // Record commands for the compute pipeline
+    vkCmdBindPipeline(computeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      computePipeline.getComputePipeline());
+    vkCmdBindDescriptorSets(
+        computeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        computePipeline.getPipelineLayout(), 0, 1,
+        descriptorPool.getComputeDescriptorSet(slot), 0, 0);
+
+    // Tiles do not overlap and the shader discards the invocations past the
+    // edge of their tile, so the dispatches need no barriers in between
+    const ComputeSpecialization& specialization =
+        computePipeline.getSpecialization();
+    for (const ComputeTile& tile : tiles) {
+      ComputePushConstants pushConstants = frameConstants;
+      pushConstants.tileOffsetX = tile.x;
+      pushConstants.tileOffsetY = tile.y;
+      pushConstants.tileWidth = tile.width;
+      pushConstants.tileHeight = tile.height;
+      vkCmdPushConstants(computeCommandBuffer,
+                         computePipeline.getPipelineLayout(),
+                         VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants),
+                         &pushConstants);
+
+      // Break up raytracing task into work groups. Round up so that the
+      // edges of images that are not a multiple of the work group size are
+      // covered
+      vkCmdDispatch(computeCommandBuffer,
+                    (tile.width + specialization.workGroupWidth - 1) /
+                        specialization.workGroupWidth,
+                    (tile.height + specialization.workGroupHeight - 1) /
+                        specialization.workGroupHeight,
+                    1);
+    }
+  }
+
+  if (timestampQuery.isSupported()) {
+    timestampQuery.writeEnd(computeCommandBuffer);
+  }
+
+  if (vkEndCommandBuffer(computeCommandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("Unable to end recording of compute commands!");
+  }
+}
+
+void odin::CommandPool::recordImageCopy(VkCommandBuffer commandBuffer,
+                                        const TextureImage& source,
+                                        const TextureImage& destination) const {
+  // Both images stay in the general layout that the compute shader writes
+  std::array<VkImageMemoryBarrier, 2> barriers = {};
+  for (VkImageMemoryBarrier& barrier : barriers) {
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+  }
+  barriers[0].image = source.getTextureImage();
+  barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barriers[1].image = destination.getTextureImage();
+  barriers[1].srcAccessMask = 0;
+  barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, static_cast<uint32_t>(barriers.size()),
+                       barriers.data());
+
+  VkImageCopy region = {};
+  region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.srcSubresource.layerCount = 1;
+  region.dstSubresource = region.srcSubresource;
+  region.extent = {destination.getWidth(), destination.getHeight(), 1};
+  vkCmdCopyImage(commandBuffer, source.getTextureImage(),
+                 VK_IMAGE_LAYOUT_GENERAL, destination.getTextureImage(),
+                 VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+  // The tiles of the batch overwrite parts of the copy
+  VkImageMemoryBarrier& barrier = barriers[1];
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+}
+
+void odin::CommandPool::submitTransientCommands(
+    const DeviceManager& deviceManager) {
+  if (!recordingTransient) {
+    return;
+  }
+
+  VkCommandBuffer commandBuffer = transientCommandBuffers[transientIndex];
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to record transient command buffer!");
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  if (vkQueueSubmit(getTransientQueue(deviceManager), 1, &submitInfo,
+                    transientFences[transientIndex]) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit transient command buffer!");
+  }
+  recordingTransient = false;
+}
+
+void odin::CommandPool::waitTransientCommands(
+    const DeviceManager& deviceManager) {
+  submitTransientCommands(deviceManager);
+  if (transientFences.empty()) {
+    return;
+  }
+  vkWaitForFences(deviceManager.getLogicalDevice(),
+                  static_cast<uint32_t>(transientFences.size()),
+                  transientFences.data(), VK_TRUE, UINT64_MAX);
 }
\ No newline at end of file
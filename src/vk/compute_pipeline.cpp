@@ -3,8 +3,20 @@
 odin::ComputePipeline::ComputePipeline(
     const DeviceManager& deviceManager,
     const DescriptorSetLayout& descriptorSetLayout,
-    const std::string& computeShaderPath) {
-  createPipeline(deviceManager, descriptorSetLayout, computeShaderPath);
+    const std::string& computeShaderPath,
+    const ComputeSpecialization& specialization)
+    : specialization(specialization) {
+  createPipeline(deviceManager, descriptorSetLayout, computeShaderPath,
+                 specialization);
+}
+
+void odin::ComputePipeline::cleanup(const DeviceManager& deviceManager) {
+  vkDestroyPipelineLayout(deviceManager.getLogicalDevice(), pipelineLayout,
+                          nullptr);
+  vkDestroyPipeline(deviceManager.getLogicalDevice(), computePipeline,
+                    nullptr);
+  pipelineLayout = VK_NULL_HANDLE;
+  computePipeline = VK_NULL_HANDLE;
 }
 
 const VkPipeline odin::ComputePipeline::getComputePipeline() const {
@@ -15,10 +27,16 @@ const VkPipelineLayout odin::ComputePipeline::getPipelineLayout() const {
   return pipelineLayout;
 }
 
+const odin::ComputeSpecialization& odin::ComputePipeline::getSpecialization()
+    const {
+  return specialization;
+}
+
 void odin::ComputePipeline::createPipeline(
     const DeviceManager& deviceManager,
     const DescriptorSetLayout& descriptorSetLayout,
-    const std::string& computeShaderPath) {
+    const std::string& computeShaderPath,
+    const ComputeSpecialization& specialization) {
   // Load compute shader
   auto computeShaderCode = FileReader::readFile(computeShaderPath);
 
@@ -26,6 +44,48 @@ void odin::ComputePipeline::createPipeline(
   ShaderModule computeShaderModule(deviceManager.getLogicalDevice(),
                                    computeShaderCode);
 
+  // Map the specialization values onto the constant ids of the shader
+  std::array<VkSpecializationMapEntry, 8> specializationEntries = {};
+  specializationEntries[0].constantID = 0;
+  specializationEntries[0].offset = offsetof(ComputeSpecialization, bvhWidth);
+  specializationEntries[0].size = sizeof(specialization.bvhWidth);
+  specializationEntries[1].constantID = 1;
+  specializationEntries[1].offset =
+      offsetof(ComputeSpecialization, accelerationStructure);
+  specializationEntries[1].size = sizeof(specialization.accelerationStructure);
+  // Shaders without this constant ignore it
+  specializationEntries[2].constantID = 2;
+  specializationEntries[2].offset = offsetof(ComputeSpecialization, material);
+  specializationEntries[2].size = sizeof(specialization.material);
+  specializationEntries[3].constantID = 3;
+  specializationEntries[3].offset =
+      offsetof(ComputeSpecialization, sortedRays);
+  specializationEntries[3].size = sizeof(specialization.sortedRays);
+  specializationEntries[4].constantID = 4;
+  specializationEntries[4].offset =
+      offsetof(ComputeSpecialization, numSamples);
+  specializationEntries[4].size = sizeof(specialization.numSamples);
+  specializationEntries[5].constantID = 5;
+  specializationEntries[5].offset =
+      offsetof(ComputeSpecialization, numBounces);
+  specializationEntries[5].size = sizeof(specialization.numBounces);
+  // Only the megakernel sizes its work groups with these
+  specializationEntries[6].constantID = 6;
+  specializationEntries[6].offset =
+      offsetof(ComputeSpecialization, workGroupWidth);
+  specializationEntries[6].size = sizeof(specialization.workGroupWidth);
+  specializationEntries[7].constantID = 7;
+  specializationEntries[7].offset =
+      offsetof(ComputeSpecialization, workGroupHeight);
+  specializationEntries[7].size = sizeof(specialization.workGroupHeight);
+
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount =
+      static_cast<uint32_t>(specializationEntries.size());
+  specializationInfo.pMapEntries = specializationEntries.data();
+  specializationInfo.dataSize = sizeof(specialization);
+  specializationInfo.pData = &specialization;
+
   // Setup compute shader stage
   VkPipelineShaderStageCreateInfo computeShaderStageStageInfo = {};
   computeShaderStageStageInfo.sType =
@@ -33,6 +93,12 @@ void odin::ComputePipeline::createPipeline(
   computeShaderStageStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
   computeShaderStageStageInfo.module = computeShaderModule.getShaderModule();
   computeShaderStageStageInfo.pName = "main";
+  computeShaderStageStageInfo.pSpecializationInfo = &specializationInfo;
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ComputePushConstants);
 
   // Setup compute pipeline layout
   VkPipelineLayoutCreateInfo pipelineLayoutInfo;
@@ -41,7 +107,8 @@ void odin::ComputePipeline::createPipeline(
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayout.getDescriptorSetLayout();
   pipelineLayoutInfo.flags = 0;
   pipelineLayoutInfo.pNext = nullptr;
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
   if (vkCreatePipelineLayout(deviceManager.getLogicalDevice(),
                              &pipelineLayoutInfo, nullptr,
@@ -56,9 +123,10 @@ void odin::ComputePipeline::createPipeline(
   pipelineCreateInfo.flags = 0;
   pipelineCreateInfo.stage = computeShaderStageStageInfo;
 
-  if (vkCreateComputePipelines(deviceManager.getLogicalDevice(), VK_NULL_HANDLE,
-                               1, &pipelineCreateInfo, nullptr,
-                               &computePipeline) != VK_SUCCESS) {
+  if (vkCreateComputePipelines(
+          deviceManager.getLogicalDevice(),
+          deviceManager.getPipelineCache().getPipelineCache(), 1,
+          &pipelineCreateInfo, nullptr, &computePipeline) != VK_SUCCESS) {
     throw std::runtime_error("Failed to create compute pipeline!");
   }
 }
\ No newline at end of file
@@ -3,13 +3,13 @@
 #include "vk/command_pool.hpp"
 
 odin::DepthImage::DepthImage(const DeviceManager& deviceManager,
-                             const CommandPool& commandPool,
+                             CommandPool& commandPool,
                              const Swapchain& swapChain) {
   createDepthResources(deviceManager, commandPool, swapChain);
 }
 
 void odin::DepthImage::createDepthResources(const DeviceManager& deviceManager,
-                                            const CommandPool& commandPool,
+                                            CommandPool& commandPool,
                                             const Swapchain& swapChain) {
   VkFormat depthFormat = findDepthFormat(deviceManager);
 
@@ -58,7 +58,7 @@ VkFormat odin::DepthImage::findSupportedFormat(
   throw std::runtime_error("Failed to find supported format!");
 }
 
-const VkDeviceMemory odin::DepthImage::getDeviceMemory() const {
+const odin::MemoryAllocation& odin::DepthImage::getDeviceMemory() const {
   return depthImageMemory;
 }
 
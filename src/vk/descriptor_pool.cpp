@@ -7,31 +7,52 @@ odin::DescriptorPool::DescriptorPool(
     const DeviceManager& deviceManager, const Swapchain& swapChain,
     const DescriptorSetLayout& computeDescriptorSetLayout,
     const DescriptorSetLayout& graphicsDescriptorSetLayout,
-    const TextureImage& textureImage, const TextureSampler& textureSampler,
+    const std::vector<std::unique_ptr<TextureImage>>& outputImages,
+    const TextureSampler& textureSampler,
+    const std::vector<std::vector<VkDescriptorBufferInfo>>& bufferInfos) {
+  if (outputImages.size() != bufferInfos.size()) {
+    throw std::runtime_error("Every frame slot needs an output image!");
+  }
+
+  createDescriptorPool(deviceManager,
+                       static_cast<uint32_t>(outputImages.size()));
+  for (size_t i = 0; i < outputImages.size(); i++) {
+    createComputeDescriptorSet(deviceManager, computeDescriptorSetLayout,
+                               outputImages[i]->getDescriptor(),
+                               bufferInfos[i]);
+    createGraphicsDescriptorSet(deviceManager, graphicsDescriptorSetLayout,
+                                *outputImages[i], textureSampler);
+  }
+}
+
+odin::DescriptorPool::DescriptorPool(
+    const DeviceManager& deviceManager,
+    const DescriptorSetLayout& computeDescriptorSetLayout,
+    const VkDescriptorImageInfo* outputImage,
     const std::vector<VkDescriptorBufferInfo>& bufferInfos) {
-  createDescriptorPool(deviceManager, swapChain);
-  createComputeDescriptorSets(deviceManager, computeDescriptorSetLayout,
-                              swapChain, textureImage, bufferInfos);
-  createGraphicsDescriptorSets(deviceManager, graphicsDescriptorSetLayout,
-                               textureImage, textureSampler);
+  createDescriptorPool(deviceManager, 1);
+  createComputeDescriptorSet(deviceManager, computeDescriptorSetLayout,
+                             outputImage, bufferInfos);
 }
 
 const VkDescriptorPool odin::DescriptorPool::getDescriptorPool() const {
   return descriptorPool;
 }
 
-const VkDescriptorSet* odin::DescriptorPool::getComputeDescriptorSet() const {
-  return &computeDescriptorSet;
+const VkDescriptorSet* odin::DescriptorPool::getComputeDescriptorSet(
+    uint32_t slot) const {
+  return &computeDescriptorSets[slot];
 }
 
-const VkDescriptorSet* odin::DescriptorPool::getGraphicsDescriptorSet() const {
-  return &graphicsDescriptorSet;
+const VkDescriptorSet* odin::DescriptorPool::getGraphicsDescriptorSet(
+    uint32_t slot) const {
+  return &graphicsDescriptorSets[slot];
 }
 
-void odin::DescriptorPool::createComputeDescriptorSets(
+void odin::DescriptorPool::createComputeDescriptorSet(
     const DeviceManager& deviceManager,
-    const DescriptorSetLayout& descriptorSetLayout, const Swapchain& swapChain,
-    const TextureImage& textureImage,
+    const DescriptorSetLayout& descriptorSetLayout,
+    const VkDescriptorImageInfo* outputImage,
     const std::vector<VkDescriptorBufferInfo> bufferInfos) {
   // Allocate the descriptors for the compute pipeline
   VkDescriptorSetAllocateInfo allocInfo = {};
@@ -40,14 +61,18 @@ void odin::DescriptorPool::createComputeDescriptorSets(
   allocInfo.pSetLayouts = descriptorSetLayout.getDescriptorSetLayout();
   allocInfo.descriptorSetCount = 1;
 
+  VkDescriptorSet computeDescriptorSet;
   if (vkAllocateDescriptorSets(deviceManager.getLogicalDevice(), &allocInfo,
                                &computeDescriptorSet) != VK_SUCCESS) {
     throw std::runtime_error(
         "Unable to allocate descriptor set for compute pipeline!");
   }
+  computeDescriptorSets.push_back(computeDescriptorSet);
 
-  // Buffer descriptors need to match our bind points
-  if (bufferInfos.size() != BUFFER_DESCRIPTORS) {
+  // Buffer descriptors need to match our bind points. The buffers of the
+  // wavefront path tracer are optional
+  if (bufferInfos.size() != BUFFER_DESCRIPTORS &&
+      bufferInfos.size() != BUFFER_DESCRIPTORS + WAVEFRONT_DESCRIPTORS) {
     throw std::runtime_error("Buffer Descriptors size does not match!");
   }
 
@@ -57,7 +82,7 @@ void odin::DescriptorPool::createComputeDescriptorSets(
   outputDescriptor.dstSet = computeDescriptorSet;
   outputDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
   outputDescriptor.dstBinding = 0;
-  outputDescriptor.pImageInfo = textureImage.getDescriptor();
+  outputDescriptor.pImageInfo = outputImage;
   outputDescriptor.descriptorCount = 1;
 
   // Uniform Buffer Object for various data
@@ -69,17 +94,48 @@ void odin::DescriptorPool::createComputeDescriptorSets(
   uboDescriptor.pBufferInfo = &bufferInfos[0];
   uboDescriptor.descriptorCount = 1;
 
-  // Triangle data for performing pathtracing in the compute shader
+  // BVH nodes for performing pathtracing in the compute shader
+  VkWriteDescriptorSet bvhDescriptor = {};
+  bvhDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  bvhDescriptor.dstSet = computeDescriptorSet;
+  bvhDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bvhDescriptor.dstBinding = 2;
+  bvhDescriptor.pBufferInfo = &bufferInfos[1];
+  bvhDescriptor.descriptorCount = 1;
+
+  // Triangles referenced by the leaves of the BVH
   VkWriteDescriptorSet triangleDescriptor = {};
   triangleDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   triangleDescriptor.dstSet = computeDescriptorSet;
   triangleDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  triangleDescriptor.dstBinding = 2;
-  triangleDescriptor.pBufferInfo = &bufferInfos[1];
+  triangleDescriptor.dstBinding = 3;
+  triangleDescriptor.pBufferInfo = &bufferInfos[2];
   triangleDescriptor.descriptorCount = 1;
 
-  std::array<VkWriteDescriptorSet, 3> computeWriteDescriptorSets = {
-      outputDescriptor, uboDescriptor, triangleDescriptor};
+  // Samples accumulated over several frames
+  VkWriteDescriptorSet accumulationDescriptor = {};
+  accumulationDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  accumulationDescriptor.dstSet = computeDescriptorSet;
+  accumulationDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  accumulationDescriptor.dstBinding = 4;
+  accumulationDescriptor.pBufferInfo = &bufferInfos[3];
+  accumulationDescriptor.descriptorCount = 1;
+
+  std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
+      outputDescriptor, uboDescriptor, bvhDescriptor, triangleDescriptor,
+      accumulationDescriptor};
+
+  // Paths, queues, hits, counters and sort bins of the wavefront path tracer
+  for (uint32_t i = BUFFER_DESCRIPTORS; i < bufferInfos.size(); i++) {
+    VkWriteDescriptorSet wavefrontDescriptor = {};
+    wavefrontDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    wavefrontDescriptor.dstSet = computeDescriptorSet;
+    wavefrontDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    wavefrontDescriptor.dstBinding = i + 1;
+    wavefrontDescriptor.pBufferInfo = &bufferInfos[i];
+    wavefrontDescriptor.descriptorCount = 1;
+    computeWriteDescriptorSets.push_back(wavefrontDescriptor);
+  }
 
   vkUpdateDescriptorSets(deviceManager.getLogicalDevice(),
                          computeWriteDescriptorSets.size(),
@@ -87,27 +143,28 @@ void odin::DescriptorPool::createComputeDescriptorSets(
 }
 
 void odin::DescriptorPool::createDescriptorPool(
-    const DeviceManager& deviceManager, const Swapchain& swapChain) {
-  // Need to match the amount of descriptors we have for the descriptor layout
+    const DeviceManager& deviceManager, uint32_t numSlots) {
+  // Need to match the amount of descriptors we have for the descriptor
+  // layout, once for every frame slot
   std::array<VkDescriptorPoolSize, 4> poolSizes = {};
   // Pool size for UBOs
   poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = 2;
+  poolSizes[0].descriptorCount = 2 * numSlots;
   // Pool size for graphics pipeline image sampler
   poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = 4;
+  poolSizes[1].descriptorCount = 4 * numSlots;
   // Storage image for raytraced result
   poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-  poolSizes[2].descriptorCount = 1;
-  // Storage buffer for scene primitives
+  poolSizes[2].descriptorCount = numSlots;
+  // Storage buffers for scene primitives and the wavefront path tracer
   poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  poolSizes[3].descriptorCount = 2;
+  poolSizes[3].descriptorCount = 9 * numSlots;
 
   VkDescriptorPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = 3;
+  poolInfo.maxSets = 3 * numSlots;
 
   if (vkCreateDescriptorPool(deviceManager.getLogicalDevice(), &poolInfo,
                              nullptr, &descriptorPool) != VK_SUCCESS) {
@@ -115,7 +172,7 @@ void odin::DescriptorPool::createDescriptorPool(
   }
 }
 
-void odin::DescriptorPool::createGraphicsDescriptorSets(
+void odin::DescriptorPool::createGraphicsDescriptorSet(
     const DeviceManager& deviceManager,
     const DescriptorSetLayout& descriptorSetLayout,
     const TextureImage& textureImage, const TextureSampler& textureSampler) {
@@ -127,11 +184,13 @@ void odin::DescriptorPool::createGraphicsDescriptorSets(
       descriptorSetLayout.getDescriptorSetLayout();
   descriptorSetAllocateInfo.descriptorSetCount = 1;
 
+  VkDescriptorSet graphicsDescriptorSet;
   if (vkAllocateDescriptorSets(deviceManager.getLogicalDevice(),
                                &descriptorSetAllocateInfo,
                                &graphicsDescriptorSet) != VK_SUCCESS) {
     throw std::runtime_error("Failed to allocate graphics descriptor sets!");
   }
+  graphicsDescriptorSets.push_back(graphicsDescriptorSet);
 
   VkWriteDescriptorSet writeDescriptor = {};
   writeDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -25,15 +25,42 @@ void odin::DescriptorSetLayout::createComputeDescriptorSetLayout(
   uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
   uboBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
-  // TODO Implement Triangle struct for storage
+  // Binding for the nodes of the BVH
+  VkDescriptorSetLayoutBinding bvhBinding = {};
+  bvhBinding.binding = 2;
+  bvhBinding.descriptorCount = 1;
+  bvhBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bvhBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  // Binding for the triangles referenced by the BVH leaves
   VkDescriptorSetLayoutBinding triangleBinding = {};
-  triangleBinding.binding = 2;
+  triangleBinding.binding = 3;
   triangleBinding.descriptorCount = 1;
   triangleBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
   triangleBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 3> bindings = {
-      outputBinding, uboBinding, triangleBinding};
+  // Binding for the samples accumulated over several frames
+  VkDescriptorSetLayoutBinding accumulationBinding = {};
+  accumulationBinding.binding = 4;
+  accumulationBinding.descriptorCount = 1;
+  accumulationBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  accumulationBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings = {
+      outputBinding, uboBinding, bvhBinding, triangleBinding,
+      accumulationBinding};
+
+  // Bindings for the paths, queues, hits, counters and sort bins of the
+  // wavefront path tracer. The megakernel does not use them, so they are only
+  // written for wavefront rendering
+  for (uint32_t binding = 5; binding < 10; binding++) {
+    VkDescriptorSetLayoutBinding wavefrontBinding = {};
+    wavefrontBinding.binding = binding;
+    wavefrontBinding.descriptorCount = 1;
+    wavefrontBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    wavefrontBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings.push_back(wavefrontBinding);
+  }
 
   VkDescriptorSetLayoutCreateInfo layoutInfo = {};
   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
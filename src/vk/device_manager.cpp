@@ -2,9 +2,11 @@
 
 odin::DeviceManager::DeviceManager(const Instance& instance,
                                    const VkSurfaceKHR& surface,
-                                   bool enableValidationLayers) {
+                                   bool enableValidationLayers,
+                                   const std::string& pipelineCacheDirectory) {
   pickPhysicalDevice(instance, surface);
-  createLogicalDevice(instance, surface, enableValidationLayers);
+  createLogicalDevice(instance, surface, enableValidationLayers,
+                      pipelineCacheDirectory);
 }
 
 bool odin::DeviceManager::checkDeviceExtensionSupport(
@@ -27,15 +29,20 @@ bool odin::DeviceManager::checkDeviceExtensionSupport(
   return requiredExtensions.empty();
 }
 
-void odin::DeviceManager::createLogicalDevice(const Instance& instance,
-                                              VkSurfaceKHR surface,
-                                              bool enableValidationLayers) {
+void odin::DeviceManager::createLogicalDevice(
+    const Instance& instance, VkSurfaceKHR surface, bool enableValidationLayers,
+    const std::string& pipelineCacheDirectory) {
   QueueFamilyIndices indices = findQueueFamilies(surface);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.computeFamily.value(),
-                                            indices.graphicsFamily.value(),
-                                            indices.presentFamily.value()};
+  std::set<uint32_t> uniqueQueueFamilies = {indices.computeFamily.value()};
+  if (indices.transferFamily.has_value()) {
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
+  }
+  if (surface != VK_NULL_HANDLE) {
+    uniqueQueueFamilies.insert(indices.graphicsFamily.value());
+    uniqueQueueFamilies.insert(indices.presentFamily.value());
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -48,8 +55,10 @@ void odin::DeviceManager::createLogicalDevice(const Instance& instance,
   }
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
-  // Need to check for this even though device should have it
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // Need to check for this even though device should have it. Headless
+  // rendering does not sample the result
+  deviceFeatures.samplerAnisotropy =
+      surface != VK_NULL_HANDLE ? VK_TRUE : VK_FALSE;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -60,9 +69,13 @@ void odin::DeviceManager::createLogicalDevice(const Instance& instance,
 
   createInfo.pEnabledFeatures = &deviceFeatures;
 
-  createInfo.enabledExtensionCount =
-      static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  if (surface != VK_NULL_HANDLE) {
+    createInfo.enabledExtensionCount =
+        static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  } else {
+    createInfo.enabledExtensionCount = 0;
+  }
 
   if (enableValidationLayers) {
     createInfo.enabledLayerCount =
@@ -79,9 +92,21 @@ void odin::DeviceManager::createLogicalDevice(const Instance& instance,
       VK_SUCCESS) {
     throw std::runtime_error("Failed to create logical device!");
   }
+  memoryAllocator =
+      std::make_unique<MemoryAllocator>(physicalDevice, logicalDevice);
+  pipelineCache = std::make_unique<PipelineCache>(
+      physicalDevice, logicalDevice, pipelineCacheDirectory);
 
   vkGetDeviceQueue(logicalDevice, indices.computeFamily.value(), 0,
                    &computeQueue);
+  if (indices.transferFamily.has_value()) {
+    vkGetDeviceQueue(logicalDevice, indices.transferFamily.value(), 0,
+                     &transferQueue);
+  }
+  if (surface == VK_NULL_HANDLE) {
+    return;
+  }
+
   vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0,
                    &graphicsQueue);
   vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0,
@@ -113,6 +138,27 @@ odin::QueueFamilyIndices odin::DeviceManager::findQueueFamilies(
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
                                            queueFamilies.data());
 
+  for (uint32_t i = 0; i < queueFamilyCount; i++) {
+    VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (queueFamilies[i].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      indices.transferFamily = i;
+      break;
+    }
+  }
+
+  // Without a surface any queue that supports compute will do
+  if (surface == VK_NULL_HANDLE) {
+    for (uint32_t i = 0; i < queueFamilyCount; i++) {
+      if (queueFamilies[i].queueCount > 0 &&
+          queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        indices.computeFamily = i;
+        break;
+      }
+    }
+    return indices;
+  }
+
   int i = 0;
   for (const auto& queueFamily : queueFamilies) {
     // Find a command queue that supports graphics and compute
@@ -153,6 +199,10 @@ const VkDevice odin::DeviceManager::getLogicalDevice() const {
   return logicalDevice;
 }
 
+odin::MemoryAllocator& odin::DeviceManager::getMemoryAllocator() const {
+  return *memoryAllocator;
+}
+
 const uint32_t odin::DeviceManager::getMemoryType(
     uint32_t typeBits, VkMemoryPropertyFlags properties,
     VkBool32* memTypeFound) const {
@@ -181,6 +231,10 @@ const VkPhysicalDevice odin::DeviceManager::getPhysicalDevice() const {
   return physicalDevice;
 }
 
+odin::PipelineCache& odin::DeviceManager::getPipelineCache() const {
+  return *pipelineCache;
+}
+
 const VkQueue odin::DeviceManager::getPresentationQueue() const {
   return presentQueue;
 }
@@ -191,10 +245,24 @@ odin::SwapChainSupportDetails odin::DeviceManager::getSwapChainSupport() const {
   return swapChainSupportDetails;
 }
 
+const VkQueue odin::DeviceManager::getTransferQueue() const {
+  return transferQueue;
+}
+
 bool odin::DeviceManager::isDeviceSuitable(VkPhysicalDevice physicalDevice,
                                            VkSurfaceKHR surface) {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
+  // Headless rendering writes a storage image and copies it back to the host
+  if (surface == VK_NULL_HANDLE) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(
+        physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+    return indices.isComputeComplete() &&
+           (formatProperties.optimalTilingFeatures &
+            VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+  }
+
   bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice);
 
   bool swapChainAdequate = false;
@@ -1,18 +1,18 @@
 #include "vk/graphics_pipeline.hpp"
 
 odin::GraphicsPipeline::GraphicsPipeline(
-    const VkDevice& logicalDevice, const Swapchain& swapChain,
-    const RenderPass& renderPass,
+    const VkDevice& logicalDevice, const VkPipelineCache& pipelineCache,
+    const Swapchain& swapChain, const RenderPass& renderPass,
     const DescriptorSetLayout& descriptorSetLayout,
     const std::string& vertexShaderPath,
     const std::string& fragmentShaderPath) {
-  createPipeline(logicalDevice, swapChain, renderPass, descriptorSetLayout,
-                 vertexShaderPath, fragmentShaderPath);
+  createPipeline(logicalDevice, pipelineCache, swapChain, renderPass,
+                 descriptorSetLayout, vertexShaderPath, fragmentShaderPath);
 }
 
 void odin::GraphicsPipeline::createPipeline(
-    const VkDevice& logicalDevice, const Swapchain& swapChain,
-    const RenderPass& renderPass,
+    const VkDevice& logicalDevice, const VkPipelineCache& pipelineCache,
+    const Swapchain& swapChain, const RenderPass& renderPass,
     const DescriptorSetLayout& descriptorSetLayout,
     const std::string& vertexShaderPath,
     const std::string& fragmentShaderPath) {
@@ -161,7 +161,7 @@ void odin::GraphicsPipeline::createPipeline(
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
   pipelineInfo.pNext = VK_NULL_HANDLE;
 
-  if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo,
+  if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineInfo,
                                 nullptr, &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("Failed to create graphics pipeline!");
   }
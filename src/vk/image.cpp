@@ -4,7 +4,7 @@ void odin::Image::createImage(const DeviceManager& deviceManager,
                               uint32_t width, uint32_t height, VkFormat format,
                               VkImageTiling tiling, VkImageUsageFlags usage,
                               VkMemoryPropertyFlags properties, VkImage& image,
-                              VkDeviceMemory& imageMemory) {
+                              MemoryAllocation& imageMemory) {
   VkImageCreateInfo imageInfo = {};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -30,18 +30,11 @@ void odin::Image::createImage(const DeviceManager& deviceManager,
   vkGetImageMemoryRequirements(deviceManager.getLogicalDevice(), image,
                                &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = deviceManager.getMemoryType(
-      memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  imageMemory =
+      deviceManager.getMemoryAllocator().allocate(memRequirements, properties);
 
-  if (vkAllocateMemory(deviceManager.getLogicalDevice(), &allocInfo, nullptr,
-                       &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("Failed to allocate image memory!");
-  }
-
-  vkBindImageMemory(deviceManager.getLogicalDevice(), image, imageMemory, 0);
+  vkBindImageMemory(deviceManager.getLogicalDevice(), image,
+                    imageMemory.memory, imageMemory.offset);
 }
 
 bool odin::Image::hasStencilComponent(const VkFormat& format) {
@@ -50,13 +43,13 @@ bool odin::Image::hasStencilComponent(const VkFormat& format) {
 }
 
 void odin::Image::transitionImageLayout(const DeviceManager& deviceManager,
-                                        const CommandPool& commandPool,
+                                        CommandPool& commandPool,
                                         VkImage image, VkFormat format,
                                         VkImageAspectFlags aspectMask,
                                         VkImageLayout oldLayout,
                                         VkImageLayout newLayout) {
   VkCommandBuffer commandBuffer =
-      commandPool.beginSingleTimeCommands(deviceManager.getLogicalDevice());
+      commandPool.beginTransientCommands(deviceManager.getLogicalDevice());
 
   // Setup image memory barrier to transition our image layout
   VkImageMemoryBarrier barrier = {};
@@ -87,6 +80,4 @@ void odin::Image::transitionImageLayout(const DeviceManager& deviceManager,
   // https://www.khronos.org/registry/vulkan/specs/1.1-extensions/man/html/VkPipelineStageFlagBits.html
   vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0,
                        nullptr, 0, nullptr, 1, &barrier);
-
-  commandPool.endSingleTimeCommands(deviceManager, commandBuffer);
 }
\ No newline at end of file
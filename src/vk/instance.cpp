@@ -1,7 +1,8 @@
 #include <vk/instance.hpp>
 
-odin::Instance::Instance(bool debug) {
+odin::Instance::Instance(bool debug, bool headless) {
   enableValidationLayers = debug;
+  this->headless = headless;
 
   if (enableValidationLayers && !checkValidationLayerSupport()) {
     throw std::runtime_error("Validation layers requested, but not available!");
@@ -117,12 +118,15 @@ size_t odin::Instance::getValidationLayerSize() const {
 }
 
 std::vector<const char *> odin::Instance::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions,
-                                       glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+
+  // Surfaces are only needed to present to a window
+  if (!headless) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
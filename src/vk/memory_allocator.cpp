@@ -0,0 +1,203 @@
+#include "vk/memory_allocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+const VkDeviceSize odin::MemoryAllocator::BLOCK_SIZE;
+
+odin::MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice,
+                                       VkDevice logicalDevice)
+    : logicalDevice(logicalDevice) {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  bufferImageGranularity = properties.limits.bufferImageGranularity;
+  blocks.resize(memoryProperties.memoryTypeCount);
+}
+
+odin::MemoryAllocation odin::MemoryAllocator::allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties) {
+  MemoryAllocation allocation;
+  allocation.memoryType =
+      findMemoryType(requirements.memoryTypeBits, properties);
+  VkDeviceSize alignment =
+      std::max(requirements.alignment, bufferImageGranularity);
+  allocation.size =
+      (requirements.size + alignment - 1) / alignment * alignment;
+
+  std::vector<Block>& typeBlocks = blocks[allocation.memoryType];
+  bool found = false;
+  if (allocation.size > BLOCK_SIZE / 2) {
+    allocation.block =
+        createBlock(allocation.memoryType, allocation.size, true);
+    found = allocateRange(typeBlocks[allocation.block], allocation.size,
+                          alignment, allocation.offset);
+  } else {
+    for (uint32_t i = 0; i < typeBlocks.size() && !found; i++) {
+      if (typeBlocks[i].memory != VK_NULL_HANDLE && !typeBlocks[i].dedicated) {
+        allocation.block = i;
+        found = allocateRange(typeBlocks[i], allocation.size, alignment,
+                              allocation.offset);
+      }
+    }
+    if (!found) {
+      allocation.block =
+          createBlock(allocation.memoryType, BLOCK_SIZE, false);
+      found = allocateRange(typeBlocks[allocation.block], allocation.size,
+                            alignment, allocation.offset);
+    }
+  }
+  if (!found) {
+    throw std::runtime_error("Failed to sub-allocate device memory!");
+  }
+
+  Block& block = typeBlocks[allocation.block];
+  block.allocationCount++;
+  allocation.memory = block.memory;
+  if (block.mappedData != nullptr) {
+    allocation.mappedData =
+        static_cast<char*>(block.mappedData) + allocation.offset;
+  }
+  return allocation;
+}
+
+bool odin::MemoryAllocator::allocateRange(Block& block, VkDeviceSize size,
+                                          VkDeviceSize alignment,
+                                          VkDeviceSize& offset) {
+  for (auto range = block.freeRanges.begin(); range != block.freeRanges.end();
+       range++) {
+    VkDeviceSize rangeStart = range->first;
+    VkDeviceSize rangeEnd = range->first + range->second;
+    VkDeviceSize start = (rangeStart + alignment - 1) / alignment * alignment;
+    if (start + size > rangeEnd) {
+      continue;
+    }
+
+    // Keep what is left before and after the allocation
+    block.freeRanges.erase(range);
+    if (start > rangeStart) {
+      block.freeRanges[rangeStart] = start - rangeStart;
+    }
+    if (start + size < rangeEnd) {
+      block.freeRanges[start + size] = rangeEnd - (start + size);
+    }
+    offset = start;
+    return true;
+  }
+  return false;
+}
+
+void odin::MemoryAllocator::cleanup() {
+  for (std::vector<Block>& typeBlocks : blocks) {
+    for (Block& block : typeBlocks) {
+      if (block.memory != VK_NULL_HANDLE) {
+        // Freeing the memory also unmaps it
+        vkFreeMemory(logicalDevice, block.memory, nullptr);
+      }
+    }
+    typeBlocks.clear();
+  }
+}
+
+uint32_t odin::MemoryAllocator::createBlock(uint32_t memoryType,
+                                            VkDeviceSize size,
+                                            bool dedicated) {
+  Block block;
+  block.size = size;
+  block.dedicated = dedicated;
+  block.freeRanges[0] = size;
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryType;
+  if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &block.memory) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate device memory block!");
+  }
+
+  if (memoryProperties.memoryTypes[memoryType].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(logicalDevice, block.memory, 0, VK_WHOLE_SIZE, 0,
+                    &block.mappedData) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to map device memory block!");
+    }
+  }
+
+  // Reuse the entry of a released dedicated block
+  std::vector<Block>& typeBlocks = blocks[memoryType];
+  for (uint32_t i = 0; i < typeBlocks.size(); i++) {
+    if (typeBlocks[i].memory == VK_NULL_HANDLE) {
+      typeBlocks[i] = block;
+      return i;
+    }
+  }
+  typeBlocks.push_back(block);
+  return static_cast<uint32_t>(typeBlocks.size() - 1);
+}
+
+uint32_t odin::MemoryAllocator::findMemoryType(
+    uint32_t typeBits, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeBits & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+  throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+void odin::MemoryAllocator::free(const MemoryAllocation& allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  Block& block = blocks[allocation.memoryType][allocation.block];
+  block.allocationCount--;
+  if (block.dedicated && block.allocationCount == 0) {
+    vkFreeMemory(logicalDevice, block.memory, nullptr);
+    block = Block();
+    return;
+  }
+
+  // Merge the range with the free ranges right before and after it
+  VkDeviceSize offset = allocation.offset;
+  VkDeviceSize size = allocation.size;
+  auto next = block.freeRanges.lower_bound(offset);
+  if (next != block.freeRanges.end() && next->first == offset + size) {
+    size += next->second;
+    next = block.freeRanges.erase(next);
+  }
+  if (next != block.freeRanges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      size += previous->second;
+      block.freeRanges.erase(previous);
+    }
+  }
+  block.freeRanges[offset] = size;
+}
+
+odin::MemoryStats odin::MemoryAllocator::getStats() const {
+  MemoryStats stats;
+  for (const std::vector<Block>& typeBlocks : blocks) {
+    for (const Block& block : typeBlocks) {
+      if (block.memory == VK_NULL_HANDLE) {
+        continue;
+      }
+      stats.blockCount++;
+      stats.allocationCount += block.allocationCount;
+      stats.blockBytes += block.size;
+      stats.usedBytes += block.size;
+      for (const auto& range : block.freeRanges) {
+        stats.usedBytes -= range.second;
+        stats.freeRangeCount++;
+        stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+      }
+    }
+  }
+  return stats;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "vk/pipeline_cache.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+// Every device writes the same file. Data of another device is replaced
+const char* CACHE_FILE_NAME = "pipeline_cache.bin";
+}  // namespace
+
+const uint32_t odin::PipelineCache::FILE_MAGIC;
+
+odin::PipelineCache::PipelineCache(VkPhysicalDevice physicalDevice,
+                                   VkDevice logicalDevice,
+                                   const std::string& cacheDirectory)
+    : logicalDevice(logicalDevice), cacheDirectory(cacheDirectory) {
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+  std::vector<char> data = load();
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(logicalDevice, &cacheInfo, nullptr,
+                            &pipelineCache) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create pipeline cache!");
+  }
+}
+
+void odin::PipelineCache::cleanup() {
+  vkDestroyPipelineCache(logicalDevice, pipelineCache, nullptr);
+  pipelineCache = VK_NULL_HANDLE;
+}
+
+std::string odin::PipelineCache::getDefaultDirectory() {
+  if (const char* cacheHome = std::getenv("XDG_CACHE_HOME")) {
+    return std::string(cacheHome) + "/odin";
+  }
+  if (const char* home = std::getenv("HOME")) {
+    return std::string(home) + "/.cache/odin";
+  }
+  return "";
+}
+
+const VkPipelineCache odin::PipelineCache::getPipelineCache() const {
+  return pipelineCache;
+}
+
+bool odin::PipelineCache::isCompatible(const std::vector<char>& data) const {
+  // Header length, header version, vendor and device ID, then the UUID
+  const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (data.size() < headerSize) {
+    return false;
+  }
+
+  uint32_t header[4];
+  memcpy(header, data.data(), sizeof(header));
+  return header[0] >= headerSize &&
+         header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header[2] == properties.vendorID &&
+         header[3] == properties.deviceID &&
+         memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID,
+                VK_UUID_SIZE) == 0;
+}
+
+std::vector<char> odin::PipelineCache::load() const {
+  if (cacheDirectory.empty()) {
+    return {};
+  }
+
+  std::ifstream file(cacheDirectory + "/" + CACHE_FILE_NAME,
+                     std::ios::ate | std::ios::binary);
+  if (!file.is_open()) {
+    return {};
+  }
+  uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+  file.seekg(0);
+
+  FileHeader fileHeader;
+  if (fileSize < sizeof(fileHeader) ||
+      !file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) ||
+      fileHeader.magic != FILE_MAGIC ||
+      fileHeader.dataSize != fileSize - sizeof(fileHeader)) {
+    std::cout << "Ignoring truncated or invalid pipeline cache" << std::endl;
+    return {};
+  }
+  if (fileHeader.driverVersion != properties.driverVersion) {
+    std::cout << "Ignoring pipeline cache of another driver" << std::endl;
+    return {};
+  }
+
+  std::vector<char> data(static_cast<size_t>(fileHeader.dataSize));
+  if (!file.read(data.data(), data.size())) {
+    std::cout << "Ignoring truncated or invalid pipeline cache" << std::endl;
+    return {};
+  }
+  if (!isCompatible(data)) {
+    std::cout << "Ignoring pipeline cache of another device" << std::endl;
+    return {};
+  }
+  return data;
+}
+
+void odin::PipelineCache::save() const {
+  if (cacheDirectory.empty()) {
+    return;
+  }
+
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize,
+                             nullptr) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to get pipeline cache size!");
+  }
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize,
+                             data.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to get pipeline cache data!");
+  }
+
+  FileHeader fileHeader;
+  fileHeader.magic = FILE_MAGIC;
+  fileHeader.driverVersion = properties.driverVersion;
+  fileHeader.dataSize = dataSize;
+
+  // A missing cache only costs the compilation time, so failing to write it
+  // does not stop the application from exiting
+  std::error_code error;
+  std::filesystem::create_directories(cacheDirectory, error);
+  std::string path = cacheDirectory + "/" + CACHE_FILE_NAME;
+  // Every process writes its own temporary file, so instances that exit at
+  // the same time cannot interleave their writes
+  std::string temporaryPath = path + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&fileHeader),
+                    sizeof(fileHeader)) ||
+        !file.write(data.data(), data.size()) || !file.flush()) {
+      std::cout << "Failed to write pipeline cache to " << path
+                << std::endl;
+      file.close();
+      std::filesystem::remove(temporaryPath, error);
+      return;
+    }
+  }
+
+  // The rename replaces the file at once, so another instance reading the
+  // cache never sees a partially written file
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    std::cout << "Failed to write pipeline cache to " << path << std::endl;
+    std::filesystem::remove(temporaryPath, error);
+  }
+}
\ No newline at end of file
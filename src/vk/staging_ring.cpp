@@ -0,0 +1,168 @@
+#include "vk/staging_ring.hpp"
+
+#include <algorithm>
+
+#include "vk/buffer.hpp"
+
+const VkDeviceSize odin::StagingRing::RING_SIZE;
+const uint32_t odin::StagingRing::NUM_BATCHES;
+
+odin::StagingRing::StagingRing(const DeviceManager& deviceManager,
+                               const QueueFamilyIndices& queueFamilyIndices,
+                               VkDeviceSize size) {
+  uint32_t queueFamilyIndex;
+  if (queueFamilyIndices.transferFamily.has_value()) {
+    queueFamilyIndex = queueFamilyIndices.transferFamily.value();
+    queue = deviceManager.getTransferQueue();
+  } else if (queueFamilyIndices.graphicsFamily.has_value()) {
+    queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    queue = deviceManager.getGraphicsQueue();
+  } else {
+    queueFamilyIndex = queueFamilyIndices.computeFamily.value();
+    queue = deviceManager.getComputeQueue();
+  }
+
+  // The uploaded buffers are read by the compute and graphics queues
+  queueFamilies.push_back(queueFamilyIndex);
+  for (std::optional<uint32_t> family :
+       {queueFamilyIndices.computeFamily, queueFamilyIndices.graphicsFamily}) {
+    if (family.has_value() &&
+        std::find(queueFamilies.begin(), queueFamilies.end(),
+                  family.value()) == queueFamilies.end()) {
+      queueFamilies.push_back(family.value());
+    }
+  }
+
+  segmentSize = size / NUM_BATCHES;
+  Buffer::createBuffer(deviceManager, segmentSize * NUM_BATCHES,
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       ringBuffer, ringBufferMemory);
+
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueFamilyIndex;
+  // Every batch is recorded again once its previous copies finished
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+  if (vkCreateCommandPool(deviceManager.getLogicalDevice(), &poolInfo,
+                          nullptr, &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create staging command pool!");
+  }
+
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool = commandPool;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = NUM_BATCHES;
+
+  if (vkAllocateCommandBuffers(deviceManager.getLogicalDevice(), &allocInfo,
+                               commandBuffers.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate staging command buffers!");
+  }
+
+  // Batches that were never submitted count as finished
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+  for (VkFence& fence : fences) {
+    if (vkCreateFence(deviceManager.getLogicalDevice(), &fenceInfo, nullptr,
+                      &fence) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create staging fence!");
+    }
+  }
+}
+
+void odin::StagingRing::beginBatch(const DeviceManager& deviceManager) {
+  vkWaitForFences(deviceManager.getLogicalDevice(), 1, &fences[batch],
+                  VK_TRUE, UINT64_MAX);
+  vkResetFences(deviceManager.getLogicalDevice(), 1, &fences[batch]);
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(commandBuffers[batch], &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin staging command buffer!");
+  }
+  segmentOffset = 0;
+  recording = true;
+}
+
+void odin::StagingRing::cleanup(const DeviceManager& deviceManager) {
+  wait(deviceManager);
+  for (VkFence fence : fences) {
+    vkDestroyFence(deviceManager.getLogicalDevice(), fence, nullptr);
+  }
+  vkDestroyCommandPool(deviceManager.getLogicalDevice(), commandPool, nullptr);
+  vkDestroyBuffer(deviceManager.getLogicalDevice(), ringBuffer, nullptr);
+  deviceManager.getMemoryAllocator().free(ringBufferMemory);
+}
+
+void odin::StagingRing::flush(const DeviceManager& deviceManager) {
+  if (!recording) {
+    return;
+  }
+
+  if (vkEndCommandBuffer(commandBuffers[batch]) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to record staging command buffer!");
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffers[batch];
+
+  if (vkQueueSubmit(queue, 1, &submitInfo, fences[batch]) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit staging command buffer!");
+  }
+
+  recording = false;
+  batch = (batch + 1) % NUM_BATCHES;
+}
+
+const std::vector<uint32_t>& odin::StagingRing::getQueueFamilies() const {
+  return queueFamilies;
+}
+
+void odin::StagingRing::upload(const DeviceManager& deviceManager,
+                               VkBuffer dstBuffer, const void* data,
+                               VkDeviceSize size, VkDeviceSize dstOffset) {
+  const char* source = static_cast<const char*>(data);
+  // Data larger than a segment is split over several batches
+  while (size > 0) {
+    if (!recording) {
+      beginBatch(deviceManager);
+    }
+    if (segmentOffset == segmentSize) {
+      flush(deviceManager);
+      continue;
+    }
+
+    VkBufferCopy copyRegion = {};
+    copyRegion.srcOffset = batch * segmentSize + segmentOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = std::min(size, segmentSize - segmentOffset);
+
+    // Host visible memory stays mapped
+    memcpy(static_cast<char*>(ringBufferMemory.mappedData) +
+               copyRegion.srcOffset,
+           source, static_cast<size_t>(copyRegion.size));
+    vkCmdCopyBuffer(commandBuffers[batch], ringBuffer, dstBuffer, 1,
+                    &copyRegion);
+
+    segmentOffset += copyRegion.size;
+    source += copyRegion.size;
+    dstOffset += copyRegion.size;
+    size -= copyRegion.size;
+  }
+}
+
+void odin::StagingRing::wait(const DeviceManager& deviceManager) {
+  flush(deviceManager);
+  vkWaitForFences(deviceManager.getLogicalDevice(), NUM_BATCHES, fences.data(),
+                  VK_TRUE, UINT64_MAX);
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "vk/storage_buffer.hpp"
+
+odin::StorageBuffer::StorageBuffer(const DeviceManager& deviceManager,
+                                   const VkDeviceSize bufferSize,
+                                   VkBufferUsageFlags additionalUsage) {
+  createBuffer(deviceManager, bufferSize,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | additionalUsage,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer,
+               storageBufferMemory);
+
+  // Setup a descriptor for the buffer
+  descriptor.offset = 0;
+  descriptor.buffer = buffer;
+  descriptor.range = VK_WHOLE_SIZE;
+}
+
+const VkBuffer odin::StorageBuffer::getBuffer() const { return buffer; }
+
+const VkDescriptorBufferInfo odin::StorageBuffer::getDescriptor() const {
+  return descriptor;
+}
+
+const odin::MemoryAllocation& odin::StorageBuffer::getDeviceMemory() const {
+  return storageBufferMemory;
+}
\ No newline at end of file
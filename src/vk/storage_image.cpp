@@ -0,0 +1,135 @@
+#include "vk/storage_image.hpp"
+
+#include <cstring>
+
+odin::StorageImage::StorageImage(const DeviceManager& deviceManager,
+                                 CommandPool& commandPool,
+                                 uint32_t width, uint32_t height) {
+  imageHeight = height;
+  imageWidth = width;
+
+  // The device manager only picks devices that support this for headless
+  // rendering
+  createImage(deviceManager, width, height, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+  // The image stays in the general layout for shader writes and copies
+  transitionImageLayout(deviceManager, commandPool, image,
+                        VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT,
+                        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+  createImageView(deviceManager);
+
+  descriptor.sampler = VK_NULL_HANDLE;
+  descriptor.imageView = imageView;
+  descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+}
+
+void odin::StorageImage::createImageView(const DeviceManager& deviceManager) {
+  VkImageViewCreateInfo viewInfo = {};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(deviceManager.getLogicalDevice(), &viewInfo, nullptr,
+                        &imageView) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create storage image view!");
+  }
+}
+
+const VkDescriptorImageInfo* odin::StorageImage::getDescriptor() const {
+  return &descriptor;
+}
+
+const uint32_t odin::StorageImage::getHeight() const { return imageHeight; }
+
+const VkImage odin::StorageImage::getImage() const { return image; }
+
+const odin::MemoryAllocation& odin::StorageImage::getImageMemory() const {
+  return imageMemory;
+}
+
+const VkImageView odin::StorageImage::getImageView() const {
+  return imageView;
+}
+
+const uint32_t odin::StorageImage::getWidth() const { return imageWidth; }
+
+void odin::StorageImage::readPixels(const DeviceManager& deviceManager,
+                                    CommandPool& commandPool,
+                                    std::vector<uint8_t>& pixels) const {
+  VkDeviceSize imageSize = static_cast<VkDeviceSize>(imageWidth) *
+                           imageHeight * 4;
+
+  // Host visible buffer the image is copied into
+  VkBuffer stagingBuffer;
+  MemoryAllocation stagingBufferMemory;
+  Buffer::createBuffer(deviceManager, imageSize,
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       stagingBuffer, stagingBufferMemory);
+
+  VkCommandBuffer commandBuffer =
+      commandPool.beginTransientCommands(deviceManager.getLogicalDevice());
+
+  // Make sure the writes of the compute shader are visible to the copy
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {imageWidth, imageHeight, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL,
+                         stagingBuffer, 1, &region);
+
+  // Make the copied pixels visible to the host
+  VkBufferMemoryBarrier bufferBarrier = {};
+  bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = stagingBuffer;
+  bufferBarrier.offset = 0;
+  bufferBarrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                       &bufferBarrier, 0, nullptr);
+
+  // Waits until the copy has finished
+  commandPool.waitTransientCommands(deviceManager);
+
+  pixels.resize(imageSize);
+  memcpy(pixels.data(), stagingBufferMemory.mappedData,
+         static_cast<size_t>(imageSize));
+
+  vkDestroyBuffer(deviceManager.getLogicalDevice(), stagingBuffer, nullptr);
+  deviceManager.getMemoryAllocator().free(stagingBufferMemory);
+}
\ No newline at end of file
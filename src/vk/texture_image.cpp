@@ -1,7 +1,7 @@
 #include "vk/texture_image.hpp"
 
 odin::TextureImage::TextureImage(const DeviceManager& deviceManager,
-                                 const CommandPool& commandPool,
+                                 CommandPool& commandPool,
                                  const Swapchain& swapChain,
                                  const TextureSampler& textureSampler,
                                  uint32_t width, uint32_t height) {
@@ -14,11 +14,11 @@ odin::TextureImage::TextureImage(const DeviceManager& deviceManager,
 }
 
 void odin::TextureImage::copyBufferToImage(const DeviceManager& deviceManager,
-                                           const CommandPool& commandPool,
+                                           CommandPool& commandPool,
                                            VkBuffer buffer, VkImage image,
                                            uint32_t width, uint32_t height) {
   VkCommandBuffer commandBuffer =
-      commandPool.beginSingleTimeCommands(deviceManager.getLogicalDevice());
+      commandPool.beginTransientCommands(deviceManager.getLogicalDevice());
 
   VkBufferImageCopy region = {};
   region.bufferOffset = 0;
@@ -35,12 +35,10 @@ void odin::TextureImage::copyBufferToImage(const DeviceManager& deviceManager,
 
   vkCmdCopyBufferToImage(commandBuffer, buffer, image,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-  commandPool.endSingleTimeCommands(deviceManager, commandBuffer);
 }
 
 void odin::TextureImage::createTextureImage(const DeviceManager& deviceManager,
-                                            const CommandPool& commandPool,
+                                            CommandPool& commandPool,
                                             uint32_t width, uint32_t height) {
   imageHeight = height;
   imageWidth = width;
@@ -60,10 +58,13 @@ void odin::TextureImage::createTextureImage(const DeviceManager& deviceManager,
   }
 
   // Create a texture that is used for storage in the compute shader
-  // and can be sampled from in the fragment shader
+  // and can be sampled from in the fragment shader. Frame slots copy it to
+  // each other when only some tiles are rendered
   createImage(deviceManager, width, height, VK_FORMAT_R8G8B8A8_UNORM,
               VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+              VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_DST_BIT,
               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, textureImageMemory);
 
   // Setup the image layout for the texture
@@ -87,7 +88,8 @@ const uint32_t odin::TextureImage::getHeight() const { return imageHeight; }
 
 const VkImage odin::TextureImage::getTextureImage() const { return image; }
 
-const VkDeviceMemory odin::TextureImage::getTextureImageMemory() const {
+const odin::MemoryAllocation& odin::TextureImage::getTextureImageMemory()
+    const {
   return textureImageMemory;
 }
 
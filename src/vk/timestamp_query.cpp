@@ -0,0 +1,77 @@
+#include "vk/timestamp_query.hpp"
+
+#include <vector>
+
+odin::TimestampQuery::TimestampQuery(const DeviceManager& deviceManager,
+                                     uint32_t queueFamilyIndex,
+                                     uint32_t numRanges)
+    : numRanges(numRanges) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(deviceManager.getPhysicalDevice(),
+                                &properties);
+
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(deviceManager.getPhysicalDevice(),
+                                           &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(deviceManager.getPhysicalDevice(),
+                                           &queueFamilyCount,
+                                           queueFamilies.data());
+
+  // Queues without valid bits do not support timestamps
+  uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+  if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+    return;
+  }
+  timestampPeriod = properties.limits.timestampPeriod;
+  timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  VkQueryPoolCreateInfo queryPoolInfo = {};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolInfo.queryCount = 2 * numRanges;
+
+  if (vkCreateQueryPool(deviceManager.getLogicalDevice(), &queryPoolInfo,
+                        nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create timestamp query pool!");
+  }
+}
+
+float odin::TimestampQuery::getElapsedTime(const DeviceManager& deviceManager,
+                                           uint32_t range) const {
+  uint64_t timestamps[2];
+  if (vkGetQueryPoolResults(deviceManager.getLogicalDevice(), queryPool,
+                            2 * range, 2, sizeof(timestamps), timestamps,
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to read timestamp queries!");
+  }
+
+  // Subtracting before masking handles counters that wrapped around
+  uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+  return static_cast<float>(ticks) * timestampPeriod / 1000000.0f;
+}
+
+const VkQueryPool odin::TimestampQuery::getQueryPool() const {
+  return queryPool;
+}
+
+bool odin::TimestampQuery::isSupported() const {
+  return queryPool != VK_NULL_HANDLE;
+}
+
+void odin::TimestampQuery::reset(VkCommandBuffer commandBuffer) const {
+  vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2 * numRanges);
+}
+
+void odin::TimestampQuery::writeEnd(VkCommandBuffer commandBuffer,
+                                    uint32_t range,
+                                    VkPipelineStageFlagBits stage) const {
+  vkCmdWriteTimestamp(commandBuffer, stage, queryPool, 2 * range + 1);
+}
+
+void odin::TimestampQuery::writeStart(VkCommandBuffer commandBuffer,
+                                      uint32_t range,
+                                      VkPipelineStageFlagBits stage) const {
+  vkCmdWriteTimestamp(commandBuffer, stage, queryPool, 2 * range);
+}
\ No newline at end of file
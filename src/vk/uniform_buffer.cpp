@@ -1,9 +1,18 @@
 #include "vk/uniform_buffer.hpp"
 
 odin::UniformBuffer::UniformBuffer(const DeviceManager& deviceManager,
-                                   const VkDeviceSize bufferSize) {
-  createBuffer(deviceManager.getPhysicalDevice(),
-               deviceManager.getLogicalDevice(), bufferSize,
+                                   const VkDeviceSize bufferSize,
+                                   uint32_t numSlots)
+    : numSlots(numSlots) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(deviceManager.getPhysicalDevice(),
+                                &properties);
+  VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+  slotSize = (bufferSize + alignment - 1) / alignment * alignment;
+
+  // The allocator keeps host visible memory mapped, so updates need no
+  // vkMapMemory
+  createBuffer(deviceManager, slotSize * numSlots,
                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -12,15 +21,27 @@ odin::UniformBuffer::UniformBuffer(const DeviceManager& deviceManager,
   // Setup a descriptor for the buffer
   descriptor.offset = 0;
   descriptor.buffer = buffer;
-  descriptor.range = VK_WHOLE_SIZE;
+  descriptor.range = bufferSize;
 }
 
 const VkBuffer odin::UniformBuffer::getBuffer() const { return buffer; }
 
-const VkDescriptorBufferInfo odin::UniformBuffer::getDescriptor() const {
-  return descriptor;
+const VkDescriptorBufferInfo odin::UniformBuffer::getDescriptor(
+    uint32_t slot) const {
+  VkDescriptorBufferInfo slotDescriptor = descriptor;
+  slotDescriptor.offset = slot * slotSize;
+  return slotDescriptor;
 }
 
-const VkDeviceMemory odin::UniformBuffer::getDeviceMemory() const {
+const odin::MemoryAllocation& odin::UniformBuffer::getDeviceMemory() const {
   return uniformBufferMemory;
+}
+
+void odin::UniformBuffer::write(uint32_t slot, const void* data,
+                                VkDeviceSize size) const {
+  if (slot >= numSlots || size > slotSize) {
+    throw std::runtime_error("Uniform buffer write out of range!");
+  }
+  memcpy(static_cast<char*>(uniformBufferMemory.mappedData) + slot * slotSize,
+         data, size);
 }
\ No newline at end of file
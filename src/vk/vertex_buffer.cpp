@@ -1,42 +1,19 @@
 #include "vk/vertex_buffer.hpp"
 
-#include "vk/command_pool.hpp"
-
 odin::VertexBuffer::VertexBuffer(const DeviceManager& deviceManager,
-                                 const CommandPool& commandPool,
+                                 StagingRing& stagingRing,
                                  const std::vector<Vertex>& vertices) {
-  // Map buffer to CPU memory
   numVertices = vertices.size();
   VkDeviceSize bufferSize = sizeof(vertices[0]) * numVertices;
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(deviceManager.getPhysicalDevice(),
-               deviceManager.getLogicalDevice(), bufferSize,
-               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
-
-  // TODO Look into adding some validation logic before copying
-  void* data;
-  vkMapMemory(deviceManager.getLogicalDevice(), stagingBufferMemory, 0,
-              bufferSize, 0, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-  vkUnmapMemory(deviceManager.getLogicalDevice(), stagingBufferMemory);
-
-  createBuffer(deviceManager.getPhysicalDevice(),
-               deviceManager.getLogicalDevice(), bufferSize,
+
+  createBuffer(deviceManager, bufferSize,
                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, vertexBufferMemory);
-
-  copyBuffer(deviceManager, commandPool, stagingBuffer, buffer, bufferSize);
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, vertexBufferMemory,
+               stagingRing.getQueueFamilies());
 
-  // Destroy the staging buffer and backing memory once we successfully copied
-  // our vertex data into GPU memory
-  vkDestroyBuffer(deviceManager.getLogicalDevice(), stagingBuffer, nullptr);
-  vkFreeMemory(deviceManager.getLogicalDevice(), stagingBufferMemory, nullptr);
+  stagingRing.upload(deviceManager, buffer, vertices.data(), bufferSize);
 
   // Setup descriptor
   descriptor.offset = 0;
@@ -46,7 +23,7 @@ odin::VertexBuffer::VertexBuffer(const DeviceManager& deviceManager,
 
 const VkBuffer odin::VertexBuffer::getBuffer() const { return buffer; }
 
-const VkDeviceMemory odin::VertexBuffer::getBufferMemory() const {
+const odin::MemoryAllocation& odin::VertexBuffer::getBufferMemory() const {
   return vertexBufferMemory;
 }
 
@@ -0,0 +1,442 @@
+#include "vk/wavefront_pipeline.hpp"
+
+#include <algorithm>
+
+#include "vk/buffer.hpp"
+#include "vk/descriptor_pool.hpp"
+
+namespace {
+// PathState of shaders/include/wavefront.glsl is four vec4s
+const VkDeviceSize PATH_STATE_SIZE = sizeof(float) * 16;
+// Two ray queues, one queue per material and the sorted rays
+const VkDeviceSize QUEUE_ENTRY_SIZE =
+    sizeof(uint32_t) * (3 + odin::WavefrontPipeline::NUM_MATERIALS);
+// Distance and triangle of every hit
+const VkDeviceSize HIT_SIZE = sizeof(uint32_t) * 2;
+}  // namespace
+
+const uint32_t odin::WavefrontPipeline::GROUP_SIZE;
+const uint32_t odin::WavefrontPipeline::NUM_BOUNCES;
+const uint32_t odin::WavefrontPipeline::NUM_MATERIALS;
+const uint32_t odin::WavefrontPipeline::SORT_BINS;
+
+odin::WavefrontPipeline::WavefrontPipeline(
+    const DeviceManager& deviceManager,
+    const DescriptorSetLayout& descriptorSetLayout,
+    const std::string& shaderDirectory,
+    const ComputeSpecialization& specialization, uint32_t queueFamilyIndex,
+    const WavefrontOptions& options)
+    : options(options),
+      samplesPerPixel(specialization.numSamples) {
+  if (specialization.numBounces != NUM_BOUNCES) {
+    throw std::runtime_error(
+        "Wavefront kernels only support the default number of bounces!");
+  }
+  checkBufferSizes(deviceManager);
+  pathCapacity =
+      TileScheduler::TILE_SIZE * TileScheduler::TILE_SIZE * samplesPerPixel;
+
+  generatePipeline = std::make_unique<ComputePipeline>(
+      deviceManager, descriptorSetLayout,
+      shaderDirectory + "wavefront_generate.spv", specialization);
+  ComputeSpecialization extendSpecialization = specialization;
+  extendSpecialization.sortedRays = isSorting() ? VK_TRUE : VK_FALSE;
+  extendPipeline = std::make_unique<ComputePipeline>(
+      deviceManager, descriptorSetLayout,
+      shaderDirectory + (isPersistent() ? "wavefront_extend_persistent.spv"
+                                        : "wavefront_extend.spv"),
+      extendSpecialization);
+  resolvePipeline = std::make_unique<ComputePipeline>(
+      deviceManager, descriptorSetLayout,
+      shaderDirectory + "wavefront_resolve.spv", specialization);
+
+  // One shading pipeline per material, so every one runs a single scatter
+  // function without branching on the material
+  for (uint32_t i = 0; i < NUM_MATERIALS; i++) {
+    ComputeSpecialization materialSpecialization = specialization;
+    materialSpecialization.material = static_cast<int32_t>(i + 1);
+    shadePipelines[i] = std::make_unique<ComputePipeline>(
+        deviceManager, descriptorSetLayout,
+        shaderDirectory + "wavefront_shade.spv", materialSpecialization);
+  }
+
+  if (isSorting()) {
+    sortCountPipeline = std::make_unique<ComputePipeline>(
+        deviceManager, descriptorSetLayout,
+        shaderDirectory + "wavefront_sort_count.spv", specialization);
+    sortScanPipeline = std::make_unique<ComputePipeline>(
+        deviceManager, descriptorSetLayout,
+        shaderDirectory + "wavefront_sort_scan.spv", specialization);
+    sortScatterPipeline = std::make_unique<ComputePipeline>(
+        deviceManager, descriptorSetLayout,
+        shaderDirectory + "wavefront_sort_scatter.spv", specialization);
+  }
+
+  pathBuffer = std::make_unique<StorageBuffer>(
+      deviceManager, PATH_STATE_SIZE * pathCapacity);
+  queueBuffer = std::make_unique<StorageBuffer>(
+      deviceManager, QUEUE_ENTRY_SIZE * pathCapacity);
+  hitBuffer = std::make_unique<StorageBuffer>(deviceManager,
+                                              HIT_SIZE * pathCapacity);
+  // The counters are reset with vkCmdUpdateBuffer and hold the arguments of
+  // the indirect dispatches
+  counterBuffer = std::make_unique<StorageBuffer>(
+      deviceManager, sizeof(WavefrontCounters),
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  // Bound even without sorting, so the descriptor set is the same
+  sortBuffer = std::make_unique<StorageBuffer>(
+      deviceManager, sizeof(uint32_t) * SORT_BINS,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+  Buffer::createBuffer(
+      deviceManager, sizeof(uint32_t) * NUM_BOUNCES * options.numSlots,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      statsBuffer, statsBufferMemory);
+  for (uint32_t slot = 0; slot < options.numSlots; slot++) {
+    extendTimestamps.push_back(std::make_unique<TimestampQuery>(
+        deviceManager, queueFamilyIndex, options.maxTiles * NUM_BOUNCES));
+    if (isSorting()) {
+      sortTimestamps.push_back(std::make_unique<TimestampQuery>(
+          deviceManager, queueFamilyIndex, options.maxTiles * NUM_BOUNCES));
+    }
+  }
+}
+
+void odin::WavefrontPipeline::addStats(const DeviceManager& deviceManager,
+                                       uint32_t slot, size_t numTiles,
+                                       WavefrontStats& stats) const {
+  const uint32_t* tracedRays =
+      static_cast<const uint32_t*>(statsBufferMemory.mappedData) +
+      NUM_BOUNCES * slot;
+  for (uint32_t bounce = 0; bounce < NUM_BOUNCES; bounce++) {
+    stats.rays[bounce] += tracedRays[bounce];
+  }
+
+  if (!extendTimestamps[slot]->isSupported()) {
+    return;
+  }
+  for (uint32_t tile = 0; tile < numTiles; tile++) {
+    for (uint32_t bounce = 0; bounce < NUM_BOUNCES; bounce++) {
+      stats.time[bounce] += extendTimestamps[slot]->getElapsedTime(
+          deviceManager, tile * NUM_BOUNCES + bounce);
+      // The primary rays are coherent and never sorted
+      if (isSorting() && bounce > 0) {
+        stats.sortTime[bounce] += sortTimestamps[slot]->getElapsedTime(
+            deviceManager, tile * NUM_BOUNCES + bounce);
+      }
+    }
+  }
+}
+
+void odin::WavefrontPipeline::checkBufferSizes(
+    const DeviceManager& deviceManager) const {
+  // In 64 bits, so that large sample counts cannot wrap around
+  VkDeviceSize numPaths = static_cast<VkDeviceSize>(TileScheduler::TILE_SIZE) *
+                          TileScheduler::TILE_SIZE * samplesPerPixel;
+  // The queues count paths in 32 bits and traced_rays counts the rays of a
+  // bounce over all tiles of a frame
+  if (numPaths * options.maxTiles > UINT32_MAX) {
+    throw std::runtime_error(
+        "Too many samples per frame for the wavefront kernels!");
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(deviceManager.getPhysicalDevice(),
+                                &properties);
+  // The path buffer is the largest one and is bound as a whole
+  if (PATH_STATE_SIZE * numPaths > properties.limits.maxStorageBufferRange) {
+    throw std::runtime_error(
+        "Wavefront path buffer exceeds the storage buffer range!");
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(deviceManager.getPhysicalDevice(),
+                                      &memoryProperties);
+  VkDeviceSize heapSize = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    if (memoryProperties.memoryHeaps[i].flags &
+        VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      heapSize = std::max(heapSize, memoryProperties.memoryHeaps[i].size);
+    }
+  }
+  if ((PATH_STATE_SIZE + QUEUE_ENTRY_SIZE + HIT_SIZE) * numPaths > heapSize) {
+    throw std::runtime_error(
+        "Wavefront buffers exceed the device local memory!");
+  }
+}
+
+void odin::WavefrontPipeline::cleanup(const DeviceManager& deviceManager) {
+  VkDevice logicalDevice = deviceManager.getLogicalDevice();
+  std::vector<ComputePipeline*> pipelines = {
+      generatePipeline.get(), extendPipeline.get(), resolvePipeline.get()};
+  for (uint32_t i = 0; i < NUM_MATERIALS; i++) {
+    pipelines.push_back(shadePipelines[i].get());
+  }
+  if (isSorting()) {
+    pipelines.push_back(sortCountPipeline.get());
+    pipelines.push_back(sortScanPipeline.get());
+    pipelines.push_back(sortScatterPipeline.get());
+  }
+  for (ComputePipeline* pipeline : pipelines) {
+    pipeline->cleanup(deviceManager);
+  }
+
+  for (const StorageBuffer* storageBuffer :
+       {pathBuffer.get(), queueBuffer.get(), hitBuffer.get(),
+        counterBuffer.get(), sortBuffer.get()}) {
+    vkDestroyBuffer(logicalDevice, storageBuffer->getBuffer(), nullptr);
+    deviceManager.getMemoryAllocator().free(storageBuffer->getDeviceMemory());
+  }
+  vkDestroyBuffer(logicalDevice, statsBuffer, nullptr);
+  deviceManager.getMemoryAllocator().free(statsBufferMemory);
+
+  for (const std::unique_ptr<TimestampQuery>& timestamps :
+       extendTimestamps) {
+    vkDestroyQueryPool(logicalDevice, timestamps->getQueryPool(), nullptr);
+  }
+  for (const std::unique_ptr<TimestampQuery>& timestamps : sortTimestamps) {
+    vkDestroyQueryPool(logicalDevice, timestamps->getQueryPool(), nullptr);
+  }
+}
+
+const std::vector<VkDescriptorBufferInfo>
+odin::WavefrontPipeline::getDescriptors() const {
+  return {pathBuffer->getDescriptor(), queueBuffer->getDescriptor(),
+          hitBuffer->getDescriptor(), counterBuffer->getDescriptor(),
+          sortBuffer->getDescriptor()};
+}
+
+bool odin::WavefrontPipeline::isPersistent() const {
+  return options.persistentGroups > 0;
+}
+
+bool odin::WavefrontPipeline::isSorting() const { return options.sortRays; }
+
+void odin::WavefrontPipeline::recordBarrier(
+    VkCommandBuffer commandBuffer) const {
+  // Every stage reads the queues, counters and paths written by the stage or
+  // counter reset before it, and the counters hold its dispatch arguments
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void odin::WavefrontPipeline::recordSort(
+    VkCommandBuffer commandBuffer, const ComputePushConstants& pushConstants,
+    uint32_t slot, uint32_t range) const {
+  // The count and scatter passes run a thread per queued ray like the
+  // extension stage
+  VkDeviceSize argsOffset = offsetof(WavefrontCounters, extendArgs) +
+                            (pushConstants.bounce % 2) *
+                                sizeof(VkDispatchIndirectCommand);
+  if (sortTimestamps[slot]->isSupported()) {
+    sortTimestamps[slot]->writeStart(commandBuffer, range,
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  }
+  recordStage(commandBuffer, *sortCountPipeline, pushConstants);
+  vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(), argsOffset);
+  recordBarrier(commandBuffer);
+
+  recordStage(commandBuffer, *sortScanPipeline, pushConstants);
+  vkCmdDispatch(commandBuffer, 1, 1, 1);
+  recordBarrier(commandBuffer);
+
+  recordStage(commandBuffer, *sortScatterPipeline, pushConstants);
+  vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(), argsOffset);
+  if (sortTimestamps[slot]->isSupported()) {
+    sortTimestamps[slot]->writeEnd(commandBuffer, range,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  }
+  recordBarrier(commandBuffer);
+}
+
+void odin::WavefrontPipeline::recordStage(
+    VkCommandBuffer commandBuffer, const ComputePipeline& pipeline,
+    const ComputePushConstants& pushConstants) const {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipeline.getComputePipeline());
+  vkCmdPushConstants(commandBuffer, pipeline.getPipelineLayout(),
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants),
+                     &pushConstants);
+}
+
+void odin::WavefrontPipeline::recordTile(
+    VkCommandBuffer commandBuffer, const DescriptorPool& descriptorPool,
+    uint32_t slot, const ComputeTile& tile, uint32_t tileIndex,
+    const ComputePushConstants& frameConstants) const {
+  uint32_t numPixels = tile.width * tile.height;
+  uint32_t numPaths = numPixels * samplesPerPixel;
+  if (numPaths > pathCapacity) {
+    throw std::runtime_error("Tile exceeds the wavefront path capacity!");
+  }
+
+  // All pipelines share the same layout, so the descriptor set stays bound
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          generatePipeline->getPipelineLayout(), 0, 1,
+                          descriptorPool.getComputeDescriptorSet(slot), 0, 0);
+
+  // Every path of the tile is in the first ray queue, all others are empty.
+  // The traced rays keep counting over all tiles
+  WavefrontCounters counters = {};
+  counters.extendArgs[0] = {(numPaths + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1};
+  counters.extendArgs[1] = {0, 1, 1};
+  for (uint32_t i = 0; i < NUM_MATERIALS; i++) {
+    counters.shadeArgs[i] = {0, 1, 1};
+  }
+  counters.rayCount[0] = numPaths;
+  vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(), 0,
+                    offsetof(WavefrontCounters, tracedRays), &counters);
+  recordBarrier(commandBuffer);
+
+  ComputePushConstants pushConstants = frameConstants;
+  pushConstants.tileOffsetX = tile.x;
+  pushConstants.tileOffsetY = tile.y;
+  pushConstants.tileWidth = tile.width;
+  pushConstants.tileHeight = tile.height;
+  pushConstants.bounce = 0;
+  recordStage(commandBuffer, *generatePipeline, pushConstants);
+  vkCmdDispatch(commandBuffer, counters.extendArgs[0].x, 1, 1);
+
+  const VkDispatchIndirectCommand emptyArgs = {0, 1, 1};
+  const uint32_t emptyCount = 0;
+  for (uint32_t bounce = 0; bounce < NUM_BOUNCES; bounce++) {
+    uint32_t queue = bounce % 2;
+    uint32_t nextQueue = (bounce + 1) % 2;
+    if (bounce > 0) {
+      // Empty the ray queue of the next bounce, which the extension stage of
+      // the previous bounce has consumed, and the material queues. The
+      // persistent threads fetch from the start of the queue again
+      vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(WavefrontCounters, extendArgs) +
+                            nextQueue * sizeof(VkDispatchIndirectCommand),
+                        sizeof(emptyArgs), &emptyArgs);
+      vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(WavefrontCounters, rayCount) +
+                            nextQueue * sizeof(uint32_t),
+                        sizeof(emptyCount), &emptyCount);
+      vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(WavefrontCounters, shadeArgs),
+                        sizeof(counters.shadeArgs), counters.shadeArgs);
+      vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(WavefrontCounters, materialCount),
+                        sizeof(counters.materialCount),
+                        counters.materialCount);
+      vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(WavefrontCounters, fetchCount),
+                        sizeof(emptyCount), &emptyCount);
+      if (isSorting()) {
+        vkCmdFillBuffer(commandBuffer, sortBuffer->getBuffer(), 0,
+                        VK_WHOLE_SIZE, 0);
+      }
+    }
+    recordBarrier(commandBuffer);
+
+    pushConstants.bounce = bounce;
+    uint32_t range = tileIndex * NUM_BOUNCES + bounce;
+    // Scattering leaves the rays of the secondary bounces incoherent
+    if (isSorting() && bounce > 0) {
+      recordSort(commandBuffer, pushConstants, slot, range);
+    }
+
+    // Time the extension stage on its own. Both timestamps wait for the
+    // previous compute work instead of the top and bottom of the pipe
+    if (extendTimestamps[slot]->isSupported()) {
+      extendTimestamps[slot]->writeStart(commandBuffer, range,
+                                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    recordStage(commandBuffer, *extendPipeline, pushConstants);
+    if (isPersistent()) {
+      vkCmdDispatch(commandBuffer, options.persistentGroups, 1, 1);
+    } else {
+      vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(),
+                            offsetof(WavefrontCounters, extendArgs) +
+                                queue * sizeof(VkDispatchIndirectCommand));
+    }
+    if (extendTimestamps[slot]->isSupported()) {
+      extendTimestamps[slot]->writeEnd(commandBuffer, range,
+                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    // Paths hitting anything on the last bounce gather no more light
+    if (bounce + 1 == NUM_BOUNCES) {
+      break;
+    }
+
+    recordBarrier(commandBuffer);
+    for (uint32_t i = 0; i < NUM_MATERIALS; i++) {
+      recordStage(commandBuffer, *shadePipelines[i], pushConstants);
+      vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(),
+                            offsetof(WavefrontCounters, shadeArgs) +
+                                i * sizeof(VkDispatchIndirectCommand));
+    }
+  }
+  recordBarrier(commandBuffer);
+
+  recordStage(commandBuffer, *resolvePipeline, pushConstants);
+  vkCmdDispatch(commandBuffer, (numPixels + GROUP_SIZE - 1) / GROUP_SIZE, 1,
+                1);
+}
+
+void odin::WavefrontPipeline::recordTiles(
+    VkCommandBuffer commandBuffer, const DescriptorPool& descriptorPool,
+    uint32_t slot, const std::vector<ComputeTile>& tiles,
+    const ComputePushConstants& frameConstants) const {
+  if (tiles.size() > options.maxTiles) {
+    throw std::runtime_error("Too many tiles for the wavefront timestamps!");
+  }
+
+  if (extendTimestamps[slot]->isSupported()) {
+    extendTimestamps[slot]->reset(commandBuffer);
+  }
+  if (isSorting() && sortTimestamps[slot]->isSupported()) {
+    sortTimestamps[slot]->reset(commandBuffer);
+  }
+  const uint32_t tracedRays[NUM_BOUNCES] = {};
+  vkCmdUpdateBuffer(commandBuffer, counterBuffer->getBuffer(),
+                    offsetof(WavefrontCounters, tracedRays),
+                    sizeof(tracedRays), tracedRays);
+
+  for (uint32_t i = 0; i < tiles.size(); i++) {
+    recordTile(commandBuffer, descriptorPool, slot, tiles[i], i,
+               frameConstants);
+  }
+
+  // Copy the ray counts of the extension stages to the host
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0,
+      nullptr);
+
+  VkBufferCopy region = {};
+  region.srcOffset = offsetof(WavefrontCounters, tracedRays);
+  region.dstOffset = sizeof(tracedRays) * slot;
+  region.size = sizeof(tracedRays);
+  vkCmdCopyBuffer(commandBuffer, counterBuffer->getBuffer(), statsBuffer, 1,
+                  &region);
+
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0,
+                       nullptr, 0, nullptr);
+}
\ No newline at end of file